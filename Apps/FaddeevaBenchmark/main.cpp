@@ -0,0 +1,132 @@
+// Philipp Neufeld, 2023
+
+// Accuracy and throughput of the Faddeeva kernels for every accuracy mode
+// and every instruction set supported by this machine.
+// Usage: FaddeevaBenchmark [points]
+
+#include <QPT/Constants.h>
+#include <QPT/Spectroscopy/Faddeeva.h>
+#include <QPT/Spectroscopy/VoigtProfile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace QPT;
+
+// Independent reference: trapezoidal rule for
+//   w(z) = i / pi int exp(-t^2) / (z - t) dt   (Im z > 0)
+// with the pole correction of Matta and Reichel (Math. Comp. 25, 339
+// (1971)), evaluated in extended precision. Exact up to exp(-pi^2 / h^2).
+std::complex<double> ReferenceFaddeeva(double x, double y) {
+  using Complex_t = std::complex<long double>;
+  const long double h = 0.25L;
+  const long double pi = Pi_v;
+  const Complex_t z(x, y);
+  Complex_t sum = 0;
+  for (int k = -40; k <= 40; k++) {
+    const long double t = k * h;
+    sum += std::exp(-t * t) / (z - t);
+  }
+  sum *= Complex_t(0, h / pi);
+  if (y < pi / h) {
+    const Complex_t phase = std::exp(Complex_t(0, -2 * pi / h) * z);
+    sum += 2.0L * std::exp(-z * z) / (1.0L - phase);
+  }
+  return std::complex<double>(sum);
+}
+
+template <typename Func>
+double MeasureSeconds(Func&& func, int repetitions) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repetitions; r++) func();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count() / repetitions;
+}
+
+int main(int argc, char* argv[]) {
+  const std::size_t points = (argc > 1) ? std::atol(argv[1]) : (1 << 20);
+  const std::size_t samples = std::min<std::size_t>(points, 20000);
+
+  // typical line shape arguments: |x| up to 30, y from 1e-3 to 30
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> xDist(-30, 30), yDist(-3, 1.5);
+  std::vector<double> x(points), y(points), re(points), im(points);
+  for (std::size_t i = 0; i < points; i++) {
+    x[i] = xDist(rng) * ((i % 3 == 0) ? 0.1 : 1.0);
+    y[i] = std::pow(10.0, yDist(rng));
+  }
+
+  std::vector<std::complex<double>> reference(samples);
+  const double refTime = MeasureSeconds(
+      [&]() {
+        for (std::size_t i = 0; i < samples; i++)
+          reference[i] = ReferenceFaddeeva(x[i], y[i]);
+      },
+      1);
+  std::cout << "reference (trapezoid, long double): "
+            << refTime / samples * 1e9 << " ns/point" << std::endl
+            << std::endl;
+
+  std::cout << std::setw(10) << "mode" << std::setw(10) << "simd"
+            << std::setw(14) << "max abs err" << std::setw(14)
+            << "max rel err" << std::setw(12) << "ns/point" << std::setw(10)
+            << "speedup" << std::endl;
+  for (auto accuracy : {Faddeeva_FAST, Faddeeva_ACCURATE}) {
+    Faddeeva faddeeva(accuracy);
+    double scalarTime = 0;
+    for (int level = Simd_SCALAR; level <= Simd_AVX512; level++) {
+      if (!faddeeva.SetSimdLevel(static_cast<SimdLevel>(level))) continue;
+
+      faddeeva.Evaluate(x.data(), y.data(), samples, re.data(), im.data());
+      double maxAbs = 0, maxRel = 0;
+      for (std::size_t i = 0; i < samples; i++) {
+        const double err = std::abs(std::complex<double>(re[i], im[i]) -
+                                    reference[i]);
+        maxAbs = std::max(maxAbs, err);
+        maxRel = std::max(maxRel, err / std::abs(reference[i]));
+      }
+
+      const double time = MeasureSeconds(
+          [&]() {
+            faddeeva.Evaluate(x.data(), y.data(), points, re.data(),
+                              im.data());
+          },
+          5);
+      if (level == Simd_SCALAR) scalarTime = time;
+      std::cout << std::setw(10)
+                << ((accuracy == Faddeeva_FAST) ? "fast" : "accurate")
+                << std::setw(10) << GetSimdLevelName(faddeeva.GetSimdLevel())
+                << std::setw(14) << maxAbs << std::setw(14) << maxRel
+                << std::setw(12) << time / points * 1e9 << std::setw(10)
+                << scalarTime / time << std::endl;
+    }
+  }
+
+  // Voigt profile of the Rb D2 line at room temperature
+  const double gamma = TwoPi_v * 6.0666e6 / 2;
+  auto voigt = VoigtProfile::FromDoppler(86.909 * AtomicMassUnit_v, 293.15,
+                                         780.241e-9, gamma);
+  const double span = 10 * voigt.GetFWHM();
+  std::vector<double> detunings(points), profile(points);
+  for (std::size_t i = 0; i < points; i++)
+    detunings[i] = -span + 2 * span * i / std::max<std::size_t>(points - 1, 1);
+  const double time = MeasureSeconds(
+      [&]() { voigt.Evaluate(detunings.data(), points, profile.data()); }, 5);
+  double area = 0;
+  for (std::size_t i = 0; i < points; i++) area += profile[i];
+  area *= 2 * span / std::max<std::size_t>(points - 1, 1);
+  std::cout << std::endl
+            << "Rb D2 Voigt profile: FWHM " << voigt.GetFWHM() / TwoPi_v / 1e6
+            << " MHz, area in +/- 10 FWHM " << area << ", "
+            << time / points * 1e9 << " ns/point ("
+            << GetSimdLevelName(voigt.GetFaddeeva().GetSimdLevel()) << ")"
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Philipp Neufeld, 2023
+
+// Combines result files into a single file. The group structures are merged,
+// datasets that exist in several inputs are concatenated along the given
+// axis (in the order of the inputs) if their shapes allow it, all other
+// objects are copied from the first input that has them. Chunks are
+// copied without decompressing them whenever the inputs allow it.
+//
+// Usage: Merge [--axis <n>] [--keep <path>]... <output> <input>...
+//   --axis <n>     concatenation axis (default 0)
+//   --keep <path>  copy the dataset <path> (relative to the root group) from
+//                  the first input that has it instead of concatenating it
+
+#include <QPT/HDF5/H5File.h>
+#include <QPT/HDF5/H5Merge.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace QPT;
+
+int main(int argc, char* argv[]) {
+  std::size_t axis = 0;
+  std::vector<std::string> keep, files;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--axis" && i + 1 < argc) {
+      axis = std::atol(argv[++i]);
+    } else if (arg == "--keep" && i + 1 < argc) {
+      std::string path = argv[++i];
+      path.erase(0, path.find_first_not_of('/'));
+      keep.push_back(path);
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--axis <n>] [--keep <path>]... <output> <input>..."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<H5File> inputs;
+  for (std::size_t i = 1; i < files.size(); i++) {
+    auto file = H5File::Open(files[i], H5File_READ_ONLY);
+    if (!file) {
+      std::cerr << "Cannot open input file " << files[i] << std::endl;
+      return EXIT_FAILURE;
+    }
+    inputs.push_back(std::move(*file));
+  }
+  auto output = H5File::Open(files[0], H5File_MUST_NOT_EXIST);
+  if (!output) {
+    std::cerr << "Cannot create output file " << files[0]
+              << " (it must not exist yet)" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  H5Merger merger(axis);
+  merger.SetConcatenationFilter([&keep](const std::string& path) {
+    return std::find(keep.begin(), keep.end(), path) == keep.end();
+  });
+  if (!merger.Merge(std::vector<H5Group>(inputs.begin(), inputs.end()),
+                    *output)) {
+    std::cerr << "Merging failed (cannot read an input or write the output)"
+              << std::endl;
+    output.reset();
+    std::remove(files[0].c_str());
+    return EXIT_FAILURE;
+  }
+
+  const auto& stats = merger.GetStatistics();
+  std::cout << "Concatenated " << stats.concatenatedDatasets
+            << " datasets (" << stats.rawChunks << " raw chunks, "
+            << stats.convertedDatasets << " datasets converted), copied "
+            << stats.copiedObjects << " objects ("
+            << stats.incompatibleDatasets
+            << " datasets could not be concatenated)" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+// Philipp Neufeld, 2023
+
+// Resumable parameter sweep of the steady state of a ladder system
+// g -> e -> r (probe g -> e, coupling e -> r) using all cores of a node.
+// The grid is partitioned across worker processes (each with its own thread
+// pool and its own shard file <output>.shard<k>), the shards are merged into
+// <output> once all workers are done. Every shard marks the points it has
+// written, so a killed run resumes where it stopped when it is started again
+// with the same spec and worker count.
+//
+// Usage: Sweep <spec> <output> [workers] [threads per worker]
+// (defaults: one single-threaded worker per core)
+//
+// Spec file, one directive per line ('#' starts a comment):
+//   param <name> <value>                  fixed parameter
+//   axis <name> linspace <a> <b> <count>  swept parameter
+//   axis <name> values <v1> <v2> ...
+// Parameters (rates and frequencies in the same unit, default value):
+//   probe_detuning (0), coupling_detuning (0), probe_rabi (0.1),
+//   coupling_rabi (1), decay_e (1), decay_r (0)
+
+#include <QPT/Dynamics/SteadyStateSolver.h>
+#include <QPT/HDF5/H5File.h>
+#include <QPT/Parallel/ParameterSweep.h>
+#include <QPT/Parallel/ThreadPool.h>
+#include <QPT/Platform.h>
+
+#include <algorithm>
+#include <complex>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef QPT_PLATFORM_LINUX
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif  // QPT_PLATFORM_LINUX
+
+using namespace QPT;
+
+using Parameters_t = std::map<std::string, double>;
+
+const std::vector<std::string> ObservableNames = {
+    "population_g", "population_e", "population_r", "absorption"};
+
+struct SweepSpec {
+  Parameters_t parameters = {
+      {"probe_detuning", 0}, {"coupling_detuning", 0}, {"probe_rabi", 0.1},
+      {"coupling_rabi", 1},  {"decay_e", 1},           {"decay_r", 0}};
+  std::vector<std::pair<std::string, std::vector<double>>> axes;
+};
+
+std::optional<SweepSpec> ParseSpec(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file) {
+    std::cerr << "Cannot open spec file " << filename << std::endl;
+    return std::nullopt;
+  }
+
+  SweepSpec spec;
+  std::string line;
+  for (std::size_t lineNo = 1; std::getline(file, line); lineNo++) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream stream(line);
+    std::string directive, name;
+    if (!(stream >> directive)) continue;
+
+    bool valid = (stream >> name) && spec.parameters.count(name);
+    if (valid && directive == "param") {
+      valid = static_cast<bool>(stream >> spec.parameters[name]);
+    } else if (valid && directive == "axis") {
+      std::string kind;
+      std::vector<double> values;
+      stream >> kind;
+      if (kind == "linspace") {
+        double a, b;
+        std::size_t count;
+        valid = (stream >> a >> b >> count) && count > 0;
+        for (std::size_t i = 0; valid && i < count; i++)
+          values.push_back((count == 1) ? a : a + (b - a) * i / (count - 1));
+      } else if (kind == "values") {
+        for (double v; stream >> v;) values.push_back(v);
+        valid = !values.empty() && stream.eof();
+      } else {
+        valid = false;
+      }
+      spec.axes.emplace_back(name, std::move(values));
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      std::cerr << filename << ":" << lineNo << ": invalid directive"
+                << std::endl;
+      return std::nullopt;
+    }
+  }
+
+  if (spec.axes.empty()) {
+    std::cerr << "The spec does not contain any axis" << std::endl;
+    return std::nullopt;
+  }
+  return spec;
+}
+
+// (population_g, population_e, population_r, Im rho_eg)
+std::vector<double> EvaluateLadder(const Parameters_t& p) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  LindbladSystem system(3);
+  system.AddHamiltonianTerm(1, 1, -p.at("probe_detuning"));
+  system.AddHamiltonianTerm(
+      2, 2, -p.at("probe_detuning") - p.at("coupling_detuning"));
+  system.AddHamiltonianTerm(1, 0, 0.5 * p.at("probe_rabi"));
+  system.AddHamiltonianTerm(2, 1, 0.5 * p.at("coupling_rabi"));
+  system.AddDecay(1, 0, p.at("decay_e"));
+  if (p.at("decay_r") > 0) system.AddDecay(2, 1, p.at("decay_r"));
+
+  for (std::size_t i = 0; i < 3; i++)
+    system.AddPopulationObservable(ObservableNames[i], i);
+  // Re Tr(O rho) = Im rho_eg for O = -i |g><e|
+  LindbladSystem::Operator_t absorption(3, 3);
+  absorption.insert(0, 1) = std::complex<double>(0, -1);
+  system.AddObservable(ObservableNames[3], absorption);
+
+  SteadyStateSolver solver(system, LindbladSystem::Operator_t(3, 3));
+  std::vector<double> result(ObservableNames.size(), nan);
+  const double detuning = 0;
+  solver.SolveBatch(&detuning, 1, result.data());
+  return result;
+}
+
+std::string GetShardName(const std::string& output, std::size_t shard) {
+  return output + ".shard" + std::to_string(shard);
+}
+
+ParameterSweep CreateSweep(const SweepSpec& spec, H5Group group) {
+  ParameterSweep sweep(std::move(group));
+  for (const auto& [name, values] : spec.axes) sweep.AddAxis(name, values);
+  return sweep;
+}
+
+// evaluates the points of one partition, returns the process exit code
+int RunWorker(const SweepSpec& spec, const std::string& output,
+              std::size_t workers, std::size_t shard, std::size_t threads) {
+  const auto filename = GetShardName(output, shard);
+  auto file = H5File::Open(filename, H5File_DEFAULT);
+  auto group = file ? file->OpenSubgroup("sweep") : std::nullopt;
+  if (!group) {
+    std::cerr << "Cannot open shard " << filename << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto sweep = CreateSweep(spec, std::move(*group));
+  sweep.SetPartition(workers, shard);
+  sweep.SetWriteBatchSize(16);
+  if (sweep.GetLocalPointCount() == 0) return EXIT_SUCCESS;
+
+  ThreadPool pool(threads);
+  auto count = sweep.Run(
+      pool, {ObservableNames.size()}, [&](const std::vector<double>& point) {
+        Parameters_t parameters = spec.parameters;
+        for (std::size_t i = 0; i < point.size(); i++)
+          parameters[spec.axes[i].first] = point[i];
+        return EvaluateLadder(parameters);
+      });
+  if (!count) {
+    std::cerr << "Shard " << filename
+              << " failed (does it belong to a different spec or worker "
+                 "count?)"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Shard " << shard << ": evaluated " << *count << " of "
+            << sweep.GetLocalPointCount() << " points" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// runs all workers, returns true if every worker succeeded
+bool RunWorkers(const SweepSpec& spec, const std::string& output,
+                std::size_t workers, std::size_t threads) {
+#ifdef QPT_PLATFORM_LINUX
+  // the parent has no HDF5 file open while the workers are forked
+  std::vector<pid_t> children;
+  for (std::size_t k = 0; k < workers; k++) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      // workers must not outlive a killed parent (two writers per shard)
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      std::_Exit(RunWorker(spec, output, workers, k, threads));
+    }
+    if (pid < 0) {
+      std::cerr << "fork failed" << std::endl;
+      break;
+    }
+    children.push_back(pid);
+  }
+
+  bool success = (children.size() == workers);
+  for (pid_t pid : children) {
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != EXIT_SUCCESS)
+      success = false;
+  }
+  return success;
+#else
+  // no fork: the shards are processed one after the other, each with all
+  // threads
+  bool success = true;
+  for (std::size_t k = 0; k < workers; k++) {
+    success = (RunWorker(spec, output, workers, k, threads * workers) ==
+               EXIT_SUCCESS) &&
+              success;
+  }
+  return success;
+#endif  // QPT_PLATFORM_LINUX
+}
+
+bool MergeShards(const SweepSpec& spec, const std::string& output,
+                 std::size_t workers) {
+  auto file = H5File::Open(output, H5File_DEFAULT);
+  auto group = file ? file->OpenSubgroup("sweep") : std::nullopt;
+  if (!group) return false;
+
+  std::vector<std::optional<H5File>> shardFiles;
+  std::vector<H5Group> shards;
+  for (std::size_t k = 0; k < workers; k++) {
+    shardFiles.push_back(
+        H5File::Open(GetShardName(output, k), H5File_MUST_EXIST));
+    auto shard =
+        shardFiles.back() ? shardFiles.back()->OpenSubgroup("sweep")
+                          : std::nullopt;
+    if (!shard) return false;
+    shards.push_back(std::move(*shard));
+  }
+
+  auto sweep = CreateSweep(spec, *group);
+  auto completed =
+      sweep.Merge<std::vector<double>>(shards, {ObservableNames.size()});
+  if (!completed) return false;
+  std::cout << "Merged " << *completed << " of " << sweep.GetPointCount()
+            << " points into " << output << std::endl;
+
+  for (const auto& [name, value] : spec.parameters) {
+    if (!group->SetAttribute("param_" + name, value)) return false;
+  }
+  for (std::size_t i = 0; i < ObservableNames.size(); i++) {
+    if (!group->SetAttribute("column" + std::to_string(i),
+                             ObservableNames[i]))
+      return false;
+  }
+  return *completed == sweep.GetPointCount();
+}
+
+// true if output already holds the complete sweep of the spec
+bool IsComplete(const SweepSpec& spec, const std::string& output) {
+  if (!std::ifstream(output)) return false;
+  auto file = H5File::Open(output, H5File_MUST_EXIST);
+  if (!file || !file->HasSubgroup("sweep")) return false;
+  auto sweep = CreateSweep(spec, *file->OpenSubgroup("sweep"));
+  const auto completed = sweep.GetCompleted();
+  return completed && completed->size() == sweep.GetPointCount() &&
+         std::count(completed->begin(), completed->end(), 0) == 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0]
+              << " <spec> <output> [workers] [threads per worker]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string output = argv[2];
+  auto spec = ParseSpec(argv[1]);
+  if (!spec) return EXIT_FAILURE;
+
+  const std::size_t cores =
+      std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  std::size_t workers = (argc > 3) ? std::atol(argv[3]) : cores;
+  const std::size_t threads =
+      std::max<std::size_t>((argc > 4) ? std::atol(argv[4]) : 1, 1);
+  std::size_t points = 1;
+  for (const auto& axis : spec->axes) points *= axis.second.size();
+  workers = std::clamp<std::size_t>(workers, 1, points);
+  if (IsComplete(*spec, output)) {
+    std::cout << output << " already holds the complete sweep" << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (!RunWorkers(*spec, output, workers, threads)) {
+    std::cerr << "Not all workers finished, run again to resume"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!MergeShards(*spec, output, workers)) {
+    std::cerr << "Merging the shards failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // the shards are no longer needed once the sweep is complete
+  for (std::size_t k = 0; k < workers; k++)
+    std::remove(GetShardName(output, k).c_str());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,528 @@
+// Philipp Neufeld, 2023
+
+#include "WignerSymbols.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <utility>
+
+#include "../Constants.h"
+
+namespace QPT {
+
+namespace {
+
+// 2j, 2m of a 3j symbol column (pairs of 6j symbols use the same type)
+using Column_t = std::pair<int, int>;
+
+// Twice an (half-)integral angular momentum
+int ToTwice(double j) { return static_cast<int>(std::lround(2 * j)); }
+
+bool IsTriangle(int ta, int tb, int tc) {
+  return ta >= 0 && tb >= 0 && tc >= 0 && (ta + tb + tc) % 2 == 0 &&
+         tc >= std::abs(ta - tb) && tc <= ta + tb;
+}
+
+bool IsValid3j(int tj1, int tj2, int tj3, int tm1, int tm2, int tm3) {
+  return IsTriangle(tj1, tj2, tj3) && tm1 + tm2 + tm3 == 0 &&
+         std::abs(tm1) <= tj1 && std::abs(tm2) <= tj2 &&
+         std::abs(tm3) <= tj3 && (tj1 + tm1) % 2 == 0 &&
+         (tj2 + tm2) % 2 == 0 && (tj3 + tm3) % 2 == 0;
+}
+
+bool IsValid6j(int tj1, int tj2, int tj3, int tj4, int tj5, int tj6) {
+  return IsTriangle(tj1, tj2, tj3) && IsTriangle(tj1, tj5, tj6) &&
+         IsTriangle(tj4, tj2, tj6) && IsTriangle(tj4, tj5, tj3);
+}
+
+// Keys hold 10 bits per angular momentum (2j <= 1023)
+constexpr int MaxCachedTwoJ = 1023;
+
+// Sorts the columns in descending order, returns the number of swaps
+int SortColumns(std::array<Column_t, 3>& cols) {
+  int swaps = 0;
+  auto order = [&](int a, int b) {
+    if (cols[a] < cols[b]) {
+      std::swap(cols[a], cols[b]);
+      swaps++;
+    }
+  };
+  order(0, 1);
+  order(1, 2);
+  order(0, 1);
+  return swaps;
+}
+
+std::uint64_t Pack3j(const std::array<Column_t, 3>& cols) {
+  // m3 follows from m1 + m2 + m3 = 0
+  return std::uint64_t(cols[0].first) | std::uint64_t(cols[1].first) << 10 |
+         std::uint64_t(cols[2].first) << 20 |
+         std::uint64_t(cols[0].second + 1024) << 30 |
+         std::uint64_t(cols[1].second + 1024) << 41;
+}
+
+// Canonical key of a valid 3j symbol. An odd permutation of the columns and
+// the reversal of all projections both yield the factor (-1)^(j1 + j2 + j3).
+std::uint64_t Canonical3j(int tj1, int tj2, int tj3, int tm1, int tm2,
+                          int tm3, bool& negate) {
+  std::array<Column_t, 3> cols = {{{tj1, tm1}, {tj2, tm2}, {tj3, tm3}}};
+  std::array<Column_t, 3> flipped = {{{tj1, -tm1}, {tj2, -tm2}, {tj3, -tm3}}};
+  const int swaps = SortColumns(cols);
+  const int flippedSwaps = SortColumns(flipped) + 1;
+  const std::uint64_t key = Pack3j(cols);
+  const std::uint64_t flippedKey = Pack3j(flipped);
+
+  const bool oddJ = ((tj1 + tj2 + tj3) / 2) % 2 != 0;
+  if (flippedKey > key) {
+    negate = oddJ && flippedSwaps % 2 != 0;
+    return flippedKey;
+  }
+  negate = oddJ && swaps % 2 != 0;
+  return key;
+}
+
+// Canonical key of a 6j symbol: maximum over the 24 tetrahedral variants
+// (column permutations and exchange of upper and lower entries in two
+// columns), all of which have the same value.
+std::uint64_t Canonical6j(int tj1, int tj2, int tj3, int tj4, int tj5,
+                          int tj6) {
+  constexpr int perms[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+                               {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+  constexpr bool flips[4][3] = {{false, false, false},
+                                {true, true, false},
+                                {true, false, true},
+                                {false, true, true}};
+  const Column_t cols[3] = {{tj1, tj4}, {tj2, tj5}, {tj3, tj6}};
+
+  std::uint64_t best = 0;
+  for (const auto& perm : perms) {
+    for (const auto& flip : flips) {
+      std::uint64_t key = 0;
+      for (int c = 0; c < 3; c++) {
+        auto col = cols[perm[c]];
+        if (flip[c]) std::swap(col.first, col.second);
+        key |= std::uint64_t(col.first) << (10 * c);
+        key |= std::uint64_t(col.second) << (10 * c + 30);
+      }
+      best = std::max(best, key);
+    }
+  }
+  return best;
+}
+
+// Symbols up to this 2j are evaluated with the Racah formulas. Beyond, the
+// alternating sums suffer from cancellation and the three-term recursions of
+// Schulten and Gordon (J. Math. Phys. 16, 1961 (1975)) are used instead.
+constexpr int MaxRacahTwoJ = 40;
+
+// ln Delta(a, b, c) of the triangle coefficient
+double LogTriangle(int ta, int tb, int tc) {
+  return 0.5 * (WignerSymbols::LogFactorial((ta + tb - tc) / 2) +
+                WignerSymbols::LogFactorial((ta - tb + tc) / 2) +
+                WignerSymbols::LogFactorial((-ta + tb + tc) / 2) -
+                WignerSymbols::LogFactorial((ta + tb + tc) / 2 + 1));
+}
+
+double Racah3j(int tj1, int tj2, int tj3, int tm1, int tm2, int tm3) {
+  auto lf = [](int n) { return WignerSymbols::LogFactorial(n); };
+  const double logPrefactor =
+      LogTriangle(tj1, tj2, tj3) +
+      0.5 * (lf((tj1 + tm1) / 2) + lf((tj1 - tm1) / 2) + lf((tj2 + tm2) / 2) +
+             lf((tj2 - tm2) / 2) + lf((tj3 + tm3) / 2) + lf((tj3 - tm3) / 2));
+
+  const int a = (tj3 - tj2 + tm1) / 2;
+  const int b = (tj3 - tj1 - tm2) / 2;
+  const int c = (tj1 + tj2 - tj3) / 2;
+  const int d = (tj1 - tm1) / 2;
+  const int e = (tj2 + tm2) / 2;
+  const int kMin = std::max({0, -a, -b});
+  const int kMax = std::min({c, d, e});
+
+  double sum = 0;
+  for (int k = kMin; k <= kMax; k++) {
+    const double logTerm = lf(k) + lf(a + k) + lf(b + k) + lf(c - k) +
+                           lf(d - k) + lf(e - k);
+    const double term = std::exp(logPrefactor - logTerm);
+    sum += (k % 2 == 0) ? term : -term;
+  }
+
+  const int phase = (tj1 - tj2 - tm3) / 2;
+  return (phase % 2 == 0) ? sum : -sum;
+}
+
+double Racah6j(int tj1, int tj2, int tj3, int tj4, int tj5, int tj6) {
+  auto lf = [](int n) { return WignerSymbols::LogFactorial(n); };
+  const double logPrefactor =
+      LogTriangle(tj1, tj2, tj3) + LogTriangle(tj1, tj5, tj6) +
+      LogTriangle(tj4, tj2, tj6) + LogTriangle(tj4, tj5, tj3);
+
+  const int a1 = (tj1 + tj2 + tj3) / 2;
+  const int a2 = (tj1 + tj5 + tj6) / 2;
+  const int a3 = (tj4 + tj2 + tj6) / 2;
+  const int a4 = (tj4 + tj5 + tj3) / 2;
+  const int b1 = (tj1 + tj2 + tj4 + tj5) / 2;
+  const int b2 = (tj2 + tj3 + tj5 + tj6) / 2;
+  const int b3 = (tj3 + tj1 + tj6 + tj4) / 2;
+  const int tMin = std::max({a1, a2, a3, a4});
+  const int tMax = std::min({b1, b2, b3});
+
+  double sum = 0;
+  for (int t = tMin; t <= tMax; t++) {
+    const double logTerm = lf(t + 1) - lf(t - a1) - lf(t - a2) - lf(t - a3) -
+                           lf(t - a4) - lf(b1 - t) - lf(b2 - t) - lf(b3 - t);
+    const double term = std::exp(logPrefactor + logTerm);
+    sum += (t % 2 == 0) ? term : -term;
+  }
+  return sum;
+}
+
+// Solves the recursion
+//   j X(j+1) f(j+1) + Y(j) f(j) + (j+1) X(j) f(j-1) = 0
+// for j = jMin, ..., jMin + n - 1 (f[0] and f[1] given for jMin == 0).
+// The solution is computed forwards up to the first maximum of |f| (stable
+// in the lower classically forbidden region) and backwards from the upper
+// end, both parts are matched at the maximum. The result is unnormalized.
+template <typename FuncX, typename FuncY>
+void SolveRecursion(double jMin, std::vector<double>& f, FuncX&& x,
+                    FuncY&& y) {
+  constexpr double huge = 1e150;
+  const std::size_t n = f.size();
+  if (n == 1) return;
+
+  std::size_t match = n - 1;
+  std::size_t i = 1;
+  if (jMin != 0) {
+    f[0] = 1;
+    f[1] = -y(jMin) / (jMin * x(jMin + 1));
+  }
+  for (; i + 1 < n; i++) {
+    if (std::abs(f[i]) < std::abs(f[i - 1])) break;
+    const double j = jMin + i;
+    f[i + 1] = -(y(j) * f[i] + (j + 1) * x(j) * f[i - 1]) / (j * x(j + 1));
+    if (std::abs(f[i + 1]) > huge) {
+      for (std::size_t k = 0; k <= i + 1; k++) f[k] /= huge;
+    }
+  }
+  if (std::abs(f[i]) >= std::abs(f[i - 1])) return;
+  match = i - 1;
+
+  std::vector<double> g(n + 1, 0.0);
+  g[n - 1] = 1;
+  for (std::size_t k = n - 1; k > match; k--) {
+    const double j = jMin + k;
+    g[k - 1] = -(j * x(j + 1) * g[k + 1] + y(j) * g[k]) / ((j + 1) * x(j));
+    if (std::abs(g[k - 1]) > huge) {
+      for (std::size_t l = k - 1; l < n; l++) g[l] /= huge;
+    }
+  }
+
+  const double scale = f[match] / g[match];
+  for (std::size_t k = match + 1; k < n; k++) f[k] = scale * g[k];
+}
+
+// (j1 j2 j3; m1 m2 m3) for all j1 (returns 2 j1_min, f[k] has j1_min + k)
+int Family3j(int tj2, int tj3, int tm2, int tm3, std::vector<double>& f) {
+  const int tm1 = -tm2 - tm3;
+  const int tjMin = std::max(std::abs(tj2 - tj3), std::abs(tm1));
+  const int tjMax = tj2 + tj3;
+  if (tjMin > tjMax) {
+    f.clear();
+    return tjMin;
+  }
+  f.assign((tjMax - tjMin) / 2 + 1, 0.0);
+
+  const double j2 = tj2 / 2.0, j3 = tj3 / 2.0;
+  const double m1 = tm1 / 2.0, m2 = tm2 / 2.0, m3 = tm3 / 2.0;
+  auto x = [&](double j) {
+    return std::sqrt((j * j - (j2 - j3) * (j2 - j3)) *
+                     ((j2 + j3 + 1) * (j2 + j3 + 1) - j * j) *
+                     (j * j - m1 * m1));
+  };
+  auto y = [&](double j) {
+    return -(2 * j + 1) * (j2 * (j2 + 1) * m1 - j3 * (j3 + 1) * m1 -
+                           j * (j + 1) * (m3 - m2));
+  };
+  // j1 = 0 requires j2 == j3 and m1 == 0, the recursion is degenerate
+  // (0 j j; 0 m -m) = (-1)^(j-m) / sqrt(2j + 1)
+  // (1 j j; 0 m -m) = (-1)^(j-m) m / sqrt(j (j + 1) (2j + 1))
+  f[0] = 1;
+  if (tjMin == 0 && f.size() > 1) f[1] = m2 / std::sqrt(j2 * (j2 + 1));
+  SolveRecursion(tjMin / 2.0, f, x, y);
+
+  // sum (2 j1 + 1) f^2 = 1, the stretched symbol (a single Racah term)
+  // fixes the sign
+  double norm = 0;
+  for (std::size_t k = 0; k < f.size(); k++)
+    norm += (tjMin + 2.0 * k + 1) * f[k] * f[k];
+  norm = 1 / std::sqrt(norm);
+  if ((Racah3j(tjMax, tj2, tj3, tm1, tm2, tm3) < 0) != (f.back() < 0))
+    norm = -norm;
+  for (auto& v : f) v *= norm;
+  return tjMin;
+}
+
+// {j1 j2 j3; l1 l2 l3} for all j1 (returns 2 j1_min, f[k] has j1_min + k)
+int Family6j(int tj2, int tj3, int tl1, int tl2, int tl3,
+             std::vector<double>& f) {
+  const int tjMin = std::max(std::abs(tj2 - tj3), std::abs(tl2 - tl3));
+  const int tjMax = std::min(tj2 + tj3, tl2 + tl3);
+  if (tjMin > tjMax || (tj2 + tj3 + tl2 + tl3) % 2 != 0 ||
+      !IsTriangle(tl1, tj2, tl3) || !IsTriangle(tl1, tl2, tj3)) {
+    f.clear();
+    return tjMin;
+  }
+  f.assign((tjMax - tjMin) / 2 + 1, 0.0);
+
+  const double j2 = tj2 / 2.0, j3 = tj3 / 2.0;
+  const double l1 = tl1 / 2.0, l2 = tl2 / 2.0, l3 = tl3 / 2.0;
+  auto x = [&](double j) {
+    return std::sqrt((j * j - (j2 - j3) * (j2 - j3)) *
+                     ((j2 + j3 + 1) * (j2 + j3 + 1) - j * j) *
+                     (j * j - (l2 - l3) * (l2 - l3)) *
+                     ((l2 + l3 + 1) * (l2 + l3 + 1) - j * j));
+  };
+  auto y = [&](double j) {
+    const double jj = j * (j + 1), jj2 = j2 * (j2 + 1), jj3 = j3 * (j3 + 1);
+    const double ll1 = l1 * (l1 + 1), ll2 = l2 * (l2 + 1),
+                 ll3 = l3 * (l3 + 1);
+    return (2 * j + 1) * (jj * (-jj + jj2 + jj3 - 2 * ll1) +
+                          ll2 * (jj + jj2 - jj3) + ll3 * (jj - jj2 + jj3));
+  };
+  // j1 = 0 requires j2 == j3 and l2 == l3, the recursion is degenerate
+  // {0 j j; l1 l l} = (-1)^(j+l+l1) / sqrt((2j + 1)(2l + 1))
+  // {1 j j; l1 l l} = (-1)^(j+l+l1+1) (j(j+1) + l(l+1) - l1(l1+1))
+  //                   / (2 sqrt(j(j+1) l(l+1))) * {0 j j; l1 l l}
+  f[0] = 1;
+  if (tjMin == 0 && f.size() > 1) {
+    f[1] = -(j2 * (j2 + 1) + l2 * (l2 + 1) - l1 * (l1 + 1)) /
+           (2 * std::sqrt(j2 * (j2 + 1) * l2 * (l2 + 1)));
+  }
+  SolveRecursion(tjMin / 2.0, f, x, y);
+
+  // sum (2 j1 + 1)(2 l1 + 1) f^2 = 1, sgn f(j1_max) = (-1)^(j2+j3+l2+l3)
+  double norm = 0;
+  for (std::size_t k = 0; k < f.size(); k++)
+    norm += (tjMin + 2.0 * k + 1) * (tl1 + 1) * f[k] * f[k];
+  norm = 1 / std::sqrt(norm);
+  if ((((tj2 + tj3 + tl2 + tl3) / 2) % 2 != 0) != (f.back() < 0))
+    norm = -norm;
+  for (auto& v : f) v *= norm;
+  return tjMin;
+}
+
+}  // namespace
+
+WignerSymbols::WignerSymbols(std::size_t shards)
+    : m_shardCount(std::max<std::size_t>(shards, 1)),
+      m_shards(2 * m_shardCount) {}
+
+double WignerSymbols::LogFactorial(int n) {
+  constexpr int tableSize = 16384;
+  static const std::vector<double> table = [] {
+    std::vector<double> tab(tableSize);
+    tab[0] = 0.0;
+    for (int i = 1; i < tableSize; i++) tab[i] = tab[i - 1] + std::log(i);
+    return tab;
+  }();
+  if (n < tableSize) return table[n];
+
+  // Stirling series (converged to machine precision for n >= tableSize)
+  const double x = n + 1.0;
+  return (x - 0.5) * std::log(x) - x + 0.5 * std::log(TwoPi_v) +
+         1 / (12 * x) - 1 / (360 * x * x * x);
+}
+
+double WignerSymbols::Compute3j(int tj1, int tj2, int tj3, int tm1, int tm2,
+                                int tm3) {
+  if (!IsValid3j(tj1, tj2, tj3, tm1, tm2, tm3)) return 0.0;
+  if (std::max({tj1, tj2, tj3}) <= MaxRacahTwoJ)
+    return Racah3j(tj1, tj2, tj3, tm1, tm2, tm3);
+
+  std::vector<double> family;
+  const int tjMin = Family3j(tj2, tj3, tm2, tm3, family);
+  return family[(tj1 - tjMin) / 2];
+}
+
+double WignerSymbols::Compute6j(int tj1, int tj2, int tj3, int tj4, int tj5,
+                                int tj6) {
+  if (!IsValid6j(tj1, tj2, tj3, tj4, tj5, tj6)) return 0.0;
+  if (std::max({tj1, tj2, tj3, tj4, tj5, tj6}) <= MaxRacahTwoJ)
+    return Racah6j(tj1, tj2, tj3, tj4, tj5, tj6);
+
+  std::vector<double> family;
+  const int tjMin = Family6j(tj2, tj3, tj4, tj5, tj6, family);
+  return family[(tj1 - tjMin) / 2];
+}
+
+WignerSymbols::Shard& WignerSymbols::GetShard(SymbolType type,
+                                              std::uint64_t key) {
+  // keys are densely packed bit fields: mix before taking the remainder
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDull;
+  key ^= key >> 33;
+  return m_shards[type * m_shardCount + key % m_shardCount];
+}
+
+std::optional<double> WignerSymbols::Find(SymbolType type,
+                                          std::uint64_t key) const {
+  auto& shard = const_cast<WignerSymbols*>(this)->GetShard(type, key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto it = shard.values.find(key);
+  if (it == shard.values.end()) return std::nullopt;
+  return it->second;
+}
+
+void WignerSymbols::Insert(SymbolType type, std::uint64_t key, double value) {
+  auto& shard = GetShard(type, key);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  shard.values.emplace(key, value);
+}
+
+double WignerSymbols::Wigner3j(double j1, double j2, double j3, double m1,
+                               double m2, double m3) {
+  const int tj1 = ToTwice(j1), tj2 = ToTwice(j2), tj3 = ToTwice(j3);
+  const int tm1 = ToTwice(m1), tm2 = ToTwice(m2), tm3 = ToTwice(m3);
+  if (!IsValid3j(tj1, tj2, tj3, tm1, tm2, tm3)) return 0.0;
+  if (std::max({tj1, tj2, tj3}) > MaxCachedTwoJ)
+    return Compute3j(tj1, tj2, tj3, tm1, tm2, tm3);
+
+  bool negate = false;
+  const auto key = Canonical3j(tj1, tj2, tj3, tm1, tm2, tm3, negate);
+  if (auto value = Find(Symbol3j, key)) return negate ? -*value : *value;
+
+  // Evaluated without holding a lock (concurrent misses compute the same
+  // values twice, which is harmless). The recursion yields the whole family
+  // of j1 at once, all of which are cached.
+  double value;
+  if (std::max({tj1, tj2, tj3}) <= MaxRacahTwoJ) {
+    value = Racah3j(tj1, tj2, tj3, tm1, tm2, tm3);
+    Insert(Symbol3j, key, negate ? -value : value);
+  } else {
+    std::vector<double> family;
+    const int tjMin = Family3j(tj2, tj3, tm2, tm3, family);
+    for (std::size_t k = 0; k < family.size(); k++) {
+      bool neg = false;
+      const int tj = tjMin + 2 * static_cast<int>(k);
+      const auto famKey = Canonical3j(tj, tj2, tj3, tm1, tm2, tm3, neg);
+      Insert(Symbol3j, famKey, neg ? -family[k] : family[k]);
+    }
+    value = family[(tj1 - tjMin) / 2];
+  }
+  return value;
+}
+
+double WignerSymbols::Wigner6j(double j1, double j2, double j3, double j4,
+                               double j5, double j6) {
+  const int tj1 = ToTwice(j1), tj2 = ToTwice(j2), tj3 = ToTwice(j3);
+  const int tj4 = ToTwice(j4), tj5 = ToTwice(j5), tj6 = ToTwice(j6);
+  if (!IsValid6j(tj1, tj2, tj3, tj4, tj5, tj6)) return 0.0;
+  if (std::max({tj1, tj2, tj3, tj4, tj5, tj6}) > MaxCachedTwoJ)
+    return Compute6j(tj1, tj2, tj3, tj4, tj5, tj6);
+
+  const auto key = Canonical6j(tj1, tj2, tj3, tj4, tj5, tj6);
+  if (auto value = Find(Symbol6j, key)) return *value;
+
+  double value;
+  if (std::max({tj1, tj2, tj3, tj4, tj5, tj6}) <= MaxRacahTwoJ) {
+    value = Racah6j(tj1, tj2, tj3, tj4, tj5, tj6);
+    Insert(Symbol6j, key, value);
+  } else {
+    std::vector<double> family;
+    const int tjMin = Family6j(tj2, tj3, tj4, tj5, tj6, family);
+    for (std::size_t k = 0; k < family.size(); k++) {
+      const int tj = tjMin + 2 * static_cast<int>(k);
+      Insert(Symbol6j, Canonical6j(tj, tj2, tj3, tj4, tj5, tj6), family[k]);
+    }
+    value = family[(tj1 - tjMin) / 2];
+  }
+  return value;
+}
+
+double WignerSymbols::ClebschGordan(double j1, double m1, double j2,
+                                    double m2, double J, double M) {
+  // <j1 m1; j2 m2 | J M> = (-1)^(j1 - j2 + M) sqrt(2J + 1)
+  //                        (j1 j2 J; m1 m2 -M)
+  const double value = Wigner3j(j1, j2, J, m1, m2, -M);
+  const int phase = (ToTwice(j1) - ToTwice(j2) + ToTwice(M)) / 2;
+  const double factor = std::sqrt(ToTwice(J) + 1.0);
+  return (phase % 2 == 0) ? factor * value : -factor * value;
+}
+
+std::size_t WignerSymbols::GetCacheSize() const {
+  std::size_t size = 0;
+  for (const auto& shard : m_shards) {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    size += shard.values.size();
+  }
+  return size;
+}
+
+void WignerSymbols::ClearCache() {
+  for (auto& shard : m_shards) {
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.values.clear();
+  }
+}
+
+bool WignerSymbols::Save(H5Group& group, const std::string& name) const {
+  group.Remove(name);
+  auto cacheGroup = group.OpenSubgroup(name);
+  if (!cacheGroup) return false;
+
+  const char* typeNames[2] = {"wigner3j", "wigner6j"};
+  for (int type = 0; type < 2; type++) {
+    std::vector<std::pair<std::uint64_t, double>> entries;
+    for (std::size_t s = 0; s < m_shardCount; s++) {
+      const auto& shard = m_shards[type * m_shardCount + s];
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      entries.insert(entries.end(), shard.values.begin(), shard.values.end());
+    }
+    // HDF5 does not write empty datasets
+    if (entries.empty()) continue;
+    // sorted such that equal caches produce equal files
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<std::uint64_t> keys(entries.size());
+    std::vector<double> values(entries.size());
+    for (std::size_t i = 0; i < entries.size(); i++) {
+      keys[i] = entries[i].first;
+      values[i] = entries[i].second;
+    }
+
+    auto typeGroup = cacheGroup->OpenSubgroup(typeNames[type]);
+    if (!typeGroup || !typeGroup->CreateDataset("keys", keys) ||
+        !typeGroup->CreateDataset("values", values))
+      return false;
+  }
+  return true;
+}
+
+bool WignerSymbols::Load(H5Group& group, const std::string& name) {
+  if (!group.HasSubgroup(name)) return false;
+  auto cacheGroup = group.OpenSubgroup(name);
+  if (!cacheGroup) return false;
+
+  const char* typeNames[2] = {"wigner3j", "wigner6j"};
+  for (int type = 0; type < 2; type++) {
+    if (!cacheGroup->HasSubgroup(typeNames[type])) continue;
+    auto typeGroup = cacheGroup->OpenSubgroup(typeNames[type]);
+    if (!typeGroup) return false;
+    auto keyDs = typeGroup->OpenExistingDataset("keys");
+    auto valueDs = typeGroup->OpenExistingDataset("values");
+    if (!keyDs || !valueDs) return false;
+    auto keys = keyDs->Get<std::vector<std::uint64_t>>();
+    auto values = valueDs->Get<std::vector<double>>();
+    if (!keys || !values || keys->size() != values->size()) return false;
+
+    for (std::size_t i = 0; i < keys->size(); i++) {
+      auto& shard = GetShard(static_cast<SymbolType>(type), (*keys)[i]);
+      std::unique_lock<std::shared_mutex> lock(shard.mutex);
+      shard.values.emplace((*keys)[i], (*values)[i]);
+    }
+  }
+  return true;
+}
+
+}  // namespace QPT
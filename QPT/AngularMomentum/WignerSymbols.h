@@ -0,0 +1,75 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_ANGULARMOMENTUM_WIGNERSYMBOLS_H_
+#define QPT_ANGULARMOMENTUM_WIGNERSYMBOLS_H_
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+
+namespace QPT {
+
+// Wigner 3j and 6j symbols and Clebsch-Gordan coefficients.
+// Small symbols are evaluated with the Racah formulas using a table of
+// logarithmic factorials (no overflow). Large symbols are computed with the
+// Schulten-Gordon recursions, which yield a whole family of symbols with
+// varying j1 at once (no cancellation in alternating sums). Results are
+// memoized in a concurrent cache: every symbol is mapped onto a canonical
+// representative of its symmetry class (12 classical symmetries of the 3j
+// symbol, 24 tetrahedral symmetries of the 6j symbol) such that symmetric
+// variants share one entry. The cache consists of independently locked
+// shards and may be used from many threads at the same time.
+// Angular momenta and projections are given as (half-)integral doubles.
+class WignerSymbols {
+ public:
+  explicit WignerSymbols(std::size_t shards = 64);
+
+  double Wigner3j(double j1, double j2, double j3, double m1, double m2,
+                  double m3);
+  double Wigner6j(double j1, double j2, double j3, double j4, double j5,
+                  double j6);
+  // <j1 m1; j2 m2 | J M>
+  double ClebschGordan(double j1, double m1, double j2, double m2, double J,
+                       double M);
+
+  // Uncached evaluation, arguments are twice the angular momenta
+  static double Compute3j(int tj1, int tj2, int tj3, int tm1, int tm2,
+                          int tm3);
+  static double Compute6j(int tj1, int tj2, int tj3, int tj4, int tj5,
+                          int tj6);
+  // ln(n!)
+  static double LogFactorial(int n);
+
+  std::size_t GetCacheSize() const;
+  void ClearCache();
+
+  // Stores the cache in the subgroup name of group (replaces existing data)
+  bool Save(H5Group& group, const std::string& name) const;
+  // Adds the entries stored in the subgroup name of group to the cache
+  bool Load(H5Group& group, const std::string& name);
+
+ private:
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::uint64_t, double> values;
+  };
+  // 3j and 6j symbols use separate shards (keys are not distinct)
+  enum SymbolType { Symbol3j = 0, Symbol6j = 1 };
+
+  Shard& GetShard(SymbolType type, std::uint64_t key);
+  std::optional<double> Find(SymbolType type, std::uint64_t key) const;
+  void Insert(SymbolType type, std::uint64_t key, double value);
+
+ private:
+  std::size_t m_shardCount;
+  std::vector<Shard> m_shards;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_ANGULARMOMENTUM_WIGNERSYMBOLS_H_
@@ -0,0 +1,439 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_BDFINTEGRATOR_H_
+#define QPT_DYNAMICS_BDFINTEGRATOR_H_
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+// Implicit variable order (1 - 5), variable step size integrator for stiff
+// problems based on the numerical differentiation formulas (NDF, Shampine
+// and Reichelt, SIAM J. Sci. Comput. 18, 1 (1997)) in the quasi-constant
+// step size formulation with backward differences. The Newton iterations
+// solve with I - c J, where the sparse Jacobian J is only re-evaluated if
+// the iterations fail to converge and the LU decomposition is only
+// recomputed if the step size or the order changes. The symbolic analysis
+// of the sparse LU decomposition is reused as long as the sparsity pattern
+// of the Jacobian stays the same. The history is kept between calls to
+// Integrate that continue at the end of the previous call.
+template <typename Vector_t>
+class BdfIntegrator {
+ public:
+  using Scalar_t = typename Vector_t::Scalar;
+  using Jacobian_t = Eigen::SparseMatrix<Scalar_t>;
+
+  void SetTolerances(double absTol, double relTol) {
+    m_absTol = absTol;
+    m_relTol = relTol;
+  }
+  void SetInitialStepSize(double h) { m_hInit = h; }
+  void SetMaxStepSize(double h) { m_hMax = h; }
+  void SetMaxOrder(int order) { m_maxOrder = std::clamp(order, 1, MaxOrder); }
+  // The Jacobian is evaluated once at the start and never updated (e.g. for
+  // linear problems)
+  void SetConstantJacobian(bool constant) { m_constantJacobian = constant; }
+  // Discards the history, the next call to Integrate restarts at order 1
+  void Reset() { m_initialized = false; }
+
+  double GetStepSize() const { return m_h; }
+  int GetOrder() const { return m_order; }
+  std::size_t GetStepCount() const { return m_steps; }
+  std::size_t GetRejectedStepCount() const { return m_rejected; }
+  std::size_t GetJacobianCount() const { return m_jacobians; }
+  std::size_t GetFactorizationCount() const { return m_factorizations; }
+
+  // Integrates dy/dt = func(t, y, dydt) with the Jacobian jac(t, y, J)
+  // (J = d func / d y) from t to tEnd (t is updated). Returns false if the
+  // step size underflows.
+  template <typename Func, typename Jac>
+  bool Integrate(Func&& func, Jac&& jac, double& t, double tEnd, Vector_t& y);
+
+  // Same as above but passes the solution at outputs + 1 equidistant times
+  // (including t and tEnd) to observer(t, y). The samples are obtained by
+  // dense output, i.e. the step size is not limited by the sampling.
+  template <typename Func, typename Jac, typename Observer>
+  bool Integrate(Func&& func, Jac&& jac, double& t, double tEnd, Vector_t& y,
+                 std::size_t outputs, Observer&& observer);
+
+  // Dense output: interpolating polynomial of the current order through the
+  // last steps. Accurate within the last accepted step.
+  void Interpolate(double t, Vector_t& y) const;
+
+ private:
+  static constexpr int MaxOrder = 5;
+  static constexpr int NewtonMaxIterations = 4;
+
+  template <typename Func, typename Jac>
+  void Initialize(Func&& func, Jac&& jac, double t, double tEnd,
+                  const Vector_t& y);
+  template <typename Func, typename Jac>
+  bool Step(Func&& func, Jac&& jac, double tEnd);
+  template <typename Func>
+  bool SolveNewton(Func&& func, double t, double c, int& iterations);
+
+  // transforms the differences to the step size factor * h
+  void RescaleHistory(double factor);
+  bool Factorize(double c);
+  void UpdateScale(const Vector_t& y);
+  double Norm(const Vector_t& v) const;
+
+ private:
+  using SparseLU_t = Eigen::SparseLU<Jacobian_t, Eigen::COLAMDOrdering<int>>;
+  using Coefficients_t = std::array<double, MaxOrder + 2>;
+
+  double m_absTol = 1e-8;
+  double m_relTol = 1e-6;
+  double m_hInit = 0;
+  double m_hMax = 0;
+  int m_maxOrder = MaxOrder;
+  bool m_constantJacobian = false;
+
+  std::size_t m_steps = 0;
+  std::size_t m_rejected = 0;
+  std::size_t m_jacobians = 0;
+  std::size_t m_factorizations = 0;
+
+  // state of the method
+  bool m_initialized = false;
+  double m_t = 0;
+  double m_h = 0;
+  int m_order = 1;
+  int m_equalSteps = 0;
+  double m_newtonTol = 0;
+  Coefficients_t m_gamma{}, m_alpha{}, m_errorConst{};
+  // backward differences D^j y_n (MaxOrder + 3 vectors)
+  std::vector<Vector_t> m_diff, m_diffTmp;
+
+  // linear algebra
+  Jacobian_t m_jacobian, m_identity, m_iteration;
+  std::vector<typename Jacobian_t::StorageIndex> m_outerPattern,
+      m_innerPattern;
+  SparseLU_t m_lu;
+  bool m_analyzed = false;
+  bool m_factorized = false;
+
+  Vector_t m_f, m_yPred, m_yNew, m_psi, m_d, m_rhs, m_dy;
+  Eigen::VectorXd m_scale;
+};
+
+// Template function definitions
+template <typename Vector_t>
+template <typename Func, typename Jac>
+void BdfIntegrator<Vector_t>::Initialize(Func&& func, Jac&& jac, double t,
+                                         double tEnd, const Vector_t& y) {
+  // NDF coefficients (kappa = 0 would be the plain BDF)
+  constexpr double kappa[MaxOrder + 1] = {0,       -0.1850, -1.0 / 9,
+                                          -0.0823, -0.0415, 0};
+  m_gamma[0] = 0;
+  for (int k = 1; k <= MaxOrder; k++) m_gamma[k] = m_gamma[k - 1] + 1.0 / k;
+  for (int k = 0; k <= MaxOrder; k++) {
+    m_alpha[k] = (1 - kappa[k]) * m_gamma[k];
+    m_errorConst[k] = kappa[k] * m_gamma[k] + 1.0 / (k + 1);
+  }
+  m_newtonTol = std::max(10 * std::numeric_limits<double>::epsilon() /
+                             m_relTol,
+                         std::min(0.03, std::sqrt(m_relTol)));
+
+  const Eigen::Index n = y.size();
+  m_diff.resize(MaxOrder + 3);
+  m_diffTmp.resize(MaxOrder + 1);
+  for (auto& v : m_diff) v.setZero(n);
+  for (auto* v : {&m_f, &m_yPred, &m_yNew, &m_psi, &m_d, &m_rhs, &m_dy})
+    v->resize(n);
+  if (m_identity.rows() != n) {
+    m_identity.resize(n, n);
+    m_identity.setIdentity();
+    m_analyzed = false;
+  }
+
+  m_t = t;
+  func(t, y, m_f);
+  jac(t, y, m_jacobian);
+  m_jacobians++;
+  m_factorized = false;
+
+  // initial step size (Hairer, Norsett and Wanner, Sec. II.4)
+  double h = m_hInit;
+  if (h <= 0) {
+    UpdateScale(y);
+    const double d0 = Norm(y), d1 = Norm(m_f);
+    const double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+    m_yNew = y + h0 * m_f;
+    func(t + h0, m_yNew, m_dy);
+    m_dy -= m_f;
+    const double d2 = Norm(m_dy) / h0;
+    const double h1 = (d1 <= 1e-15 && d2 <= 1e-15)
+                          ? std::max(1e-6, h0 * 1e-3)
+                          : std::sqrt(0.01 / std::max(d1, d2));
+    h = std::min(100 * h0, h1);
+  }
+  h = std::min(h, tEnd - t);
+  if (m_hMax > 0) h = std::min(h, m_hMax);
+
+  m_h = h;
+  m_order = 1;
+  m_equalSteps = 0;
+  m_diff[0] = y;
+  m_diff[1] = h * m_f;
+  m_initialized = true;
+}
+
+template <typename Vector_t>
+void BdfIntegrator<Vector_t>::RescaleHistory(double factor) {
+  // D[0..k] = (R(factor) R(1))^T D[0..k] with
+  //   R_ij = prod_{m = 1}^{i} (m - 1 - factor * j) / m
+  const int k = m_order;
+  Eigen::MatrixXd R(k + 1, k + 1), U(k + 1, k + 1);
+  for (int j = 0; j <= k; j++) {
+    R(0, j) = U(0, j) = 1;
+    for (int i = 1; i <= k; i++) {
+      R(i, j) = R(i - 1, j) * (i - 1 - factor * j) / i;
+      U(i, j) = U(i - 1, j) * (i - 1 - j) / static_cast<double>(i);
+    }
+  }
+  const Eigen::MatrixXd RU = R * U;
+  for (int i = 0; i <= k; i++) {
+    m_diffTmp[i] = RU(0, i) * m_diff[0];
+    for (int j = 1; j <= k; j++) m_diffTmp[i] += RU(j, i) * m_diff[j];
+  }
+  for (int i = 0; i <= k; i++) m_diff[i].swap(m_diffTmp[i]);
+  m_h *= factor;
+  m_equalSteps = 0;
+  m_factorized = false;
+}
+
+template <typename Vector_t>
+bool BdfIntegrator<Vector_t>::Factorize(double c) {
+  QPT_PROFILE_SCOPE("BdfIntegrator::Factorize");
+  // I - c J keeps the pattern as long as the pattern of J is the same
+  m_iteration = m_identity - Scalar_t(c) * m_jacobian;
+  m_iteration.makeCompressed();
+
+  const auto nnz = m_iteration.nonZeros();
+  const auto outer = m_iteration.outerIndexPtr();
+  const auto inner = m_iteration.innerIndexPtr();
+  const bool samePattern =
+      m_analyzed && m_innerPattern.size() == static_cast<std::size_t>(nnz) &&
+      std::equal(outer, outer + m_iteration.outerSize() + 1,
+                 m_outerPattern.begin()) &&
+      std::equal(inner, inner + nnz, m_innerPattern.begin());
+  if (!samePattern) {
+    m_lu.analyzePattern(m_iteration);
+    m_outerPattern.assign(outer, outer + m_iteration.outerSize() + 1);
+    m_innerPattern.assign(inner, inner + nnz);
+    m_analyzed = true;
+  }
+  m_lu.factorize(m_iteration);
+  m_factorizations++;
+  m_factorized = m_lu.info() == Eigen::Success;
+  return m_factorized;
+}
+
+template <typename Vector_t>
+void BdfIntegrator<Vector_t>::UpdateScale(const Vector_t& y) {
+  m_scale.resize(y.size());
+  for (Eigen::Index i = 0; i < y.size(); i++)
+    m_scale[i] = m_absTol + m_relTol * std::abs(y[i]);
+}
+
+template <typename Vector_t>
+double BdfIntegrator<Vector_t>::Norm(const Vector_t& v) const {
+  double sum = 0;
+  for (Eigen::Index i = 0; i < v.size(); i++) {
+    const double e = std::abs(v[i]) / m_scale[i];
+    sum += e * e;
+  }
+  return std::sqrt(sum / std::max<Eigen::Index>(v.size(), 1));
+}
+
+template <typename Vector_t>
+template <typename Func>
+bool BdfIntegrator<Vector_t>::SolveNewton(Func&& func, double t, double c,
+                                          int& iterations) {
+  // solves y - c f(t, y) - psi = 0 starting from the predictor, m_d
+  // accumulates the correction y - yPred
+  m_yNew = m_yPred;
+  m_d.setZero();
+  double dyNormOld = 0;
+  for (int k = 0; k < NewtonMaxIterations; k++) {
+    iterations = k + 1;
+    func(t, m_yNew, m_f);
+    if (!m_f.allFinite()) return false;
+    m_rhs = Scalar_t(c) * m_f - m_psi - m_d;
+    m_dy = m_lu.solve(m_rhs);
+    const double dyNorm = Norm(m_dy);
+
+    // estimated contraction rate of the iteration
+    const double rate = (k > 0) ? dyNorm / dyNormOld : 0;
+    if (k > 0 &&
+        (rate >= 1 || std::pow(rate, NewtonMaxIterations - k) / (1 - rate) *
+                              dyNorm >
+                          m_newtonTol))
+      return false;
+
+    m_yNew += m_dy;
+    m_d += m_dy;
+    if (dyNorm == 0 || (k > 0 && rate / (1 - rate) * dyNorm < m_newtonTol))
+      return true;
+    dyNormOld = dyNorm;
+  }
+  return false;
+}
+
+template <typename Vector_t>
+template <typename Func, typename Jac>
+bool BdfIntegrator<Vector_t>::Step(Func&& func, Jac&& jac, double tEnd) {
+  constexpr double minFactor = 0.2, maxFactor = 10;
+  const double t = m_t;
+  const double hMin =
+      10 * (std::nextafter(t, std::numeric_limits<double>::infinity()) - t);
+  // m_h * (bound / m_h) may differ from bound by an ulp
+  if (m_hMax > 0 && m_h > m_hMax) {
+    RescaleHistory(m_hMax / m_h);
+    m_h = m_hMax;
+  }
+  if (m_h < hMin) {
+    RescaleHistory(hMin / m_h);
+    m_h = hMin;
+  }
+
+  bool currentJac = m_constantJacobian;
+  double tNew, errorNorm, safety;
+  for (;;) {
+    if (m_h < hMin) return false;
+    tNew = t + m_h;
+    if (tNew > tEnd) {
+      tNew = tEnd;
+      RescaleHistory((tEnd - t) / m_h);
+    }
+    const int k = m_order;
+
+    m_yPred = m_diff[0];
+    for (int j = 1; j <= k; j++) m_yPred += m_diff[j];
+    UpdateScale(m_yPred);
+    m_psi = (m_gamma[1] / m_alpha[k]) * m_diff[1];
+    for (int j = 2; j <= k; j++)
+      m_psi += (m_gamma[j] / m_alpha[k]) * m_diff[j];
+
+    // Newton iterations, with an updated Jacobian if they fail
+    const double c = m_h / m_alpha[k];
+    bool converged = false;
+    int iterations = 0;
+    for (;;) {
+      if (!m_factorized && !Factorize(c)) break;
+      converged = SolveNewton(func, tNew, c, iterations);
+      if (converged || currentJac) break;
+      jac(tNew, m_yPred, m_jacobian);
+      m_jacobians++;
+      m_factorized = false;
+      currentJac = true;
+    }
+    if (!converged) {
+      m_rejected++;
+      RescaleHistory(0.5);
+      continue;
+    }
+
+    // local error estimate of the NDF
+    safety = 0.9 * (2 * NewtonMaxIterations + 1) /
+             (2 * NewtonMaxIterations + iterations);
+    UpdateScale(m_yNew);
+    errorNorm = m_errorConst[k] * Norm(m_d);
+    if (errorNorm <= 1) break;
+    m_rejected++;
+    RescaleHistory(
+        std::max(minFactor, safety * std::pow(errorNorm, -1.0 / (k + 1))));
+  }
+  m_steps++;
+  m_t = tNew;
+
+  // D^{j+1} y_n = D^j y_n - D^j y_{n-1} with D^{k+1} y_n = d
+  const int k = m_order;
+  m_diff[k + 2] = m_d - m_diff[k + 1];
+  m_diff[k + 1] = m_d;
+  for (int i = k; i >= 0; i--) m_diff[i] += m_diff[i + 1];
+
+  // order and step size are only changed after k + 1 equal steps
+  if (++m_equalSteps < k + 1) return true;
+  const double inf = std::numeric_limits<double>::infinity();
+  const double errorMinus =
+      (k > 1) ? m_errorConst[k - 1] * Norm(m_diff[k]) : inf;
+  const double errorPlus =
+      (k < m_maxOrder) ? m_errorConst[k + 1] * Norm(m_diff[k + 2]) : inf;
+  const double factors[3] = {std::pow(errorMinus, -1.0 / k),
+                             std::pow(errorNorm, -1.0 / (k + 1)),
+                             std::pow(errorPlus, -1.0 / (k + 2))};
+  const int best = static_cast<int>(std::max_element(factors, factors + 3) -
+                                    factors);
+  m_order = k + best - 1;
+  RescaleHistory(std::min(maxFactor, safety * factors[best]));
+  return true;
+}
+
+template <typename Vector_t>
+void BdfIntegrator<Vector_t>::Interpolate(double t, Vector_t& y) const {
+  // y(t) = sum_j D^j y_n prod_{i < j} (t - t_n + i h) / ((i + 1) h)
+  y = m_diff[0];
+  double p = 1;
+  for (int j = 1; j <= m_order; j++) {
+    p *= (t - m_t + (j - 1) * m_h) / (j * m_h);
+    y += p * m_diff[j];
+  }
+}
+
+template <typename Vector_t>
+template <typename Func, typename Jac>
+bool BdfIntegrator<Vector_t>::Integrate(Func&& func, Jac&& jac, double& t,
+                                        double tEnd, Vector_t& y) {
+  return Integrate(func, jac, t, tEnd, y, 1, [](double, const Vector_t&) {});
+}
+
+template <typename Vector_t>
+template <typename Func, typename Jac, typename Observer>
+bool BdfIntegrator<Vector_t>::Integrate(Func&& func, Jac&& jac, double& t,
+                                        double tEnd, Vector_t& y,
+                                        std::size_t outputs,
+                                        Observer&& observer) {
+  const double t0 = t, span = tEnd - t;
+  if (span < 0 || outputs == 0) return false;
+  observer(t, y);
+  if (span == 0) return true;
+
+  // continue with the history if the previous call ended at (t, y)
+  const bool resume = m_initialized && t == m_t &&
+                      y.size() == m_diff[0].size() &&
+                      (y.array() == m_diff[0].array()).all();
+  if (!resume) Initialize(func, jac, t, tEnd, y);
+
+  std::size_t next = 1;
+  while (next <= outputs) {
+    if (!Step(func, jac, tEnd)) {
+      t = m_t;
+      y = m_diff[0];
+      return false;
+    }
+    for (; next <= outputs; next++) {
+      const double tOut = (next == outputs) ? tEnd : t0 + span * next / outputs;
+      if (tOut > m_t) break;
+      Interpolate(tOut, m_yNew);
+      observer(tOut, m_yNew);
+    }
+  }
+  t = tEnd;
+  y = m_diff[0];
+  return true;
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_BDFINTEGRATOR_H_
@@ -0,0 +1,148 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_DORMANDPRINCE_H_
+#define QPT_DYNAMICS_DORMANDPRINCE_H_
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace QPT {
+
+// Adaptive embedded Runge-Kutta 5(4) integrator (Dormand-Prince).
+// Vector_t is an Eigen vector type. All stage buffers are members and are
+// only reallocated if the size of the state changes, so repeated calls to
+// Integrate do not allocate.
+template <typename Vector_t>
+class DormandPrince {
+ public:
+  void SetTolerances(double absTol, double relTol) {
+    m_absTol = absTol;
+    m_relTol = relTol;
+  }
+  void SetInitialStepSize(double h) { m_h = h; }
+  void SetMaxStepSize(double h) { m_hMax = h; }
+  double GetStepSize() const { return m_h; }
+
+  std::size_t GetStepCount() const { return m_steps; }
+  std::size_t GetRejectedStepCount() const { return m_rejected; }
+
+  // Integrates dy/dt = func(t, y, dydt) from t to tEnd (t is updated).
+  // Returns false if the step size underflows.
+  template <typename Func>
+  bool Integrate(Func&& func, double& t, double tEnd, Vector_t& y);
+
+ private:
+  void Resize(Eigen::Index n);
+  double ErrorNorm(const Vector_t& y, const Vector_t& yNew) const;
+
+ private:
+  double m_absTol = 1e-8;
+  double m_relTol = 1e-6;
+  double m_h = 0;
+  double m_hMax = 0;
+
+  std::size_t m_steps = 0;
+  std::size_t m_rejected = 0;
+
+  Vector_t m_k1, m_k2, m_k3, m_k4, m_k5, m_k6, m_k7;
+  Vector_t m_tmp, m_yNew;
+};
+
+// Template function definitions
+template <typename Vector_t>
+void DormandPrince<Vector_t>::Resize(Eigen::Index n) {
+  if (m_k1.size() == n) return;
+  for (auto* v : {&m_k1, &m_k2, &m_k3, &m_k4, &m_k5, &m_k6, &m_k7, &m_tmp,
+                  &m_yNew})
+    v->resize(n);
+}
+
+template <typename Vector_t>
+double DormandPrince<Vector_t>::ErrorNorm(const Vector_t& y,
+                                          const Vector_t& yNew) const {
+  // m_tmp holds the error estimate
+  double sum = 0;
+  for (Eigen::Index i = 0; i < y.size(); i++) {
+    const double scale =
+        m_absTol + m_relTol * std::max(std::abs(y[i]), std::abs(yNew[i]));
+    const double e = std::abs(m_tmp[i]) / scale;
+    sum += e * e;
+  }
+  return std::sqrt(sum / std::max<Eigen::Index>(y.size(), 1));
+}
+
+template <typename Vector_t>
+template <typename Func>
+bool DormandPrince<Vector_t>::Integrate(Func&& func, double& t, double tEnd,
+                                        Vector_t& y) {
+  constexpr double c2 = 1.0 / 5, c3 = 3.0 / 10, c4 = 4.0 / 5, c5 = 8.0 / 9;
+  constexpr double a21 = 1.0 / 5;
+  constexpr double a31 = 3.0 / 40, a32 = 9.0 / 40;
+  constexpr double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+  constexpr double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187,
+                   a53 = 64448.0 / 6561, a54 = -212.0 / 729;
+  constexpr double a61 = 9017.0 / 3168, a62 = -355.0 / 33,
+                   a63 = 46732.0 / 5247, a64 = 49.0 / 176,
+                   a65 = -5103.0 / 18656;
+  constexpr double b1 = 35.0 / 384, b3 = 500.0 / 1113, b4 = 125.0 / 192,
+                   b5 = -2187.0 / 6784, b6 = 11.0 / 84;
+  constexpr double e1 = 71.0 / 57600, e3 = -71.0 / 16695, e4 = 71.0 / 1920,
+                   e5 = -17253.0 / 339200, e6 = 22.0 / 525, e7 = -1.0 / 40;
+
+  const double span = tEnd - t;
+  if (span <= 0) return span == 0;
+
+  Resize(y.size());
+  if (m_h <= 0) m_h = span * 1e-3;
+  const double hMin = 1e-14 * std::max(std::abs(t), std::abs(tEnd));
+
+  func(t, y, m_k1);
+  while (t < tEnd) {
+    double h = std::min(m_h, tEnd - t);
+    if (m_hMax > 0) h = std::min(h, m_hMax);
+    // also stops on a NaN step size (non-finite right-hand side)
+    if (!(h > hMin)) return false;
+
+    m_tmp = y + h * a21 * m_k1;
+    func(t + c2 * h, m_tmp, m_k2);
+    m_tmp = y + h * (a31 * m_k1 + a32 * m_k2);
+    func(t + c3 * h, m_tmp, m_k3);
+    m_tmp = y + h * (a41 * m_k1 + a42 * m_k2 + a43 * m_k3);
+    func(t + c4 * h, m_tmp, m_k4);
+    m_tmp = y + h * (a51 * m_k1 + a52 * m_k2 + a53 * m_k3 + a54 * m_k4);
+    func(t + c5 * h, m_tmp, m_k5);
+    m_tmp = y + h * (a61 * m_k1 + a62 * m_k2 + a63 * m_k3 + a64 * m_k4 +
+                     a65 * m_k5);
+    func(t + h, m_tmp, m_k6);
+    m_yNew =
+        y + h * (b1 * m_k1 + b3 * m_k3 + b4 * m_k4 + b5 * m_k5 + b6 * m_k6);
+    func(t + h, m_yNew, m_k7);
+
+    m_tmp = h * (e1 * m_k1 + e3 * m_k3 + e4 * m_k4 + e5 * m_k5 + e6 * m_k6 +
+                 e7 * m_k7);
+    const double err = ErrorNorm(y, m_yNew);
+
+    // elementary step size controller
+    const double factor =
+        (err == 0) ? 5.0
+                   : std::clamp(0.9 * std::pow(err, -0.2), 0.2, 5.0);
+    if (err <= 1.0) {
+      t = (h == tEnd - t) ? tEnd : t + h;
+      y.swap(m_yNew);
+      m_k1.swap(m_k7);  // first same as last
+      m_steps++;
+      // a step that was shortened to hit tEnd must not shrink m_h
+      m_h = (h < m_h) ? std::max(m_h, h * factor) : h * factor;
+    } else {
+      m_rejected++;
+      m_h = h * std::min(factor, 1.0);
+    }
+  }
+  return true;
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_DORMANDPRINCE_H_
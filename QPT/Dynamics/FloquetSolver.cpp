@@ -0,0 +1,308 @@
+// Philipp Neufeld, 2023
+
+#include "FloquetSolver.h"
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "../Constants.h"
+#include "../Profiling/Profiler.h"
+#include "DormandPrince.h"
+
+namespace QPT {
+
+FloquetSolver::FloquetSolver(const Operator_t& h0, double frequency)
+    : m_dim(h0.rows()), m_frequency(frequency) {
+  m_harmonics.push_back(h0);
+  m_adjoints.emplace_back();
+}
+
+bool FloquetSolver::AddHarmonic(int m, const Operator_t& op) {
+  if (m < 1 || static_cast<std::size_t>(op.rows()) != m_dim ||
+      static_cast<std::size_t>(op.cols()) != m_dim)
+    return false;
+
+  const std::size_t idx = m;
+  if (m_harmonics.size() <= idx) {
+    m_harmonics.resize(idx + 1, Operator_t(m_dim, m_dim));
+    m_adjoints.resize(idx + 1, Operator_t(m_dim, m_dim));
+  }
+  m_harmonics[idx] += op;
+  m_adjoints[idx] = m_harmonics[idx].adjoint();
+  return true;
+}
+
+void FloquetSolver::SetTolerances(double absTol, double relTol) {
+  m_absTol = absTol;
+  m_relTol = relTol;
+}
+
+double FloquetSolver::GetPeriod() const { return TwoPi_v / m_frequency; }
+
+void FloquetSolver::ApplyGenerator(double t, const Eigen::VectorXcd& psi,
+                                   Eigen::VectorXcd& out) const {
+  const std::complex<double> i(0, 1);
+  out.noalias() = m_harmonics[0] * psi;
+  for (std::size_t m = 1; m < m_harmonics.size(); m++) {
+    const auto phase = std::polar(1.0, m * m_frequency * t);
+    out += phase * (m_harmonics[m] * psi);
+    out += std::conj(phase) * (m_adjoints[m] * psi);
+  }
+  out *= -i;
+}
+
+bool FloquetSolver::ComputePropagator(ThreadPool& pool) {
+  QPT_PROFILE_SCOPE("FloquetSolver::ComputePropagator");
+  const double period = GetPeriod();
+  m_propagator.resize(m_dim, m_dim);
+
+  // U(T) e_j for every column j, one integrator per task
+  std::atomic<bool> success = true;
+  auto rhs = [this](double t, const Eigen::VectorXcd& y,
+                    Eigen::VectorXcd& dy) { ApplyGenerator(t, y, dy); };
+  pool.ParallelFor(0, m_dim, [&](std::size_t j) {
+    DormandPrince<Eigen::VectorXcd> integrator;
+    integrator.SetTolerances(m_absTol, m_relTol);
+    Eigen::VectorXcd psi = Eigen::VectorXcd::Unit(m_dim, j);
+    double t = 0;
+    if (!integrator.Integrate(rhs, t, period, psi)) success = false;
+    m_propagator.col(j) = psi;
+  });
+  if (!success) return false;
+
+  // U(T) is normal, its Schur form is diagonal and the Schur vectors are
+  // orthonormal eigenvectors (also for degenerate quasienergies)
+  Eigen::ComplexSchur<Eigen::MatrixXcd> schur(m_propagator);
+  if (schur.info() != Eigen::Success) return false;
+  m_quasienergies.resize(m_dim);
+  for (std::size_t a = 0; a < m_dim; a++)
+    m_quasienergies[a] = -std::arg(schur.matrixT()(a, a)) / period;
+  m_modes = schur.matrixU();
+
+  m_truncation = -1;
+  m_sambeEnergies.resize(0);
+  m_sambeModes.resize(0, 0);
+  SortModes();
+  return true;
+}
+
+FloquetSolver::Operator_t FloquetSolver::BuildFloquetHamiltonian(
+    int truncation) const {
+  using Triplet_t = Eigen::Triplet<LindbladSystem::Scalar_t>;
+  const int N = std::max(truncation, 0);
+  const std::size_t blocks = 2 * N + 1;
+  const std::size_t size = blocks * m_dim;
+
+  std::vector<Triplet_t> triplets;
+  auto addBlock = [&](int n, int k, const Operator_t& op) {
+    const std::size_t rowOffset = (n + N) * m_dim;
+    const std::size_t colOffset = (k + N) * m_dim;
+    for (int col = 0; col < op.outerSize(); col++) {
+      for (Operator_t::InnerIterator it(op, col); it; ++it)
+        triplets.emplace_back(rowOffset + it.row(), colOffset + col,
+                              it.value());
+    }
+  };
+  for (int n = -N; n <= N; n++) {
+    addBlock(n, n, m_harmonics[0]);
+    for (std::size_t i = 0; i < m_dim; i++) {
+      const std::size_t idx = (n + N) * m_dim + i;
+      triplets.emplace_back(idx, idx, n * m_frequency);
+    }
+    // block (n, n - m) holds H_m, block (n - m, n) holds H_m^dagger
+    for (int m = 1; m < static_cast<int>(m_harmonics.size()); m++) {
+      if (n - m < -N) break;
+      addBlock(n, n - m, m_harmonics[m]);
+      addBlock(n - m, n, m_adjoints[m]);
+    }
+  }
+
+  Operator_t hf(size, size);
+  hf.setFromTriplets(triplets.begin(), triplets.end());
+  hf.makeCompressed();
+  return hf;
+}
+
+bool FloquetSolver::DiagonalizeFloquetHamiltonian(int truncation) {
+  QPT_PROFILE_SCOPE("FloquetSolver::Diagonalize");
+  if (truncation < 0) return false;
+  const int N = truncation;
+  const Eigen::MatrixXcd hf = BuildFloquetHamiltonian(N);
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXcd> solver(hf);
+  if (solver.info() != Eigen::Success) return false;
+
+  // Every mode appears in copies whose quasienergies differ by multiples of
+  // w (Fourier indices shifted by one). The copies are grouped by their
+  // reduced quasienergy and the one with the smallest mean Fourier index
+  // |<n>| represents the class. Under strong driving two copies of a mode
+  // have |<n>| ~ 0.5, selecting by |<n>| alone could keep both and drop
+  // another mode. Degenerate modes share the quasienergy but not the mode
+  // vector u_a(0), which copies share up to a phase.
+  auto reduce = [this](double eps) {
+    return eps - m_frequency * std::floor(eps / m_frequency + 0.5);
+  };
+  const Eigen::Index size = hf.rows();
+  std::vector<double> center(size);
+  for (Eigen::Index a = 0; a < size; a++) {
+    double sum = 0;
+    for (int n = -N; n <= N; n++)
+      sum += n * solver.eigenvectors()
+                     .col(a)
+                     .segment((n + N) * m_dim, m_dim)
+                     .squaredNorm();
+    center[a] = std::abs(sum);
+  }
+  std::vector<Eigen::Index> order(size);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](Eigen::Index lhs, Eigen::Index rhs) {
+                     return center[lhs] < center[rhs];
+                   });
+
+  const double tol = 1e-3 * m_frequency;
+  std::vector<Eigen::Index> selected;
+  std::vector<Eigen::VectorXcd> modes;
+  for (auto idx : order) {
+    if (selected.size() == m_dim) break;
+    const double eps = reduce(solver.eigenvalues()[idx]);
+    Eigen::VectorXcd mode = Eigen::VectorXcd::Zero(m_dim);
+    for (int n = -N; n <= N; n++)
+      mode += solver.eigenvectors().col(idx).segment((n + N) * m_dim, m_dim);
+
+    bool copy = false;
+    for (std::size_t s = 0; s < selected.size() && !copy; s++) {
+      const double other = reduce(solver.eigenvalues()[selected[s]]);
+      copy = std::abs(reduce(eps - other)) < tol &&
+             std::abs(modes[s].dot(mode)) > 0.5 * modes[s].norm() * mode.norm();
+    }
+    if (!copy) {
+      selected.push_back(idx);
+      modes.push_back(std::move(mode));
+    }
+  }
+  if (selected.size() != m_dim) return false;
+
+  m_truncation = N;
+  m_sambeEnergies.resize(m_dim);
+  m_sambeModes.resize(size, m_dim);
+  m_quasienergies.resize(m_dim);
+  m_modes.resize(m_dim, m_dim);
+  for (std::size_t a = 0; a < m_dim; a++) {
+    const double eps = solver.eigenvalues()[selected[a]];
+    m_sambeEnergies[a] = eps;
+    m_sambeModes.col(a) = solver.eigenvectors().col(selected[a]);
+    // reduced to the first Brillouin zone
+    m_quasienergies[a] = reduce(eps);
+    m_modes.col(a) = modes[a];
+  }
+  SortModes();
+  return true;
+}
+
+void FloquetSolver::SortModes() {
+  std::vector<Eigen::Index> order(m_dim);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](Eigen::Index lhs, Eigen::Index rhs) {
+                     return m_quasienergies[lhs] < m_quasienergies[rhs];
+                   });
+
+  const Eigen::VectorXd energies = m_quasienergies;
+  const Eigen::MatrixXcd modes = m_modes;
+  const bool sambe = (m_truncation >= 0);
+  const Eigen::VectorXd sambeEnergies = m_sambeEnergies;
+  const Eigen::MatrixXcd sambeModes = m_sambeModes;
+  for (std::size_t a = 0; a < m_dim; a++) {
+    m_quasienergies[a] = energies[order[a]];
+    m_modes.col(a) = modes.col(order[a]);
+    if (sambe) {
+      m_sambeEnergies[a] = sambeEnergies[order[a]];
+      m_sambeModes.col(a) = sambeModes.col(order[a]);
+    }
+  }
+  // the truncated modes are not exactly orthonormal, the expansion
+  // coefficients are obtained by solving
+  m_modeLU.compute(m_modes);
+}
+
+std::optional<Eigen::VectorXcd> FloquetSolver::EvolveStroboscopic(
+    const Eigen::VectorXcd& psi0, std::size_t periods) const {
+  if (m_modes.cols() == 0 || static_cast<std::size_t>(psi0.size()) != m_dim)
+    return std::nullopt;
+
+  const double t = GetPeriod() * periods;
+  Eigen::VectorXcd coeffs = m_modeLU.solve(psi0);
+  for (std::size_t a = 0; a < m_dim; a++)
+    coeffs[a] *= std::polar(1.0, -std::fmod(m_quasienergies[a] * t, TwoPi_v));
+  Eigen::VectorXcd psi = m_modes * coeffs;
+  return psi;
+}
+
+std::optional<Eigen::VectorXcd> FloquetSolver::Evolve(
+    const Eigen::VectorXcd& psi0, double t) const {
+  if (m_truncation < 0 || static_cast<std::size_t>(psi0.size()) != m_dim)
+    return std::nullopt;
+
+  // psi(t) = sum_n e^{i n w t} sum_a phi_a^n c_a e^{-i eps_a t}
+  const int N = m_truncation;
+  Eigen::VectorXcd coeffs = m_modeLU.solve(psi0);
+  for (std::size_t a = 0; a < m_dim; a++)
+    coeffs[a] *= std::polar(1.0, -std::fmod(m_sambeEnergies[a] * t, TwoPi_v));
+  Eigen::VectorXcd harmonics = m_sambeModes * coeffs;
+
+  Eigen::VectorXcd psi = Eigen::VectorXcd::Zero(m_dim);
+  for (int n = -N; n <= N; n++) {
+    const auto phase = std::polar(1.0, std::fmod(n * m_frequency * t, TwoPi_v));
+    psi += phase * harmonics.segment((n + N) * m_dim, m_dim);
+  }
+  return psi;
+}
+
+FloquetSolver::Spectrum_t FloquetSolver::SweepQuasienergies(
+    ThreadPool& pool, const std::vector<double>& parameters,
+    std::size_t dimension, const Factory_t& factory) {
+  Spectrum_t spectrum(parameters.size(), dimension);
+  spectrum.setConstant(std::numeric_limits<double>::quiet_NaN());
+
+  // the propagator columns of every parameter are parallelized as well
+  pool.ParallelFor(0, parameters.size(), [&](std::size_t i) {
+    auto solver = factory(parameters[i]);
+    if (!solver || solver->GetDimension() != dimension ||
+        !solver->ComputePropagator(pool))
+      return;
+    spectrum.row(i) = solver->GetQuasienergies().transpose();
+  });
+  return spectrum;
+}
+
+std::optional<H5Dataset> FloquetSolver::SweepQuasienergies(
+    ThreadPool& pool, const std::vector<double>& parameters,
+    std::size_t dimension, const Factory_t& factory, H5Group& group,
+    const std::string& name) {
+  const std::size_t n = parameters.size();
+  const auto spectrum =
+      SweepQuasienergies(pool, parameters, dimension, factory);
+
+  Spectrum_t rows(n, dimension + 1);
+  rows.col(0) = Eigen::Map<const Eigen::VectorXd>(parameters.data(), n);
+  rows.rightCols(dimension) = spectrum;
+
+  auto ds = group.CreateUninitializedDataset<double>(name, {n, dimension + 1});
+  if (!ds || !ds->SetSlabData({0, 0}, {n, dimension + 1}, rows.data()))
+    return std::nullopt;
+
+  if (!ds->SetAttribute("column0", std::string("parameter")))
+    return std::nullopt;
+  for (std::size_t i = 0; i < dimension; i++) {
+    const auto attr = "column" + std::to_string(i + 1);
+    if (!ds->SetAttribute(attr, "quasienergy" + std::to_string(i)))
+      return std::nullopt;
+  }
+  return ds;
+}
+
+}  // namespace QPT
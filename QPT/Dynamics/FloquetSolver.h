@@ -0,0 +1,115 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_FLOQUETSOLVER_H_
+#define QPT_DYNAMICS_FLOQUETSOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Floquet analysis of a periodically driven Hamiltonian
+//   H(t) = H_0 + sum_{m >= 1} (H_m e^{i m w t} + H_m^dagger e^{-i m w t})
+// with period T = 2 pi / w. Solutions have the form
+//   psi(t) = sum_a c_a e^{-i eps_a t} u_a(t),  u_a(t + T) = u_a(t)
+// with the quasienergies eps_a in [-w/2, w/2) and the Floquet modes u_a.
+// They are obtained either from the one-period propagator U(T) (exact
+// stroboscopic dynamics) or from the truncated Floquet Hamiltonian in
+// Sambe space (dynamics at arbitrary times). In both cases the cost of
+// evaluating psi(t) does not depend on t.
+class FloquetSolver {
+ public:
+  using Operator_t = LindbladSystem::Operator_t;
+  using Spectrum_t =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+  using Factory_t = std::function<std::optional<FloquetSolver>(double)>;
+
+  FloquetSolver(const Operator_t& h0, double frequency);
+
+  // Adds H_m e^{i m w t} + h.c. (m >= 1, same dimension as H_0)
+  bool AddHarmonic(int m, const Operator_t& op);
+  // tolerances of the integration of the propagator
+  void SetTolerances(double absTol, double relTol);
+
+  std::size_t GetDimension() const { return m_dim; }
+  double GetFrequency() const { return m_frequency; }
+  double GetPeriod() const;
+
+  // One-period propagator U(T, 0): the columns are integrated in parallel
+  // and U(T) is diagonalized by a Schur decomposition.
+  bool ComputePropagator(ThreadPool& pool);
+  const Eigen::MatrixXcd& GetPropagator() const { return m_propagator; }
+
+  // Floquet Hamiltonian on the Fourier blocks |n| <= truncation
+  //   (H_F)_{n n'} = H_{n - n'} + n w delta_{n n'}   (H_{-m} = H_m^dagger)
+  Operator_t BuildFloquetHamiltonian(int truncation) const;
+  // Diagonalizes H_F and keeps one eigenvector per class of copies (equal
+  // quasienergy modulo w and mode), the one centered closest to the n = 0
+  // block. The truncation must be large enough for the harmonics of the
+  // modes to decay towards the edges.
+  bool DiagonalizeFloquetHamiltonian(int truncation);
+
+  // ascending, in [-w/2, w/2) (from the last of the two methods above)
+  const Eigen::VectorXd& GetQuasienergies() const { return m_quasienergies; }
+  // u_a(0) as columns
+  const Eigen::MatrixXcd& GetFloquetModes() const { return m_modes; }
+
+  // psi(periods * T) from psi(0)
+  std::optional<Eigen::VectorXcd> EvolveStroboscopic(
+      const Eigen::VectorXcd& psi0, std::size_t periods) const;
+  // psi(t) from psi(0) for any t (requires DiagonalizeFloquetHamiltonian)
+  std::optional<Eigen::VectorXcd> Evolve(const Eigen::VectorXcd& psi0,
+                                         double t) const;
+
+  // Quasienergies of the solvers created by factory(parameter) for every
+  // parameter (one row per parameter, NaN if the factory or the propagator
+  // fails). The parameters are processed in parallel.
+  static Spectrum_t SweepQuasienergies(ThreadPool& pool,
+                                       const std::vector<double>& parameters,
+                                       std::size_t dimension,
+                                       const Factory_t& factory);
+  // Same as above but writes the rows (parameter, eps_1, ..., eps_N)
+  static std::optional<H5Dataset> SweepQuasienergies(
+      ThreadPool& pool, const std::vector<double>& parameters,
+      std::size_t dimension, const Factory_t& factory, H5Group& group,
+      const std::string& name);
+
+ private:
+  // out = -i H(t) psi
+  void ApplyGenerator(double t, const Eigen::VectorXcd& psi,
+                      Eigen::VectorXcd& out) const;
+  // sorts the quasienergies and the corresponding columns of the modes
+  void SortModes();
+
+ private:
+  std::size_t m_dim;
+  double m_frequency;
+  double m_absTol = 1e-10;
+  double m_relTol = 1e-8;
+  // m_harmonics[m] = H_m, m_adjoints[m] = H_m^dagger (m_adjoints[0] unused)
+  std::vector<Operator_t> m_harmonics;
+  std::vector<Operator_t> m_adjoints;
+
+  Eigen::MatrixXcd m_propagator;
+  Eigen::VectorXd m_quasienergies;
+  Eigen::MatrixXcd m_modes;
+  Eigen::PartialPivLU<Eigen::MatrixXcd> m_modeLU;
+
+  // Sambe space representation: unreduced quasienergies and the Fourier
+  // components of the modes (rows (n + N) * dim + i for |n| <= N)
+  int m_truncation = -1;
+  Eigen::VectorXd m_sambeEnergies;
+  Eigen::MatrixXcd m_sambeModes;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_FLOQUETSOLVER_H_
@@ -0,0 +1,172 @@
+// Philipp Neufeld, 2023
+
+#include "KrylovPropagator.h"
+
+#include <cmath>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+KrylovPropagator::KrylovPropagator(
+    const LindbladSystem::Operator_t& hamiltonian)
+    : m_hamiltonian(hamiltonian) {
+  m_hamiltonian.makeCompressed();
+}
+
+void KrylovPropagator::Multiply(ThreadPool& pool,
+                                const Eigen::Ref<const Eigen::VectorXcd>& x,
+                                Eigen::VectorXcd& y) {
+  m_matVecs++;
+  const std::size_t rows = m_hamiltonian.rows();
+  const std::size_t threads = pool.GetThreadCount();
+  if (threads <= 1 || rows < 2 * m_blockSize) {
+    y.noalias() = m_hamiltonian * x;
+    return;
+  }
+
+  // row-major storage: the rows of a block are independent
+  const std::size_t block =
+      std::max(m_blockSize, (rows + 4 * threads - 1) / (4 * threads));
+  pool.ParallelForBlocks(0, rows, block, [&](std::size_t b, std::size_t e) {
+    y.segment(b, e - b).noalias() = m_hamiltonian.middleRows(b, e - b) * x;
+  });
+}
+
+void KrylovPropagator::ExpTridiagonal(std::size_t dim, double h) {
+  // T = Q diag(lambda) Q^T -> exp(-i T h) e_1 = Q exp(-i lambda h) Q^T e_1
+  m_eigen.computeFromTridiagonal(m_alpha.head(dim), m_beta.head(dim - 1));
+  const auto& q = m_eigen.eigenvectors();
+  const auto& lambda = m_eigen.eigenvalues();
+  for (std::size_t k = 0; k < dim; k++)
+    m_coeffs[k] = std::polar(q(0, k), -lambda[k] * h);
+  m_expT.head(dim).noalias() = q * m_coeffs.head(dim);
+}
+
+bool KrylovPropagator::Step(ThreadPool& pool, Eigen::VectorXcd& psi,
+                            double& h, double tolPerTime) {
+  QPT_PROFILE_SCOPE("KrylovPropagator::Step");
+  const Eigen::Index n = psi.size();
+  const double norm = psi.norm();
+  if (norm == 0) return true;
+
+  // (re)allocate the workspace only if the dimensions change
+  const Eigen::Index maxDim = m_maxDim;
+  if (m_basis.rows() != n || m_basis.cols() != maxDim) {
+    m_basis.resize(n, maxDim);
+    m_w.resize(n);
+    m_alpha.resize(maxDim);
+    m_beta.resize(maxDim);
+    m_expT.resize(maxDim);
+    m_coeffs.resize(maxDim);
+  }
+
+  // Lanczos iteration, the basis grows until the error estimate is met
+  m_basis.col(0) = psi / norm;
+  Eigen::Index dim = 0;
+  double beta = 0, err = 0;
+  bool converged = false;
+  for (Eigen::Index j = 0; j < maxDim && !converged; j++) {
+    Multiply(pool, m_basis.col(j), m_w);
+    m_alpha[j] = m_basis.col(j).dot(m_w).real();
+    // three-term recurrence, fused into a single pass over the vectors
+    if (j > 0)
+      m_w -= m_alpha[j] * m_basis.col(j) + m_beta[j - 1] * m_basis.col(j - 1);
+    else
+      m_w -= m_alpha[j] * m_basis.col(j);
+
+    dim = j + 1;
+    beta = m_w.norm();
+    m_beta[j] = beta;
+    ExpTridiagonal(dim, h);
+    // an invariant subspace (beta == 0) yields the exact result
+    err = beta * std::abs(m_expT[dim - 1]);
+    converged = err <= tolPerTime * std::abs(h);
+    if (!converged && j + 1 < maxDim) m_basis.col(j + 1) = m_w / beta;
+  }
+
+  // maximum dimension reached: shorten the step (err ~ h^dim)
+  for (int k = 0; k < 100 && !converged; k++) {
+    const double ratio = tolPerTime * std::abs(h) / err;
+    h *= std::clamp(0.9 * std::pow(ratio, 1.0 / dim), 0.1, 0.9);
+    ExpTridiagonal(dim, h);
+    err = beta * std::abs(m_expT[dim - 1]);
+    converged = err <= tolPerTime * std::abs(h);
+  }
+  if (!converged) return false;
+
+  psi.noalias() = norm * (m_basis.leftCols(dim) * m_expT.head(dim));
+  m_steps++;
+  QPT_PROFILE_COUNTER("Krylov dimension", static_cast<double>(dim));
+
+  // step size proposal for the next step
+  const double ratio = (err > 0) ? tolPerTime * std::abs(h) / err : 1e300;
+  m_h = std::abs(h) * std::clamp(0.9 * std::pow(ratio, 1.0 / dim), 1.0, 5.0);
+  return true;
+}
+
+bool KrylovPropagator::Propagate(ThreadPool& pool, Eigen::VectorXcd& psi,
+                                 double t, double tolPerTime) {
+  if (psi.size() != m_hamiltonian.rows()) return false;
+  const double direction = (t < 0) ? -1.0 : 1.0;
+  double remaining = std::abs(t);
+  while (remaining > 0) {
+    double h = direction * ((m_h > 0) ? std::min(m_h, remaining) : remaining);
+    if (!Step(pool, psi, h, tolPerTime)) return false;
+    // avoid a tiny last step due to round-off
+    remaining -= std::abs(h);
+    if (remaining <= 1e-12 * std::abs(t)) remaining = 0;
+  }
+  return true;
+}
+
+bool KrylovPropagator::Propagate(ThreadPool& pool, Eigen::VectorXcd& psi,
+                                 double t) {
+  if (t == 0) return true;
+  return Propagate(pool, psi, t, m_tol / std::abs(t));
+}
+
+bool KrylovPropagator::Evolve(ThreadPool& pool, Eigen::VectorXcd& psi,
+                              double t0, double t1, std::size_t outputs,
+                              const Observer_t& observer) {
+  if (psi.size() != m_hamiltonian.rows() || outputs == 0) return false;
+  const double tolPerTime = (t1 != t0) ? m_tol / std::abs(t1 - t0) : m_tol;
+
+  observer(t0, psi);
+  double t = t0;
+  for (std::size_t i = 1; i <= outputs; i++) {
+    const double tNext = t0 + (t1 - t0) * i / outputs;
+    if (!Propagate(pool, psi, tNext - t, tolPerTime)) return false;
+    t = tNext;
+    observer(t, psi);
+  }
+  return true;
+}
+
+bool KrylovPropagator::Evolve(ThreadPool& pool, Eigen::VectorXcd& psi,
+                              double t0, double t1, std::size_t outputs,
+                              H5Group& group) {
+  const std::size_t n = m_hamiltonian.rows();
+  auto times = group.HasDataset("t")
+                   ? group.OpenExistingDataset("t")
+                   : group.CreateAppendableDataset<double>("t", {});
+  // one snapshot per chunk: snapshots are read individually and a chunk of
+  // many large states would bloat short runs
+  auto states = group.HasDataset("psi")
+                    ? group.OpenExistingDataset("psi")
+                    : group.CreateAppendableDataset<double>("psi", {n, 2}, 1);
+  if (!times || !states) return false;
+  const auto shape = states->GetShape();
+  if (shape.size() != 3 || shape[1] != n || shape[2] != 2) return false;
+
+  // std::complex<double> is layout compatible with double[2]
+  bool success = true;
+  auto observer = [&](double t, const Eigen::VectorXcd& state) {
+    const double* data = reinterpret_cast<const double*>(state.data());
+    success = success && states->AppendData(1, data) &&
+              times->AppendData(1, &t) && group.Flush();
+  };
+  return Evolve(pool, psi, t0, t1, outputs, observer) && success;
+}
+
+}  // namespace QPT
@@ -0,0 +1,92 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_KRYLOVPROPAGATOR_H_
+#define QPT_DYNAMICS_KRYLOVPROPAGATOR_H_
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <Eigen/SparseCore>
+#include <algorithm>
+#include <complex>
+#include <functional>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Propagates a state vector with exp(-i H t) for a large sparse hermitian
+// Hamiltonian H (rad/s) without ever forming a dense matrix. Every step
+// builds a Lanczos basis of the Krylov space span{v, Hv, H^2 v, ...} and
+// exponentiates the small tridiagonal projection of H. The basis grows until
+// the a posteriori error estimate beta_(m+1) |e_m^T exp(-i T_m h) e_1| is
+// below the tolerance; if the maximum dimension is reached, the step size is
+// reduced instead. The Krylov workspace is kept between steps and calls and
+// the sparse matrix-vector products are distributed over a thread pool.
+class KrylovPropagator {
+ public:
+  using Observer_t = std::function<void(double, const Eigen::VectorXcd&)>;
+
+  explicit KrylovPropagator(const LindbladSystem::Operator_t& hamiltonian);
+
+  // tolerance of the accumulated error (2-norm) of a call to Propagate or
+  // Evolve, distributed over the steps in proportion to their length
+  void SetTolerance(double tol) { m_tol = tol; }
+  void SetMaxDimension(std::size_t dim) {
+    m_maxDim = std::max<std::size_t>(dim, 2);
+  }
+  // minimum number of rows per matrix-vector task
+  void SetBlockSize(std::size_t size) { m_blockSize = size; }
+
+  std::size_t GetStepCount() const { return m_steps; }
+  std::size_t GetMatVecCount() const { return m_matVecs; }
+
+  // psi <- exp(-i H t) psi
+  bool Propagate(ThreadPool& pool, Eigen::VectorXcd& psi, double t);
+
+  // Evolves psi from t0 to t1 and passes psi at outputs + 1 equidistant times
+  // (including t0 and t1) to the observer.
+  bool Evolve(ThreadPool& pool, Eigen::VectorXcd& psi, double t0, double t1,
+              std::size_t outputs, const Observer_t& observer);
+
+  // Same as above but streams the snapshots into group: the times are
+  // appended to the dataset "t" [T] and the states to "psi" [T, N, 2]
+  // (real and imaginary parts). Both are created on first use, the file is
+  // flushed after every snapshot.
+  bool Evolve(ThreadPool& pool, Eigen::VectorXcd& psi, double t0, double t1,
+              std::size_t outputs, H5Group& group);
+
+ private:
+  void Multiply(ThreadPool& pool, const Eigen::Ref<const Eigen::VectorXcd>& x,
+                Eigen::VectorXcd& y);
+  bool Propagate(ThreadPool& pool, Eigen::VectorXcd& psi, double t,
+                 double tolPerTime);
+  // exp(-i T h) e_1 for the leading dim x dim block of the Lanczos matrix
+  void ExpTridiagonal(std::size_t dim, double h);
+  // one adaptive step of at most |h| (h is updated to the step taken)
+  bool Step(ThreadPool& pool, Eigen::VectorXcd& psi, double& h,
+            double tolPerTime);
+
+ private:
+  Eigen::SparseMatrix<std::complex<double>, Eigen::RowMajor> m_hamiltonian;
+  double m_tol = 1e-10;
+  std::size_t m_maxDim = 30;
+  std::size_t m_blockSize = 4096;
+  double m_h = 0;
+
+  std::size_t m_steps = 0;
+  std::size_t m_matVecs = 0;
+
+  // Krylov workspace
+  Eigen::MatrixXcd m_basis;
+  Eigen::VectorXcd m_w;
+  Eigen::VectorXd m_alpha, m_beta;
+  Eigen::VectorXcd m_expT;
+  Eigen::VectorXcd m_coeffs;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> m_eigen;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_KRYLOVPROPAGATOR_H_
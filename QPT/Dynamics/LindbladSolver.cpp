@@ -0,0 +1,97 @@
+// Philipp Neufeld, 2023
+
+#include "LindbladSolver.h"
+
+#include <vector>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+LindbladSolver::LindbladSolver(const LindbladSystem& system)
+    : m_levels(system.GetLevelCount()),
+      m_liouvillian(system.BuildLiouvillian()),
+      m_observables(system.BuildObservableMatrix()) {
+  for (std::size_t i = 0; i < system.GetObservableCount(); i++)
+    m_observableNames.push_back(system.GetObservableName(i));
+  m_obsBuffer.resize(m_observables.rows());
+  m_obsReal.resize(m_observables.rows());
+}
+
+void LindbladSolver::SetTolerances(double absTol, double relTol) {
+  m_integrator.SetTolerances(absTol, relTol);
+  m_stiffIntegrator.SetTolerances(absTol, relTol);
+  m_stiffIntegrator.Reset();
+}
+
+bool LindbladSolver::Evolve(Eigen::MatrixXcd& rho, double t0, double t1,
+                            std::size_t outputs, const Observer_t& observer) {
+  QPT_PROFILE_SCOPE("LindbladSolver::Evolve");
+  const Eigen::Index n = m_levels;
+  if (rho.rows() != n || rho.cols() != n || outputs == 0) return false;
+
+  // column-major storage == column-stacking vectorization
+  m_state = Eigen::Map<const Eigen::VectorXcd>(rho.data(), n * n);
+  auto rhs = [this](double, const Eigen::VectorXcd& y, Eigen::VectorXcd& dy) {
+    dy.noalias() = m_liouvillian * y;
+  };
+  auto observe = [&](double t, const Eigen::VectorXcd& state) {
+    m_obsBuffer.noalias() = m_observables * state;
+    m_obsReal = m_obsBuffer.real();
+    observer(t, m_obsReal);
+  };
+
+  double t = t0;
+  if (m_integratorType == LindbladIntegrator_BDF) {
+    // the Jacobian is the (constant) Liouvillian
+    m_stiffIntegrator.SetConstantJacobian(true);
+    auto jac = [this](double, const Eigen::VectorXcd&,
+                      LindbladSystem::Operator_t& J) { J = m_liouvillian; };
+    if (!m_stiffIntegrator.Integrate(rhs, jac, t, t1, m_state, outputs,
+                                     observe))
+      return false;
+  } else {
+    observe(t, m_state);
+    for (std::size_t i = 1; i <= outputs; i++) {
+      const double tNext = t0 + (t1 - t0) * i / outputs;
+      if (!m_integrator.Integrate(rhs, t, tNext, m_state)) return false;
+      observe(t, m_state);
+    }
+  }
+
+  Eigen::Map<Eigen::VectorXcd>(rho.data(), n * n) = m_state;
+  return true;
+}
+
+bool LindbladSolver::Evolve(Eigen::MatrixXcd& rho, double t0, double t1,
+                            std::size_t outputs, H5Dataset& dataset) {
+  const auto shape = dataset.GetShape();
+  const std::size_t rowSize = m_observables.rows() + 1;
+  if (shape.size() != 2 || shape[1] != rowSize) return false;
+
+  std::vector<double> row(rowSize);
+  bool success = true;
+  auto observer = [&](double t, const Eigen::VectorXd& obs) {
+    row[0] = t;
+    std::copy(obs.data(), obs.data() + obs.size(), row.begin() + 1);
+    success = success && dataset.AppendData(1, row.data());
+  };
+  return Evolve(rho, t0, t1, outputs, observer) && success;
+}
+
+std::optional<H5Dataset> LindbladSolver::CreateOutputDataset(
+    H5Group& group, const std::string& name) const {
+  const std::size_t rowSize = m_observables.rows() + 1;
+  auto ds = group.CreateAppendableDataset<double>(name, {rowSize});
+  if (!ds) return std::nullopt;
+
+  // column labels
+  if (!ds->SetAttribute("column0", std::string("t"))) return std::nullopt;
+  for (std::size_t i = 0; i < m_observableNames.size(); i++) {
+    const auto attr = "column" + std::to_string(i + 1);
+    if (!ds->SetAttribute(attr, m_observableNames[i])) return std::nullopt;
+  }
+  return ds;
+}
+
+}  // namespace QPT
@@ -0,0 +1,83 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_LINDBLADSOLVER_H_
+#define QPT_DYNAMICS_LINDBLADSOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include "../HDF5/H5Group.h"
+#include "BdfIntegrator.h"
+#include "DormandPrince.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Explicit Runge-Kutta for weakly damped systems, implicit variable order
+// BDF for stiff systems (e.g. optical pumping with decay rates many orders
+// of magnitude faster than the pumping rates)
+enum LindbladIntegrator {
+  LindbladIntegrator_DORMANDPRINCE,
+  LindbladIntegrator_BDF,
+};
+
+// Time evolution of the density matrix of a LindbladSystem. The Liouvillian
+// is assembled once as a sparse matrix, hence memory and time per step scale
+// with its number of non-zeros instead of N^4. The integrator workspace is
+// kept between calls to Evolve.
+class LindbladSolver {
+ public:
+  using Observer_t = std::function<void(double, const Eigen::VectorXd&)>;
+
+  explicit LindbladSolver(const LindbladSystem& system);
+
+  void SetTolerances(double absTol, double relTol);
+  void SetIntegrator(LindbladIntegrator integrator) {
+    m_integratorType = integrator;
+  }
+  LindbladIntegrator GetIntegrator() const { return m_integratorType; }
+
+  const LindbladSystem::Operator_t& GetLiouvillian() const {
+    return m_liouvillian;
+  }
+  std::size_t GetStepCount() const {
+    return (m_integratorType == LindbladIntegrator_BDF)
+               ? m_stiffIntegrator.GetStepCount()
+               : m_integrator.GetStepCount();
+  }
+
+  // Evolves rho (N x N) from t0 to t1. The observables of the system are
+  // evaluated at outputs + 1 equidistant times (including t0 and t1) and
+  // passed to the observer (only the real parts, the observables are
+  // assumed to be hermitian). The BDF integrator obtains them by dense
+  // output and does not shorten its steps to hit the output times.
+  bool Evolve(Eigen::MatrixXcd& rho, double t0, double t1, std::size_t outputs,
+              const Observer_t& observer);
+
+  // Same as above but appends the rows (t, <O_1>, ..., <O_m>) to a dataset
+  // created by CreateOutputDataset.
+  bool Evolve(Eigen::MatrixXcd& rho, double t0, double t1, std::size_t outputs,
+              H5Dataset& dataset);
+  std::optional<H5Dataset> CreateOutputDataset(H5Group& group,
+                                               const std::string& name) const;
+
+ private:
+  std::size_t m_levels;
+  std::vector<std::string> m_observableNames;
+  LindbladSystem::Operator_t m_liouvillian;
+  LindbladSystem::Operator_t m_observables;
+
+  LindbladIntegrator m_integratorType = LindbladIntegrator_DORMANDPRINCE;
+  DormandPrince<Eigen::VectorXcd> m_integrator;
+  BdfIntegrator<Eigen::VectorXcd> m_stiffIntegrator;
+  Eigen::VectorXcd m_state;
+  Eigen::VectorXcd m_obsBuffer;
+  Eigen::VectorXd m_obsReal;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_LINDBLADSOLVER_H_
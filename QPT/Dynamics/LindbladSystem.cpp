@@ -0,0 +1,140 @@
+// Philipp Neufeld, 2023
+
+#include "LindbladSystem.h"
+
+#include <cmath>
+
+#include "../Constants.h"
+
+namespace QPT {
+
+LindbladSystem::LindbladSystem(std::size_t levels)
+    : m_levels(levels), m_hamiltonian(levels, levels) {}
+
+void LindbladSystem::AddHamiltonianTerm(std::size_t i, std::size_t j,
+                                        Scalar_t value) {
+  m_hamiltonian.coeffRef(i, j) += value;
+  if (i != j) m_hamiltonian.coeffRef(j, i) += std::conj(value);
+}
+
+void LindbladSystem::AddHamiltonian(const Operator_t& hamiltonian) {
+  m_hamiltonian += hamiltonian;
+}
+
+void LindbladSystem::AddHamiltonianEnergy(const Operator_t& hamiltonian) {
+  m_hamiltonian += hamiltonian / ReducedPlanckConstant_v;
+}
+
+void LindbladSystem::AddDipoleCoupling(std::size_t i, std::size_t j,
+                                       double dipoleMoment,
+                                       double fieldAmplitude) {
+  // H_ij = hbar * Omega / 2 with the Rabi frequency Omega = d * E / hbar
+  const double rabi = dipoleMoment * Debye_v * fieldAmplitude /
+                      ReducedPlanckConstant_v;
+  AddHamiltonianTerm(i, j, 0.5 * rabi);
+}
+
+void LindbladSystem::AddDecay(std::size_t from, std::size_t to, double rate) {
+  Operator_t op(m_levels, m_levels);
+  op.insert(to, from) = 1.0;
+  AddCollapseOperator(op, rate);
+}
+
+void LindbladSystem::AddCollapseOperator(const Operator_t& op, double rate) {
+  m_collapseOps.push_back(std::sqrt(rate) * op);
+}
+
+void LindbladSystem::AddObservable(const std::string& name,
+                                   const Operator_t& op) {
+  m_observableNames.push_back(name);
+  m_observables.push_back(op);
+}
+
+void LindbladSystem::AddPopulationObservable(const std::string& name,
+                                             std::size_t level) {
+  Operator_t op(m_levels, m_levels);
+  op.insert(level, level) = 1.0;
+  AddObservable(name, op);
+}
+
+LindbladSystem::Operator_t LindbladSystem::BuildLiouvillian() const {
+  Operator_t liouvillian = HamiltonianSuperoperator(m_hamiltonian);
+  for (const auto& op : m_collapseOps)
+    liouvillian += DissipatorSuperoperator(op);
+  liouvillian.prune(Scalar_t(0));
+  liouvillian.makeCompressed();
+  return liouvillian;
+}
+
+LindbladSystem::Operator_t LindbladSystem::BuildObservableMatrix() const {
+  // Tr(O rho) = sum_ij O_ij rho_ji = vec(O^T) . vec(rho)
+  std::vector<Eigen::Triplet<Scalar_t>> triplets;
+  for (std::size_t k = 0; k < m_observables.size(); k++) {
+    const auto& op = m_observables[k];
+    for (int col = 0; col < op.outerSize(); col++) {
+      for (Operator_t::InnerIterator it(op, col); it; ++it)
+        triplets.emplace_back(k, it.row() * m_levels + it.col(), it.value());
+    }
+  }
+
+  Operator_t mat(m_observables.size(), m_levels * m_levels);
+  mat.setFromTriplets(triplets.begin(), triplets.end());
+  return mat;
+}
+
+LindbladSystem::Operator_t LindbladSystem::HamiltonianSuperoperator(
+    const Operator_t& hamiltonian) {
+  // vec(A X B) = (B^T (x) A) vec(X)
+  // -i [H, rho] -> -i (1 (x) H - H^T (x) 1)
+  const auto n = hamiltonian.rows();
+  Operator_t id(n, n);
+  id.setIdentity();
+  Operator_t ht = hamiltonian.transpose();
+  return Scalar_t(0, -1) *
+         (KroneckerProduct(id, hamiltonian) - KroneckerProduct(ht, id));
+}
+
+LindbladSystem::Operator_t LindbladSystem::DissipatorSuperoperator(
+    const Operator_t& op) {
+  // D[L] rho = L rho L^+ - 1/2 {L^+ L, rho}
+  //   -> conj(L) (x) L - 1/2 (1 (x) L^+ L) - 1/2 ((L^+ L)^T (x) 1)
+  const auto n = op.rows();
+  Operator_t id(n, n);
+  id.setIdentity();
+  Operator_t opConj = op.conjugate();
+  Operator_t ldl = op.adjoint() * op;
+  Operator_t ldlT = ldl.transpose();
+  return KroneckerProduct(opConj, op) -
+         0.5 * (KroneckerProduct(id, ldl) + KroneckerProduct(ldlT, id));
+}
+
+LindbladSystem::Operator_t LindbladSystem::KroneckerProduct(
+    const Operator_t& lhs, const Operator_t& rhs) {
+  const auto rows = lhs.rows() * rhs.rows();
+  const auto cols = lhs.cols() * rhs.cols();
+  Operator_t res(rows, cols);
+
+  // number of non-zeros per column is known in advance
+  Eigen::VectorXi nnz(cols);
+  for (int lc = 0; lc < lhs.outerSize(); lc++) {
+    const int lnnz = lhs.col(lc).nonZeros();
+    for (int rc = 0; rc < rhs.outerSize(); rc++)
+      nnz[lc * rhs.cols() + rc] = lnnz * rhs.col(rc).nonZeros();
+  }
+  res.reserve(nnz);
+
+  for (int lc = 0; lc < lhs.outerSize(); lc++) {
+    for (Operator_t::InnerIterator lit(lhs, lc); lit; ++lit) {
+      for (int rc = 0; rc < rhs.outerSize(); rc++) {
+        for (Operator_t::InnerIterator rit(rhs, rc); rit; ++rit) {
+          res.insert(lit.row() * rhs.rows() + rit.row(),
+                     lc * rhs.cols() + rc) = lit.value() * rit.value();
+        }
+      }
+    }
+  }
+  res.makeCompressed();
+  return res;
+}
+
+}  // namespace QPT
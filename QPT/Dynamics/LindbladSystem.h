@@ -0,0 +1,79 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_LINDBLADSYSTEM_H_
+#define QPT_DYNAMICS_LINDBLADSYSTEM_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <complex>
+#include <string>
+#include <vector>
+
+namespace QPT {
+
+// Description of an N-level open quantum system in Lindblad form
+//   d rho / dt = -i [H, rho] + sum_k rate_k D[L_k] rho
+// The Hamiltonian is stored in angular frequency units (H / hbar, rad/s).
+// Density matrices are vectorized by stacking their columns, which is the
+// storage order of a column-major Eigen::MatrixXcd.
+class LindbladSystem {
+ public:
+  using Scalar_t = std::complex<double>;
+  using Operator_t = Eigen::SparseMatrix<Scalar_t>;
+
+  explicit LindbladSystem(std::size_t levels);
+
+  std::size_t GetLevelCount() const { return m_levels; }
+
+  // Adds value to H_ij (and conj(value) to H_ji if i != j), in rad/s
+  void AddHamiltonianTerm(std::size_t i, std::size_t j, Scalar_t value);
+  void AddHamiltonian(const Operator_t& hamiltonian);
+  // Adds a Hamiltonian given in energy units (J)
+  void AddHamiltonianEnergy(const Operator_t& hamiltonian);
+  // Resonant dipole coupling in the rotating wave approximation. The dipole
+  // moment is given in Debye and the field amplitude in V/m.
+  void AddDipoleCoupling(std::size_t i, std::size_t j, double dipoleMoment,
+                         double fieldAmplitude);
+
+  // Spontaneous decay |from> -> |to> with the given rate (1/s)
+  void AddDecay(std::size_t from, std::size_t to, double rate);
+  void AddCollapseOperator(const Operator_t& op, double rate);
+
+  void AddObservable(const std::string& name, const Operator_t& op);
+  void AddPopulationObservable(const std::string& name, std::size_t level);
+  std::size_t GetObservableCount() const { return m_observables.size(); }
+  const std::string& GetObservableName(std::size_t idx) const {
+    return m_observableNames[idx];
+  }
+  const Operator_t& GetObservable(std::size_t idx) const {
+    return m_observables[idx];
+  }
+
+  const Operator_t& GetHamiltonian() const { return m_hamiltonian; }
+  // collapse operators including the square roots of their rates
+  const std::vector<Operator_t>& GetCollapseOperators() const {
+    return m_collapseOps;
+  }
+
+  // Liouvillian acting on vectorized density matrices (N^2 x N^2)
+  Operator_t BuildLiouvillian() const;
+  // Maps a vectorized density matrix onto the observables Tr(O rho)
+  Operator_t BuildObservableMatrix() const;
+
+  // Superoperators of -i[H, .] and D[L] in column-stacking convention
+  static Operator_t HamiltonianSuperoperator(const Operator_t& hamiltonian);
+  static Operator_t DissipatorSuperoperator(const Operator_t& op);
+  static Operator_t KroneckerProduct(const Operator_t& lhs,
+                                     const Operator_t& rhs);
+
+ private:
+  std::size_t m_levels;
+  Operator_t m_hamiltonian;
+  std::vector<Operator_t> m_collapseOps;
+  std::vector<std::string> m_observableNames;
+  std::vector<Operator_t> m_observables;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_LINDBLADSYSTEM_H_
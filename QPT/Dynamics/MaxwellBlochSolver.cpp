@@ -0,0 +1,233 @@
+// Philipp Neufeld, 2023
+
+#include "MaxwellBlochSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "../Constants.h"
+#include "../Profiling/Profiler.h"
+#include "DormandPrince.h"
+
+namespace QPT {
+
+struct MaxwellBlochSolver::Slice {
+  DormandPrince<Eigen::VectorXcd> integrator;
+  Eigen::VectorXcd rho;
+  // field entering the slice at the last processed time
+  std::complex<double> lastField;
+};
+
+MaxwellBlochSolver::MaxwellBlochSolver(const LindbladSystem& system,
+                                       std::size_t ground,
+                                       std::size_t excited, double coupling)
+    : m_levels(system.GetLevelCount()),
+      m_coherence(ground * system.GetLevelCount() + excited),
+      m_coupling(coupling),
+      m_liouvillian(system.BuildLiouvillian()) {
+  // H_probe = Omega P + conj(Omega) P^dagger with P = |e><g| / 2
+  LindbladSystem::Operator_t up(m_levels, m_levels), down(m_levels, m_levels);
+  up.insert(excited, ground) = 0.5;
+  down.insert(ground, excited) = 0.5;
+  m_probeUp = LindbladSystem::HamiltonianSuperoperator(up);
+  m_probeDown = LindbladSystem::HamiltonianSuperoperator(down);
+}
+
+double MaxwellBlochSolver::GetCouplingConstant(double density,
+                                               double dipoleMoment,
+                                               double wavelength) {
+  const double d = dipoleMoment * Debye_v;
+  return TwoPi_v / wavelength * density * d * d /
+         (VacuumPermittivity_v * ReducedPlanckConstant_v);
+}
+
+void MaxwellBlochSolver::SetTolerances(double absTol, double relTol) {
+  m_absTol = absTol;
+  m_relTol = relTol;
+}
+
+std::vector<std::size_t> MaxwellBlochSolver::GetOutputBoundaries(
+    std::size_t slices) const {
+  const std::size_t stride = (m_outputStride == 0) ? slices : m_outputStride;
+  std::vector<std::size_t> boundaries;
+  for (std::size_t j = 0; j < slices; j += stride) boundaries.push_back(j);
+  boundaries.push_back(slices);
+  return boundaries;
+}
+
+bool MaxwellBlochSolver::ProcessBlock(Slice& slice,
+                                      const std::complex<double>* in,
+                                      std::complex<double>* out,
+                                      std::size_t first,
+                                      std::size_t count) const {
+  QPT_PROFILE_SCOPE("MaxwellBlochSolver::ProcessBlock");
+  const std::complex<double> i(0, 1);
+  for (std::size_t k = 0; k < count; k++) {
+    const std::size_t step = first + k;
+    if (step > 0) {
+      // Omega interpolated linearly between tau_{step - 1} and tau_step
+      const double t0 = (step - 1) * m_dt;
+      const auto f0 = slice.lastField;
+      const auto slope = (in[k] - f0) / m_dt;
+      auto rhs = [&](double t, const Eigen::VectorXcd& y,
+                     Eigen::VectorXcd& dy) {
+        const auto field = f0 + slope * (t - t0);
+        dy.noalias() = m_liouvillian * y;
+        dy.noalias() += field * (m_probeUp * y);
+        dy.noalias() += std::conj(field) * (m_probeDown * y);
+      };
+      double t = t0;
+      if (!slice.integrator.Integrate(rhs, t, step * m_dt, slice.rho))
+        return false;
+    }
+    slice.lastField = in[k];
+    out[k] = in[k] - i * m_coupling * m_dz * slice.rho[m_coherence];
+  }
+  return true;
+}
+
+bool MaxwellBlochSolver::Propagate(ThreadPool& pool,
+                                   const Eigen::MatrixXcd& rho0,
+                                   const Field_t& input, double length,
+                                   std::size_t slices, double dt,
+                                   std::size_t steps,
+                                   const Observer_t& observer) {
+  using Complex_t = std::complex<double>;
+  const Eigen::Index n = m_levels;
+  if (rho0.rows() != n || rho0.cols() != n || slices == 0 || dt <= 0)
+    return false;
+  m_dt = dt;
+  m_dz = length / slices;
+
+  const std::size_t B = m_blockSize;
+  const std::size_t points = steps + 1;
+  const std::size_t blocks = (points + B - 1) / B;
+  // at most this many slices / blocks are in flight at the same time
+  const std::size_t window = std::min(slices, blocks);
+
+  const auto boundaries = GetOutputBoundaries(slices);
+  const std::size_t nOut = boundaries.size();
+  std::vector<std::size_t> outputColumn(slices + 1, nOut);
+  for (std::size_t c = 0; c < nOut; c++) outputColumn[boundaries[c]] = c;
+
+  // ring buffers: states of the active slices, the field leaving them
+  // (double buffered by block parity, one extra slot such that a slice
+  // never reads and writes the same buffer) and the output rows of the
+  // blocks that are still inside the medium
+  std::vector<std::unique_ptr<Slice>> states(window);
+  std::vector<Complex_t> fields((window + 1) * 2 * B);
+  std::vector<Complex_t> rows(window * B * nOut);
+  const Eigen::VectorXcd rhoVec =
+      Eigen::Map<const Eigen::VectorXcd>(rho0.data(), n * n);
+
+  auto field = [&](std::size_t slot, std::size_t block) {
+    return fields.data() + (slot * 2 + block % 2) * B;
+  };
+  auto store = [&](std::size_t boundary, std::size_t block,
+                   const Complex_t* values, std::size_t count) {
+    const std::size_t c = outputColumn[boundary];
+    if (c == nOut) return;
+    Complex_t* row = rows.data() + (block % window) * B * nOut;
+    for (std::size_t k = 0; k < count; k++) row[k * nOut + c] = values[k];
+  };
+
+  // wavefront d processes slice j at block d - j; a failed slice stops the
+  // propagation after its wavefront (later slices would use a wrong field)
+  std::atomic<bool> failed = false;
+  for (std::size_t d = 0; d < slices + blocks - 1; d++) {
+    const std::size_t jBegin = (d >= blocks) ? d - blocks + 1 : 0;
+    const std::size_t jEnd = std::min(d + 1, slices);
+    pool.ParallelFor(jBegin, jEnd, [&](std::size_t j) {
+      const std::size_t b = d - j;
+      const std::size_t first = b * B;
+      const std::size_t count = std::min(B, points - first);
+      auto& slice = states[j % window];
+      if (b == 0) {
+        slice = std::make_unique<Slice>();
+        slice->integrator.SetTolerances(m_absTol, m_relTol);
+        slice->rho = rhoVec;
+      }
+
+      std::vector<Complex_t> inBuffer;
+      const Complex_t* in;
+      if (j == 0) {
+        inBuffer.resize(count);
+        for (std::size_t k = 0; k < count; k++)
+          inBuffer[k] = input((first + k) * dt);
+        in = inBuffer.data();
+        store(0, b, in, count);
+      } else {
+        in = field((j - 1) % (window + 1), b);
+      }
+
+      Complex_t* out = field(j % (window + 1), b);
+      if (!ProcessBlock(*slice, in, out, first, count)) {
+        failed.store(true, std::memory_order_relaxed);
+        return;
+      }
+      store(j + 1, b, out, count);
+      if (b + 1 == blocks) slice.reset();
+    });
+    if (failed.load(std::memory_order_relaxed)) return false;
+
+    // block d - (slices - 1) has left the medium
+    if (d + 1 < slices) continue;
+    const std::size_t b = d + 1 - slices;
+    const std::size_t first = b * B;
+    const std::size_t count = std::min(B, points - first);
+    const Complex_t* row = rows.data() + (b % window) * B * nOut;
+    for (std::size_t k = 0; k < count; k++) {
+      if (!observer((first + k) * dt, row + k * nOut)) return false;
+    }
+  }
+  return true;
+}
+
+bool MaxwellBlochSolver::Propagate(ThreadPool& pool,
+                                   const Eigen::MatrixXcd& rho0,
+                                   const Field_t& input, double length,
+                                   std::size_t slices, double dt,
+                                   std::size_t steps, H5Group& group,
+                                   const std::string& name) {
+  const auto boundaries = GetOutputBoundaries(slices);
+  const std::size_t rowSize = 1 + 2 * boundaries.size();
+  // chunks of about 1 MiB, independent of the number of boundaries
+  const std::size_t chunkRows =
+      std::max<std::size_t>((1 << 20) / (rowSize * sizeof(double)), 1);
+  auto ds = group.CreateAppendableDataset<double>(name, {rowSize}, chunkRows);
+  if (!ds || !ds->SetAttribute("column0", std::string("tau")))
+    return false;
+  for (std::size_t c = 0; c < boundaries.size(); c++) {
+    const auto z = std::to_string(length * boundaries[c] / slices);
+    if (!ds->SetAttribute("column" + std::to_string(2 * c + 1),
+                          "Re Omega(z=" + z + ")") ||
+        !ds->SetAttribute("column" + std::to_string(2 * c + 2),
+                          "Im Omega(z=" + z + ")"))
+      return false;
+  }
+
+  // rows are buffered per time block and appended in one call
+  std::vector<double> buffer;
+  buffer.reserve(m_blockSize * rowSize);
+  bool success = true;
+  auto flush = [&]() {
+    if (!buffer.empty())
+      success = success && ds->AppendData(buffer.size() / rowSize,
+                                          buffer.data());
+    buffer.clear();
+    return success;
+  };
+  auto observer = [&](double tau, const std::complex<double>* field) {
+    buffer.push_back(tau);
+    for (std::size_t c = 0; c < boundaries.size(); c++) {
+      buffer.push_back(field[c].real());
+      buffer.push_back(field[c].imag());
+    }
+    return (buffer.size() < m_blockSize * rowSize) || flush();
+  };
+  return Propagate(pool, rho0, input, length, slices, dt, steps, observer) &&
+         flush();
+}
+
+}  // namespace QPT
@@ -0,0 +1,106 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_MAXWELLBLOCHSOLVER_H_
+#define QPT_DYNAMICS_MAXWELLBLOCHSOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <complex>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Propagation of a probe field through an optically thick medium in the
+// retarded frame (tau = t - z / c). The medium is divided into slices of
+// thickness dz whose atoms (a LindbladSystem with the probe coupling
+// H_eg = Omega / 2 added) respond to the Rabi frequency Omega of the probe
+// entering the slice. The field leaving the slice follows from
+//   d Omega / dz = -i eta rho_eg
+// with the coupling eta = k N d^2 / (eps_0 hbar) (first order in dz).
+// Slice j at time block b only depends on slice j - 1 at block b, so the
+// (slice, block) grid is processed in anti-diagonal wavefronts: all slices
+// of a wavefront run in parallel. Only the active slices (at most the
+// number of time blocks) are kept in memory together with the field of
+// their block, hence the memory does not depend on the length of the
+// medium. The field at the output positions is passed on (and written) as
+// soon as a time block has left the medium.
+class MaxwellBlochSolver {
+ public:
+  using Field_t = std::function<std::complex<double>(double)>;
+  // receives the field at the output positions for consecutive times,
+  // returns false to abort
+  using Observer_t =
+      std::function<bool(double, const std::complex<double>*)>;
+
+  // probe transition ground -> excited of the system
+  MaxwellBlochSolver(const LindbladSystem& system, std::size_t ground,
+                     std::size_t excited, double coupling);
+  // eta for the number density N (1/m^3), the transition dipole moment d
+  // (Debye) and the wavelength (m)
+  static double GetCouplingConstant(double density, double dipoleMoment,
+                                    double wavelength);
+
+  void SetTolerances(double absTol, double relTol);
+  // time steps per task (part of the pipeline granularity)
+  void SetBlockSize(std::size_t steps) {
+    m_blockSize = std::max<std::size_t>(steps, 1);
+  }
+  // the field is reported at every stride-th slice boundary and at the exit
+  // (0: only at the entrance and the exit)
+  void SetOutputStride(std::size_t stride) { m_outputStride = stride; }
+
+  // Propagates the incident field input(tau) through a medium of the given
+  // length (slices slices) for tau_k = k dt, k = 0, ..., steps. All atoms
+  // start in rho0.
+  bool Propagate(ThreadPool& pool, const Eigen::MatrixXcd& rho0,
+                 const Field_t& input, double length, std::size_t slices,
+                 double dt, std::size_t steps, const Observer_t& observer);
+  // Same as above but appends the rows (tau, Re Omega(z_1), Im Omega(z_1),
+  // ...) to a new appendable dataset in group.
+  bool Propagate(ThreadPool& pool, const Eigen::MatrixXcd& rho0,
+                 const Field_t& input, double length, std::size_t slices,
+                 double dt, std::size_t steps, H5Group& group,
+                 const std::string& name);
+
+  // slice boundaries at which the field is reported (0: entrance)
+  std::vector<std::size_t> GetOutputBoundaries(std::size_t slices) const;
+
+ private:
+  // state of an active slice
+  struct Slice;
+
+  // advances the slice through the time steps first, ..., first + count - 1
+  // (reads the field entering the slice, writes the field leaving it).
+  // Returns false if the integration of a step fails.
+  bool ProcessBlock(Slice& slice, const std::complex<double>* in,
+                    std::complex<double>* out, std::size_t first,
+                    std::size_t count) const;
+
+ private:
+  std::size_t m_levels;
+  std::size_t m_coherence;  // index of rho_eg in the vectorized rho
+  double m_coupling;
+  double m_absTol = 1e-10;
+  double m_relTol = 1e-7;
+  std::size_t m_blockSize = 64;
+  std::size_t m_outputStride = 0;
+
+  // L(Omega) = L_0 + Omega L_+ + conj(Omega) L_-
+  LindbladSystem::Operator_t m_liouvillian;
+  LindbladSystem::Operator_t m_probeUp;
+  LindbladSystem::Operator_t m_probeDown;
+
+  // set by Propagate
+  double m_dt = 0;
+  double m_dz = 0;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_MAXWELLBLOCHSOLVER_H_
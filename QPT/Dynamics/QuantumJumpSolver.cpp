@@ -0,0 +1,278 @@
+// Philipp Neufeld, 2023
+
+#include "QuantumJumpSolver.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "../Profiling/Profiler.h"
+#include "DormandPrince.h"
+
+namespace QPT {
+
+namespace {
+
+std::uint64_t Mix(std::uint64_t z) {
+  // splitmix64 finalizer
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// Counter-based random numbers: the n-th number of a stream is a hash of
+// (seed, stream, n), independent of any other stream
+class CounterRng {
+ public:
+  CounterRng(std::uint64_t seed, std::uint64_t stream)
+      : m_key(Mix(seed ^ Mix(stream + 0x9E3779B97F4A7C15ull))) {}
+
+  // uniform in [0, 1)
+  double Uniform() {
+    m_counter++;
+    return (Mix(m_key + m_counter * 0x9E3779B97F4A7C15ull) >> 11) * 0x1.0p-53;
+  }
+
+ private:
+  std::uint64_t m_key;
+  std::uint64_t m_counter = 0;
+};
+
+}  // namespace
+
+struct QuantumJumpSolver::Workspace {
+  DormandPrince<Eigen::VectorXcd> integrator;
+  Eigen::VectorXcd psi, saved, tmp;
+  // sums of the expectation values and their squares (one row per output)
+  Expectation_t sum, sumSq;
+  std::vector<JumpRecord> jumps;
+};
+
+QuantumJumpSolver::QuantumJumpSolver(const LindbladSystem& system)
+    : m_levels(system.GetLevelCount()),
+      m_collapseOps(system.GetCollapseOperators()) {
+  for (std::size_t i = 0; i < system.GetObservableCount(); i++) {
+    m_observableNames.push_back(system.GetObservableName(i));
+    m_observables.push_back(system.GetObservable(i));
+  }
+
+  // -i H_eff = -i H - 1/2 sum_k L_k^+ L_k
+  const LindbladSystem::Scalar_t i(0, 1);
+  m_generator = -i * system.GetHamiltonian();
+  for (const auto& op : m_collapseOps) {
+    const LindbladSystem::Operator_t decay = op.adjoint() * op;
+    m_generator -= 0.5 * decay;
+  }
+  m_generator.prune(LindbladSystem::Scalar_t(0));
+  m_generator.makeCompressed();
+}
+
+void QuantumJumpSolver::SetTolerances(double absTol, double relTol) {
+  m_absTol = absTol;
+  m_relTol = relTol;
+}
+
+void QuantumJumpSolver::Observe(Workspace& ws, std::size_t output) const {
+  const double norm2 = ws.psi.squaredNorm();
+  for (std::size_t k = 0; k < m_observables.size(); k++) {
+    ws.tmp.noalias() = m_observables[k] * ws.psi;
+    const double value = ws.psi.dot(ws.tmp).real() / norm2;
+    ws.sum(output, k) += value;
+    ws.sumSq(output, k) += value * value;
+  }
+}
+
+bool QuantumJumpSolver::RunTrajectory(Workspace& ws, std::uint64_t trajectory,
+                                      const Eigen::VectorXcd& psi0, double t0,
+                                      double t1, std::size_t outputs) const {
+  QPT_PROFILE_SCOPE("QuantumJumpSolver::RunTrajectory");
+  auto rhs = [this](double, const Eigen::VectorXcd& y, Eigen::VectorXcd& dy) {
+    dy.noalias() = m_generator * y;
+  };
+  auto& integrator = ws.integrator;
+  integrator.SetTolerances(m_absTol, m_relTol);
+  // no state is carried over from the previous trajectory of the task
+  integrator.SetInitialStepSize(0);
+
+  CounterRng rng(m_seed, trajectory);
+  // a jump occurs once |psi|^2 drops below r in (0, 1]
+  double r = 1 - rng.Uniform();
+  const double timeTol = m_jumpTol * (t1 - t0);
+
+  ws.psi = psi0 / psi0.norm();
+  Observe(ws, 0);
+  double t = t0;
+  for (std::size_t i = 1; i <= outputs; i++) {
+    const double tNext = t0 + (t1 - t0) * i / outputs;
+    while (t < tNext) {
+      ws.saved = ws.psi;
+      double lo = t;
+      if (!integrator.Integrate(rhs, t, tNext, ws.psi)) return false;
+      if (ws.psi.squaredNorm() > r) break;
+
+      // bisection for the jump time (the norm decreases monotonically)
+      double hi = tNext;
+      while (hi - lo > timeTol) {
+        const double mid = 0.5 * (lo + hi);
+        double tMid = lo;
+        ws.tmp = ws.saved;
+        if (!integrator.Integrate(rhs, tMid, mid, ws.tmp)) return false;
+        if (ws.tmp.squaredNorm() > r) {
+          lo = mid;
+          ws.saved.swap(ws.tmp);
+        } else {
+          hi = mid;
+        }
+      }
+      ws.psi = ws.saved;
+      t = lo;
+      if (!integrator.Integrate(rhs, t, hi, ws.psi)) return false;
+
+      // channel k with probability |L_k psi|^2 / sum_j |L_j psi|^2
+      double total = 0;
+      for (const auto& op : m_collapseOps) total += (op * ws.psi).squaredNorm();
+      if (total > 0) {
+        const double u = rng.Uniform() * total;
+        std::size_t channel = 0;
+        double cumulative = 0;
+        for (; channel + 1 < m_collapseOps.size(); channel++) {
+          ws.tmp.noalias() = m_collapseOps[channel] * ws.psi;
+          cumulative += ws.tmp.squaredNorm();
+          if (u < cumulative) break;
+        }
+        ws.tmp.noalias() = m_collapseOps[channel] * ws.psi;
+        ws.jumps.push_back(
+            {trajectory, t, static_cast<std::uint32_t>(channel)});
+        ws.psi = ws.tmp;
+      }
+      ws.psi.normalize();
+      r = 1 - rng.Uniform();
+    }
+    Observe(ws, i);
+  }
+  return true;
+}
+
+bool QuantumJumpSolver::Run(ThreadPool& pool, const Eigen::VectorXcd& psi0,
+                            double t0, double t1, std::size_t outputs,
+                            std::size_t trajectories,
+                            const JumpObserver_t& jumpObserver) {
+  if (psi0.size() != static_cast<Eigen::Index>(m_levels) || outputs == 0 ||
+      trajectories == 0 || t1 <= t0 || psi0.norm() == 0)
+    return false;
+
+  const std::size_t rows = outputs + 1;
+  const std::size_t cols = m_observables.size();
+  m_jumps = 0;
+  m_times.resize(rows);
+  for (std::size_t i = 0; i < rows; i++)
+    m_times[i] = t0 + (t1 - t0) * i / outputs;
+  Expectation_t sum = Expectation_t::Zero(rows, cols);
+  Expectation_t sumSq = Expectation_t::Zero(rows, cols);
+
+  // the blocks are processed in rounds that bound the memory of the
+  // jump records; the partial sums are reduced in block order
+  const std::size_t blocks = (trajectories + m_batchSize - 1) / m_batchSize;
+  const std::size_t roundSize =
+      4 * std::max<std::size_t>(pool.GetThreadCount(), 1);
+  std::vector<Workspace> workspaces(roundSize);
+  std::atomic<bool> failed = false;
+  for (std::size_t first = 0; first < blocks; first += roundSize) {
+    const std::size_t last = std::min(blocks, first + roundSize);
+    pool.ParallelFor(first, last, [&](std::size_t block) {
+      auto& ws = workspaces[block - first];
+      ws.sum.setZero(rows, cols);
+      ws.sumSq.setZero(rows, cols);
+      ws.jumps.clear();
+      const std::size_t end =
+          std::min(trajectories, (block + 1) * m_batchSize);
+      for (std::size_t i = block * m_batchSize; i < end && !failed; i++) {
+        if (!RunTrajectory(ws, i, psi0, t0, t1, outputs)) failed = true;
+      }
+    });
+    if (failed) return false;
+
+    for (std::size_t block = first; block < last; block++) {
+      const auto& ws = workspaces[block - first];
+      sum += ws.sum;
+      sumSq += ws.sumSq;
+      m_jumps += ws.jumps.size();
+      if (jumpObserver && !ws.jumps.empty() && !jumpObserver(ws.jumps))
+        return false;
+    }
+  }
+
+  const double n = static_cast<double>(trajectories);
+  m_mean = sum / n;
+  m_error.resize(rows, cols);
+  for (std::size_t i = 0; i < rows; i++) {
+    for (std::size_t k = 0; k < cols; k++) {
+      const double mean = m_mean(i, k);
+      // unbiased sample variance of the trajectory values
+      const double var =
+          (n > 1) ? (sumSq(i, k) / n - mean * mean) * n / (n - 1) : 0;
+      m_error(i, k) = std::sqrt(std::max(var, 0.0) / n);
+    }
+  }
+  return true;
+}
+
+bool QuantumJumpSolver::Run(ThreadPool& pool, const Eigen::VectorXcd& psi0,
+                            double t0, double t1, std::size_t outputs,
+                            std::size_t trajectories, H5Group& group) {
+  for (const char* name : {"jumps", "mean", "error"}) {
+    if ((group.HasDataset(name) || group.HasSubgroup(name)) &&
+        !group.Remove(name))
+      return false;
+  }
+  // one column per dataset to keep the integer columns exact
+  auto jumps = group.OpenSubgroup("jumps");
+  if (!jumps) return false;
+  auto trajectoryDs =
+      jumps->CreateAppendableDataset<std::uint64_t>("trajectory", {});
+  auto timeDs = jumps->CreateAppendableDataset<double>("t", {});
+  auto channelDs = jumps->CreateAppendableDataset<std::uint32_t>("channel", {});
+  if (!trajectoryDs || !timeDs || !channelDs) return false;
+
+  std::vector<std::uint64_t> trajectoryIds;
+  std::vector<double> times;
+  std::vector<std::uint32_t> channels;
+  auto observer = [&](const std::vector<JumpRecord>& records) {
+    trajectoryIds.resize(records.size());
+    times.resize(records.size());
+    channels.resize(records.size());
+    for (std::size_t i = 0; i < records.size(); i++) {
+      trajectoryIds[i] = records[i].trajectory;
+      times[i] = records[i].time;
+      channels[i] = records[i].channel;
+    }
+    return trajectoryDs->AppendData(records.size(), trajectoryIds.data()) &&
+           timeDs->AppendData(records.size(), times.data()) &&
+           channelDs->AppendData(records.size(), channels.data());
+  };
+  if (!Run(pool, psi0, t0, t1, outputs, trajectories, observer)) return false;
+
+  // rows (t, <O_1>, ..., <O_m>) as written by LindbladSolver
+  const std::size_t rows = m_times.size();
+  const std::size_t cols = m_observables.size() + 1;
+  const std::pair<const char*, const Expectation_t*> tables[] = {
+      {"mean", &m_mean}, {"error", &m_error}};
+  for (const auto& table : tables) {
+    Expectation_t data(rows, cols);
+    data.col(0) = m_times;
+    data.rightCols(cols - 1) = *table.second;
+    auto ds = group.CreateUninitializedDataset<double>(table.first,
+                                                       {rows, cols});
+    if (!ds || !ds->SetSlabData({0, 0}, {rows, cols}, data.data()) ||
+        !ds->SetAttribute("trajectories",
+                          static_cast<std::uint64_t>(trajectories)) ||
+        !ds->SetAttribute("column0", std::string("t")))
+      return false;
+    for (std::size_t i = 0; i < m_observableNames.size(); i++) {
+      const auto attr = "column" + std::to_string(i + 1);
+      if (!ds->SetAttribute(attr, m_observableNames[i])) return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace QPT
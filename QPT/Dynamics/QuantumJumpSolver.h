@@ -0,0 +1,108 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_QUANTUMJUMPSOLVER_H_
+#define QPT_DYNAMICS_QUANTUMJUMPSOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Monte Carlo wavefunction (quantum jump) unravelling of a LindbladSystem.
+// Every trajectory evolves a state vector with the non-hermitian effective
+// Hamiltonian H - i/2 sum_k L_k^+ L_k until its squared norm drops below a
+// uniform random number; the jump time is located by bisection and the
+// channel is drawn with probability ~ |L_k psi|^2. Memory scales with N
+// instead of N^2. Averaging the normalized expectation values over many
+// trajectories reproduces the density matrix result.
+// Trajectory i draws its random numbers from a counter-based stream keyed by
+// (seed, i) and the trajectories are processed in blocks of fixed size whose
+// partial sums are reduced in block order. The results are therefore
+// bit-identical for any number of threads.
+class QuantumJumpSolver {
+ public:
+  using Expectation_t =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  struct JumpRecord {
+    std::uint64_t trajectory;
+    double time;
+    std::uint32_t channel;  // index of the collapse operator
+  };
+  // receives the jumps of consecutive blocks of trajectories in order
+  // (sorted by trajectory and time), returns false to abort
+  using JumpObserver_t = std::function<bool(const std::vector<JumpRecord>&)>;
+
+  explicit QuantumJumpSolver(const LindbladSystem& system);
+
+  void SetTolerances(double absTol, double relTol);
+  void SetSeed(std::uint64_t seed) { m_seed = seed; }
+  // number of trajectories per task (part of the reduction order)
+  void SetBatchSize(std::size_t size) {
+    m_batchSize = std::max<std::size_t>(size, 1);
+  }
+  // resolution of the jump times relative to t1 - t0
+  void SetJumpTimeTolerance(double tol) { m_jumpTol = tol; }
+
+  // Runs the trajectories 0 ... trajectories - 1 from psi0 at t0 to t1. The
+  // observables of the system are averaged at outputs + 1 equidistant times.
+  bool Run(ThreadPool& pool, const Eigen::VectorXcd& psi0, double t0,
+           double t1, std::size_t outputs, std::size_t trajectories,
+           const JumpObserver_t& jumpObserver = nullptr);
+
+  // Same as above but appends the jump records to the datasets "trajectory"
+  // (uint64), "t" and "channel" (uint32) of the subgroup "jumps" and writes
+  // the datasets "mean" and "error" with rows (t, <O_1>, ..., <O_m>).
+  // Existing datasets are replaced.
+  bool Run(ThreadPool& pool, const Eigen::VectorXcd& psi0, double t0,
+           double t1, std::size_t outputs, std::size_t trajectories,
+           H5Group& group);
+
+  // trajectory averages and their standard errors (one row per output time)
+  const Eigen::VectorXd& GetTimes() const { return m_times; }
+  const Expectation_t& GetMean() const { return m_mean; }
+  const Expectation_t& GetStandardError() const { return m_error; }
+  std::size_t GetJumpCount() const { return m_jumps; }
+
+ private:
+  // per task workspace
+  struct Workspace;
+
+  // evolves one trajectory and adds its expectation values (and squares)
+  bool RunTrajectory(Workspace& ws, std::uint64_t trajectory,
+                     const Eigen::VectorXcd& psi0, double t0, double t1,
+                     std::size_t outputs) const;
+  void Observe(Workspace& ws, std::size_t output) const;
+
+ private:
+  std::size_t m_levels;
+  std::vector<std::string> m_observableNames;
+  std::vector<LindbladSystem::Operator_t> m_observables;
+  std::vector<LindbladSystem::Operator_t> m_collapseOps;
+  // -i H_eff
+  LindbladSystem::Operator_t m_generator;
+
+  double m_absTol = 1e-8;
+  double m_relTol = 1e-6;
+  std::uint64_t m_seed = 0;
+  std::size_t m_batchSize = 16;
+  double m_jumpTol = 1e-9;
+
+  Eigen::VectorXd m_times;
+  Expectation_t m_mean;
+  Expectation_t m_error;
+  std::size_t m_jumps = 0;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_QUANTUMJUMPSOLVER_H_
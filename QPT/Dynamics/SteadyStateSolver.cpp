@@ -0,0 +1,150 @@
+// Philipp Neufeld, 2023
+
+#include "SteadyStateSolver.h"
+
+#include <Eigen/SparseLU>
+#include <algorithm>
+#include <limits>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+// Helpers
+using SparseLU_t = Eigen::SparseLU<LindbladSystem::Operator_t,
+                                   Eigen::COLAMDOrdering<int>>;
+
+SteadyStateSolver::SteadyStateSolver(
+    const LindbladSystem& system,
+    const LindbladSystem::Operator_t& detuningOperator)
+    : m_levels(system.GetLevelCount()),
+      m_observables(system.BuildObservableMatrix()) {
+  using Triplet_t = Eigen::Triplet<LindbladSystem::Scalar_t>;
+  for (std::size_t i = 0; i < system.GetObservableCount(); i++)
+    m_observableNames.push_back(system.GetObservableName(i));
+
+  const auto constant = system.BuildLiouvillian();
+  const auto linear =
+      LindbladSystem::HamiltonianSuperoperator(detuningOperator);
+
+  // the first equation is replaced by the trace condition
+  std::vector<Triplet_t> constTriplets, linTriplets;
+  for (std::size_t i = 0; i < m_levels; i++)
+    constTriplets.emplace_back(0, i * (m_levels + 1), 1.0);
+
+  // both matrices get the union of both patterns (explicit zeros)
+  auto addEntries = [&](const LindbladSystem::Operator_t& mat, bool isLinear) {
+    for (int col = 0; col < mat.outerSize(); col++) {
+      for (LindbladSystem::Operator_t::InnerIterator it(mat, col); it; ++it) {
+        if (it.row() == 0) continue;
+        const auto val = it.value();
+        constTriplets.emplace_back(it.row(), col, isLinear ? 0.0 : val);
+        linTriplets.emplace_back(it.row(), col, isLinear ? val : 0.0);
+      }
+    }
+  };
+  addEntries(constant, false);
+  addEntries(linear, true);
+  for (std::size_t i = 0; i < m_levels; i++)
+    linTriplets.emplace_back(0, i * (m_levels + 1), 0.0);
+
+  const auto n = m_levels * m_levels;
+  m_constant.resize(n, n);
+  m_linear.resize(n, n);
+  m_constant.setFromTriplets(constTriplets.begin(), constTriplets.end());
+  m_linear.setFromTriplets(linTriplets.begin(), linTriplets.end());
+  m_constant.makeCompressed();
+  m_linear.makeCompressed();
+}
+
+std::optional<Eigen::VectorXcd> SteadyStateSolver::Solve(
+    double detuning) const {
+  QPT_PROFILE_SCOPE("SteadyStateSolver::Solve");
+  LindbladSystem::Operator_t mat = m_constant + detuning * m_linear;
+  SparseLU_t lu;
+  lu.compute(mat);
+  if (lu.info() != Eigen::Success) return std::nullopt;
+
+  Eigen::VectorXcd rhs = Eigen::VectorXcd::Zero(mat.rows());
+  rhs[0] = 1.0;
+  Eigen::VectorXcd rho = lu.solve(rhs);
+  return rho;
+}
+
+void SteadyStateSolver::SolveBatch(const double* detunings, std::size_t n,
+                                   double* output) const {
+  QPT_PROFILE_SCOPE("SteadyStateSolver::SolveBatch");
+  const std::size_t nObs = m_observables.rows();
+  const Eigen::Index nnz = m_constant.nonZeros();
+
+  // the value arrays of both matrices share the same (compressed) pattern
+  LindbladSystem::Operator_t mat = m_constant;
+  Eigen::Map<Eigen::VectorXcd> values(mat.valuePtr(), nnz);
+  Eigen::Map<const Eigen::VectorXcd> constValues(m_constant.valuePtr(), nnz);
+  Eigen::Map<const Eigen::VectorXcd> linValues(m_linear.valuePtr(), nnz);
+
+  SparseLU_t lu;
+  lu.analyzePattern(mat);
+
+  Eigen::VectorXcd rhs = Eigen::VectorXcd::Zero(mat.rows());
+  rhs[0] = 1.0;
+  Eigen::VectorXcd rho(mat.rows());
+  Eigen::VectorXcd obs(nObs);
+
+  for (std::size_t i = 0; i < n; i++) {
+    double* row = output + i * nObs;
+    values = constValues + detunings[i] * linValues;
+    lu.factorize(mat);
+    if (lu.info() != Eigen::Success) {
+      std::fill(row, row + nObs, std::numeric_limits<double>::quiet_NaN());
+      continue;
+    }
+    rho = lu.solve(rhs);
+    obs.noalias() = m_observables * rho;
+    for (std::size_t k = 0; k < nObs; k++) row[k] = obs[k].real();
+  }
+}
+
+SteadyStateSolver::Spectrum_t SteadyStateSolver::SolveSpectrum(
+    ThreadPool& pool, const std::vector<double>& detunings) const {
+  const std::size_t n = detunings.size();
+  Spectrum_t spectrum(n, m_observables.rows());
+
+  std::size_t batch = m_batchSize;
+  if (batch == 0) {
+    // a few batches per thread for load balancing
+    const std::size_t tasks = 4 * pool.GetThreadCount();
+    batch = std::max<std::size_t>(1, (n + tasks - 1) / tasks);
+  }
+
+  pool.ParallelForBlocks(0, n, batch, [&](std::size_t b, std::size_t e) {
+    SolveBatch(detunings.data() + b, e - b, spectrum.row(b).data());
+  });
+  return spectrum;
+}
+
+std::optional<H5Dataset> SteadyStateSolver::SolveSpectrum(
+    ThreadPool& pool, const std::vector<double>& detunings, H5Group& group,
+    const std::string& name) const {
+  const std::size_t n = detunings.size();
+  const std::size_t nObs = m_observables.rows();
+  const auto spectrum = SolveSpectrum(pool, detunings);
+
+  Spectrum_t rows(n, nObs + 1);
+  rows.col(0) = Eigen::Map<const Eigen::VectorXd>(detunings.data(), n);
+  rows.rightCols(nObs) = spectrum;
+
+  auto ds = group.CreateUninitializedDataset<double>(name, {n, nObs + 1});
+  if (!ds || !ds->SetSlabData({0, 0}, {n, nObs + 1}, rows.data()))
+    return std::nullopt;
+
+  if (!ds->SetAttribute("column0", std::string("detuning")))
+    return std::nullopt;
+  for (std::size_t i = 0; i < m_observableNames.size(); i++) {
+    const auto attr = "column" + std::to_string(i + 1);
+    if (!ds->SetAttribute(attr, m_observableNames[i])) return std::nullopt;
+  }
+  return ds;
+}
+
+}  // namespace QPT
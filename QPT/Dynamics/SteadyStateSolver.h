@@ -0,0 +1,70 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_STEADYSTATESOLVER_H_
+#define QPT_DYNAMICS_STEADYSTATESOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/SparseCore>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Steady states of a LindbladSystem whose Hamiltonian depends linearly on a
+// detuning: H(delta) = H_0 + delta * H_d. The linear system
+//   L(delta) rho = 0, Tr(rho) = 1
+// is set up once with a fixed sparsity pattern such that only the values
+// change from one detuning to the next. Every worker analyses the pattern of
+// the sparse LU decomposition once and refactorizes numerically for all the
+// detunings of its batch.
+class SteadyStateSolver {
+ public:
+  using Spectrum_t =
+      Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+  SteadyStateSolver(const LindbladSystem& system,
+                    const LindbladSystem::Operator_t& detuningOperator);
+
+  // number of detunings per task (0: chosen automatically)
+  void SetBatchSize(std::size_t size) { m_batchSize = size; }
+
+  // Vectorized steady state density matrix for a single detuning
+  std::optional<Eigen::VectorXcd> Solve(double detuning) const;
+
+  // Real parts of the observables of the system for every detuning
+  // (one row per detuning). Rows of detunings for which the system is
+  // singular are filled with NaN.
+  Spectrum_t SolveSpectrum(ThreadPool& pool,
+                           const std::vector<double>& detunings) const;
+
+  // Computes the spectrum and writes it as a dataset with the rows
+  // (delta, <O_1>, ..., <O_m>)
+  std::optional<H5Dataset> SolveSpectrum(ThreadPool& pool,
+                                         const std::vector<double>& detunings,
+                                         H5Group& group,
+                                         const std::string& name) const;
+
+  // Serial kernel: writes the observables for n detunings into output
+  // (n x m, row-major). Reuses one symbolic factorization for all n.
+  void SolveBatch(const double* detunings, std::size_t n,
+                  double* output) const;
+  std::size_t GetObservableCount() const { return m_observables.rows(); }
+
+ private:
+  std::size_t m_levels;
+  std::size_t m_batchSize = 0;
+  std::vector<std::string> m_observableNames;
+  // system matrix A(delta) = m_constant + delta * m_linear (same pattern)
+  LindbladSystem::Operator_t m_constant;
+  LindbladSystem::Operator_t m_linear;
+  LindbladSystem::Operator_t m_observables;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_STEADYSTATESOLVER_H_
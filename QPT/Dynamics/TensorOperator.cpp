@@ -0,0 +1,135 @@
+// Philipp Neufeld, 2023
+
+#include "TensorOperator.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace QPT {
+
+TensorSpace::TensorSpace(std::vector<std::size_t> dimensions)
+    : m_dimensions(std::move(dimensions)),
+      m_strides(m_dimensions.size()),
+      m_dimension(1) {
+  for (std::size_t i = m_dimensions.size(); i-- > 0;) {
+    m_strides[i] = m_dimension;
+    m_dimension *= m_dimensions[i];
+  }
+}
+
+TensorTerm TensorTerm::Multiply(const TensorTerm& lhs, const TensorTerm& rhs) {
+  TensorTerm res;
+  res.coefficient = lhs.coefficient * rhs.coefficient;
+  res.factors.reserve(lhs.factors.size() + rhs.factors.size());
+
+  // merge the factors (both sorted by subsystem)
+  auto lIt = lhs.factors.begin(), rIt = rhs.factors.begin();
+  while (lIt != lhs.factors.end() || rIt != rhs.factors.end()) {
+    if (rIt == rhs.factors.end() ||
+        (lIt != lhs.factors.end() && lIt->first < rIt->first)) {
+      res.factors.push_back(*lIt++);
+    } else if (lIt == lhs.factors.end() || rIt->first < lIt->first) {
+      res.factors.push_back(*rIt++);
+    } else {
+      LindbladSystem::Operator_t prod = (*lIt->second) * (*rIt->second);
+      res.factors.emplace_back(
+          lIt->first,
+          std::make_shared<const LindbladSystem::Operator_t>(std::move(prod)));
+      ++lIt;
+      ++rIt;
+    }
+  }
+  return res;
+}
+
+TensorTerm TensorTerm::Adjoint() const {
+  TensorTerm res;
+  res.coefficient = std::conj(coefficient);
+  res.factors.reserve(factors.size());
+  for (const auto& [subsystem, op] : factors) {
+    LindbladSystem::Operator_t adj = op->adjoint();
+    res.factors.emplace_back(
+        subsystem,
+        std::make_shared<const LindbladSystem::Operator_t>(std::move(adj)));
+  }
+  return res;
+}
+
+std::optional<LindbladSystem::Operator_t> AssembleTensorTerms(
+    const TensorSpace& space, const std::vector<TensorTerm>& terms) {
+  using Operator_t = LindbladSystem::Operator_t;
+  using Scalar_t = LindbladSystem::Scalar_t;
+  using Index_t = Operator_t::StorageIndex;
+  using Entry_t = std::pair<std::size_t, Scalar_t>;
+
+  const std::size_t dim = space.GetDimension();
+  if (dim > static_cast<std::size_t>(std::numeric_limits<Index_t>::max()))
+    return std::nullopt;
+
+  // validate the factors and bound the number of non-zeros: a term has
+  // prod(nnz of the factors) * prod(dims of the remaining subsystems)
+  std::size_t nnzBound = 0;
+  for (const auto& term : terms) {
+    std::size_t nnz = dim;
+    for (std::size_t i = 0; i < term.factors.size(); i++) {
+      const auto& [subsystem, op] = term.factors[i];
+      if (subsystem >= space.GetSubsystemCount()) return std::nullopt;
+      if (i > 0 && term.factors[i - 1].first >= subsystem)
+        return std::nullopt;
+      const std::size_t localDim = space.GetSubsystemDimension(subsystem);
+      if (static_cast<std::size_t>(op->rows()) != localDim ||
+          static_cast<std::size_t>(op->cols()) != localDim)
+        return std::nullopt;
+      nnz = nnz / localDim * op->nonZeros();
+    }
+    nnzBound += nnz;
+  }
+
+  Operator_t res(dim, dim);
+  res.reserve(std::min(nnzBound, dim * dim));
+
+  std::vector<Entry_t> column, current, next;
+  for (std::size_t j = 0; j < dim; j++) {
+    column.clear();
+    for (const auto& term : terms) {
+      // row = j + sum_k (r_k - c_k) * stride_k for all combinations of the
+      // non-zeros (r_k, c_k) in the local columns c_k of j
+      current.assign(1, Entry_t(j, term.coefficient));
+      for (const auto& [subsystem, op] : term.factors) {
+        const std::size_t stride = space.GetStride(subsystem);
+        const std::size_t localCol =
+            (j / stride) % space.GetSubsystemDimension(subsystem);
+        next.clear();
+        for (const auto& [row, value] : current) {
+          const std::size_t base = row - localCol * stride;
+          for (Operator_t::InnerIterator it(*op, localCol); it; ++it)
+            next.emplace_back(base + it.row() * stride, value * it.value());
+        }
+        std::swap(current, next);
+        if (current.empty()) break;
+      }
+      column.insert(column.end(), current.begin(), current.end());
+    }
+
+    // sum duplicates and append the column
+    std::sort(column.begin(), column.end(),
+              [](const Entry_t& lhs, const Entry_t& rhs) {
+                return lhs.first < rhs.first;
+              });
+    res.startVec(static_cast<Index_t>(j));
+    for (std::size_t i = 0; i < column.size();) {
+      Scalar_t sum = 0;
+      const std::size_t row = column[i].first;
+      for (; i < column.size() && column[i].first == row; i++)
+        sum += column[i].second;
+      if (sum != Scalar_t(0))
+        res.insertBack(static_cast<Index_t>(row), static_cast<Index_t>(j)) =
+            sum;
+    }
+  }
+  res.finalize();
+
+  return res;
+}
+
+}  // namespace QPT
@@ -0,0 +1,256 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_DYNAMICS_TENSOROPERATOR_H_
+#define QPT_DYNAMICS_TENSOROPERATOR_H_
+
+#include <Eigen/SparseCore>
+#include <complex>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "LindbladSystem.h"
+
+namespace QPT {
+
+// Tensor product of subsystems with the given dimensions. The first
+// subsystem is the most significant one, i.e. the ordering matches
+// LindbladSystem::KroneckerProduct(A_0, KroneckerProduct(A_1, ...)).
+class TensorSpace {
+ public:
+  explicit TensorSpace(std::vector<std::size_t> dimensions);
+
+  std::size_t GetDimension() const { return m_dimension; }
+  std::size_t GetSubsystemCount() const { return m_dimensions.size(); }
+  std::size_t GetSubsystemDimension(std::size_t idx) const {
+    return m_dimensions[idx];
+  }
+  // distance of consecutive basis states of a subsystem in the full space
+  std::size_t GetStride(std::size_t idx) const { return m_strides[idx]; }
+
+ private:
+  std::vector<std::size_t> m_dimensions;
+  std::vector<std::size_t> m_strides;
+  std::size_t m_dimension;
+};
+
+// coefficient * (A_1 (x) A_2 (x) ...) with identities on all subsystems that
+// have no factor. Factors are sorted by subsystem and unique.
+struct TensorTerm {
+  using Factor_t =
+      std::pair<std::size_t, std::shared_ptr<const LindbladSystem::Operator_t>>;
+
+  LindbladSystem::Scalar_t coefficient = 1.0;
+  std::vector<Factor_t> factors;
+
+  // lhs * rhs (factors of the same subsystem are multiplied)
+  static TensorTerm Multiply(const TensorTerm& lhs, const TensorTerm& rhs);
+  TensorTerm Adjoint() const;
+};
+
+// Assembles the sparse matrix of a sum of terms column by column: the
+// non-zeros of a column are generated from the local columns of the factors,
+// merged and appended to storage that was reserved in advance. No dense or
+// Kronecker intermediate is formed, time and memory scale with the number
+// of non-zeros of the result. Fails if a factor does not match the space.
+std::optional<LindbladSystem::Operator_t> AssembleTensorTerms(
+    const TensorSpace& space, const std::vector<TensorTerm>& terms);
+
+// Lazy operator expressions on a TensorSpace (expression templates). The
+// expression types only record the structure; it is expanded into a sum of
+// TensorTerms and assembled on demand:
+//   auto H = g * (Embed(0, a) * Embed(1, sp)) + Adjoint(...) + ...;
+//   auto mat = H.Assemble(space);
+template <typename Derived>
+class TensorExpression {
+ public:
+  const Derived& derived() const { return static_cast<const Derived&>(*this); }
+
+  std::vector<TensorTerm> GetTerms() const {
+    std::vector<TensorTerm> terms;
+    derived().AppendTerms(terms);
+    return terms;
+  }
+  std::optional<LindbladSystem::Operator_t> Assemble(
+      const TensorSpace& space) const {
+    return AssembleTensorTerms(space, GetTerms());
+  }
+};
+
+// Local operator acting on a single subsystem
+class TensorLocal : public TensorExpression<TensorLocal> {
+ public:
+  TensorLocal(std::size_t subsystem, const LindbladSystem::Operator_t& op)
+      : m_subsystem(subsystem),
+        m_op(std::make_shared<const LindbladSystem::Operator_t>(op)) {}
+
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    TensorTerm term;
+    term.factors.emplace_back(m_subsystem, m_op);
+    terms.push_back(std::move(term));
+  }
+
+ private:
+  std::size_t m_subsystem;
+  std::shared_ptr<const LindbladSystem::Operator_t> m_op;
+};
+
+// Identity of the whole space
+class TensorIdentity : public TensorExpression<TensorIdentity> {
+ public:
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    terms.emplace_back();
+  }
+};
+
+template <typename Lhs, typename Rhs>
+class TensorSum : public TensorExpression<TensorSum<Lhs, Rhs>> {
+ public:
+  TensorSum(const Lhs& lhs, const Rhs& rhs) : m_lhs(lhs), m_rhs(rhs) {}
+
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    m_lhs.AppendTerms(terms);
+    m_rhs.AppendTerms(terms);
+  }
+
+ private:
+  Lhs m_lhs;
+  Rhs m_rhs;
+};
+
+template <typename Lhs, typename Rhs>
+class TensorProduct : public TensorExpression<TensorProduct<Lhs, Rhs>> {
+ public:
+  TensorProduct(const Lhs& lhs, const Rhs& rhs) : m_lhs(lhs), m_rhs(rhs) {}
+
+  // distributes the product over the sums
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    std::vector<TensorTerm> lhs, rhs;
+    m_lhs.AppendTerms(lhs);
+    m_rhs.AppendTerms(rhs);
+    for (const auto& l : lhs) {
+      for (const auto& r : rhs) terms.push_back(TensorTerm::Multiply(l, r));
+    }
+  }
+
+ private:
+  Lhs m_lhs;
+  Rhs m_rhs;
+};
+
+template <typename Expr>
+class TensorScaled : public TensorExpression<TensorScaled<Expr>> {
+ public:
+  TensorScaled(LindbladSystem::Scalar_t factor, const Expr& expr)
+      : m_factor(factor), m_expr(expr) {}
+
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    const std::size_t first = terms.size();
+    m_expr.AppendTerms(terms);
+    for (std::size_t i = first; i < terms.size(); i++)
+      terms[i].coefficient *= m_factor;
+  }
+
+ private:
+  LindbladSystem::Scalar_t m_factor;
+  Expr m_expr;
+};
+
+template <typename Expr>
+class TensorAdjoint : public TensorExpression<TensorAdjoint<Expr>> {
+ public:
+  explicit TensorAdjoint(const Expr& expr) : m_expr(expr) {}
+
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    const std::size_t first = terms.size();
+    m_expr.AppendTerms(terms);
+    for (std::size_t i = first; i < terms.size(); i++)
+      terms[i] = terms[i].Adjoint();
+  }
+
+ private:
+  Expr m_expr;
+};
+
+// Runtime sum of terms, e.g. for Hamiltonians built in loops
+class TensorOperator : public TensorExpression<TensorOperator> {
+ public:
+  TensorOperator() = default;
+  template <typename Derived>
+  TensorOperator(const TensorExpression<Derived>& expr) {
+    expr.derived().AppendTerms(m_terms);
+  }
+
+  template <typename Derived>
+  TensorOperator& operator+=(const TensorExpression<Derived>& expr) {
+    expr.derived().AppendTerms(m_terms);
+    return *this;
+  }
+  template <typename Derived>
+  TensorOperator& operator-=(const TensorExpression<Derived>& expr) {
+    const std::size_t first = m_terms.size();
+    expr.derived().AppendTerms(m_terms);
+    for (std::size_t i = first; i < m_terms.size(); i++)
+      m_terms[i].coefficient = -m_terms[i].coefficient;
+    return *this;
+  }
+
+  std::size_t GetTermCount() const { return m_terms.size(); }
+  void AppendTerms(std::vector<TensorTerm>& terms) const {
+    terms.insert(terms.end(), m_terms.begin(), m_terms.end());
+  }
+
+ private:
+  std::vector<TensorTerm> m_terms;
+};
+
+inline TensorLocal Embed(std::size_t subsystem,
+                         const LindbladSystem::Operator_t& op) {
+  return TensorLocal(subsystem, op);
+}
+
+template <typename Expr>
+TensorAdjoint<Expr> Adjoint(const TensorExpression<Expr>& expr) {
+  return TensorAdjoint<Expr>(expr.derived());
+}
+
+template <typename Lhs, typename Rhs>
+TensorSum<Lhs, Rhs> operator+(const TensorExpression<Lhs>& lhs,
+                              const TensorExpression<Rhs>& rhs) {
+  return TensorSum<Lhs, Rhs>(lhs.derived(), rhs.derived());
+}
+
+template <typename Lhs, typename Rhs>
+TensorSum<Lhs, TensorScaled<Rhs>> operator-(const TensorExpression<Lhs>& lhs,
+                                            const TensorExpression<Rhs>& rhs) {
+  return TensorSum<Lhs, TensorScaled<Rhs>>(
+      lhs.derived(), TensorScaled<Rhs>(-1.0, rhs.derived()));
+}
+
+template <typename Expr>
+TensorScaled<Expr> operator-(const TensorExpression<Expr>& expr) {
+  return TensorScaled<Expr>(-1.0, expr.derived());
+}
+
+template <typename Lhs, typename Rhs>
+TensorProduct<Lhs, Rhs> operator*(const TensorExpression<Lhs>& lhs,
+                                  const TensorExpression<Rhs>& rhs) {
+  return TensorProduct<Lhs, Rhs>(lhs.derived(), rhs.derived());
+}
+
+template <typename Expr>
+TensorScaled<Expr> operator*(LindbladSystem::Scalar_t factor,
+                             const TensorExpression<Expr>& expr) {
+  return TensorScaled<Expr>(factor, expr.derived());
+}
+
+template <typename Expr>
+TensorScaled<Expr> operator*(const TensorExpression<Expr>& expr,
+                             LindbladSystem::Scalar_t factor) {
+  return TensorScaled<Expr>(factor, expr.derived());
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_DYNAMICS_TENSOROPERATOR_H_
@@ -0,0 +1,232 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5BLOCKREADER_H_
+#define QPT_HDF5_H5BLOCKREADER_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "H5Dataset.h"
+
+namespace QPT {
+
+// Sequential scan over a dataset in blocks of whole rows (slices along the
+// first dimension). A background thread reads ahead into a fixed pool of
+// buffers which are reused for the whole scan; Next hands out views of the
+// buffers, so no data is copied. A buffer is returned to the reader when the
+// view is destroyed, i.e. at most bufferCount blocks (including the ones held
+// by the caller) are in memory and the reader stalls while the caller holds
+// all of them.
+// The block size defaults to the chunk rows of chunked datasets (all chunks
+// of a block are then read by a single contiguous access). The reader must
+// outlive its blocks. Other threads may only use HDF5 while the reader is
+// active if the library is thread-safe.
+template <typename T>
+class H5BlockReader {
+ public:
+  class Block {
+    friend class H5BlockReader;
+    Block(H5BlockReader* reader, std::size_t buffer, std::size_t rowOffset,
+          std::size_t rows)
+        : m_reader(reader),
+          m_buffer(buffer),
+          m_rowOffset(rowOffset),
+          m_rows(rows) {}
+
+   public:
+    ~Block() {
+      if (m_reader) m_reader->Release(m_buffer);
+    }
+    Block(const Block&) = delete;
+    Block(Block&& rhs)
+        : m_reader(std::exchange(rhs.m_reader, nullptr)),
+          m_buffer(rhs.m_buffer),
+          m_rowOffset(rhs.m_rowOffset),
+          m_rows(rhs.m_rows) {}
+    Block& operator=(const Block&) = delete;
+    Block& operator=(Block&& rhs) {
+      if (this != &rhs) {
+        if (m_reader) m_reader->Release(m_buffer);
+        m_reader = std::exchange(rhs.m_reader, nullptr);
+        m_buffer = rhs.m_buffer;
+        m_rowOffset = rhs.m_rowOffset;
+        m_rows = rhs.m_rows;
+      }
+      return *this;
+    }
+
+    // rows x GetRowSize() values in row-major order
+    const T* GetData() const { return m_reader->m_buffers[m_buffer].data(); }
+    std::size_t GetRowOffset() const { return m_rowOffset; }
+    std::size_t GetRowCount() const { return m_rows; }
+    std::size_t GetSize() const { return m_rows * m_reader->m_rowSize; }
+
+   private:
+    H5BlockReader* m_reader;
+    std::size_t m_buffer;
+    std::size_t m_rowOffset;
+    std::size_t m_rows;
+  };
+
+  // blockRows == 0 selects the chunk rows (or 1024 rows if the dataset is
+  // not chunked); bufferCount is at least 2
+  explicit H5BlockReader(H5Dataset dataset, std::size_t blockRows = 0,
+                         std::size_t bufferCount = 4);
+  ~H5BlockReader();
+
+  H5BlockReader(const H5BlockReader&) = delete;
+  H5BlockReader(H5BlockReader&&) = delete;
+  H5BlockReader& operator=(const H5BlockReader&) = delete;
+  H5BlockReader& operator=(H5BlockReader&&) = delete;
+
+  // Next block in the order of the rows (waits for the reader). Returns
+  // std::nullopt after the last block or if a read failed.
+  std::optional<Block> Next();
+  bool HasFailed() const;
+
+  const std::vector<std::size_t>& GetShape() const { return m_shape; }
+  std::size_t GetRowSize() const { return m_rowSize; }
+  std::size_t GetBlockRows() const { return m_blockRows; }
+
+ private:
+  struct Pending {
+    std::size_t buffer;
+    std::size_t rowOffset;
+    std::size_t rows;
+  };
+
+  void ReaderMain();
+  void Release(std::size_t buffer);
+
+ private:
+  H5Dataset m_dataset;
+  std::vector<std::size_t> m_shape;
+  std::size_t m_rowSize = 0;
+  std::size_t m_blockRows = 1;
+  std::vector<std::vector<T>> m_buffers;
+
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::size_t> m_free;
+  std::deque<Pending> m_ready;
+  bool m_finished = false;
+  bool m_failed = false;
+  bool m_stop = false;
+  std::thread m_thread;
+};
+
+// Template function definitions
+template <typename T>
+H5BlockReader<T>::H5BlockReader(H5Dataset dataset, std::size_t blockRows,
+                                std::size_t bufferCount)
+    : m_dataset(std::move(dataset)), m_shape(m_dataset.GetShape()) {
+  if (m_shape.empty()) {
+    m_failed = m_finished = true;
+    return;
+  }
+
+  m_rowSize = 1;
+  for (std::size_t i = 1; i < m_shape.size(); i++) m_rowSize *= m_shape[i];
+  if (m_shape[0] == 0 || m_rowSize == 0) {
+    m_finished = true;
+    return;
+  }
+  if (blockRows == 0) {
+    const auto chunk = m_dataset.GetChunkShape();
+    blockRows = chunk.empty() ? 1024 : chunk[0];
+  }
+  m_blockRows = std::max<std::size_t>(std::min(blockRows, m_shape[0]), 1);
+
+  m_buffers.resize(std::max<std::size_t>(bufferCount, 2));
+  for (std::size_t i = m_buffers.size(); i > 0; i--) {
+    m_buffers[i - 1].resize(m_blockRows * m_rowSize);
+    m_free.push_back(i - 1);
+  }
+  m_thread = std::thread([this]() { ReaderMain(); });
+}
+
+template <typename T>
+H5BlockReader<T>::~H5BlockReader() {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+}
+
+template <typename T>
+void H5BlockReader<T>::ReaderMain() {
+  std::vector<std::size_t> offset(m_shape.size(), 0);
+  std::vector<std::size_t> count = m_shape;
+  for (std::size_t row = 0; row < m_shape[0]; row += m_blockRows) {
+    std::size_t buffer;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this]() { return m_stop || !m_free.empty(); });
+      if (m_stop) return;
+      buffer = m_free.back();
+      m_free.pop_back();
+    }
+
+    // the buffer is owned by this thread until it is published
+    offset[0] = row;
+    count[0] = std::min(m_blockRows, m_shape[0] - row);
+    const bool success =
+        m_dataset.GetSlabData(offset, count, m_buffers[buffer].data());
+
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if (success) {
+        m_ready.push_back({buffer, row, count[0]});
+      } else {
+        m_failed = true;
+        m_free.push_back(buffer);
+      }
+    }
+    m_cv.notify_all();
+    if (!success) break;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished = true;
+  }
+  m_cv.notify_all();
+}
+
+template <typename T>
+void H5BlockReader<T>::Release(std::size_t buffer) {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_free.push_back(buffer);
+  }
+  m_cv.notify_all();
+}
+
+template <typename T>
+std::optional<typename H5BlockReader<T>::Block> H5BlockReader<T>::Next() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait(lock, [this]() { return !m_ready.empty() || m_finished; });
+  // blocks read before a failure are dropped
+  if (m_ready.empty() || m_failed) return std::nullopt;
+  const Pending pending = m_ready.front();
+  m_ready.pop_front();
+  return Block(this, pending.buffer, pending.rowOffset, pending.rows);
+}
+
+template <typename T>
+bool H5BlockReader<T>::HasFailed() const {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  return m_failed;
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5BLOCKREADER_H_
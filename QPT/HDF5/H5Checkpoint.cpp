@@ -0,0 +1,350 @@
+// Philipp Neufeld, 2023
+
+#include "H5Checkpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_set>
+
+namespace QPT {
+
+// Helpers
+// rows (slot, hash[0], hash[1], size) of the chunks of an entry
+using ChunkRow_t = std::array<std::uint64_t, 4>;
+
+std::optional<std::vector<ChunkRow_t>> ReadChunkRows(H5Dataset& ds) {
+  const auto shape = ds.GetShape();
+  if (shape.size() != 2 || shape[1] != 4) return std::nullopt;
+  std::vector<ChunkRow_t> rows(shape[0]);
+  if (!rows.empty() &&
+      !ds.GetSlabData({0, 0}, {rows.size(), 4}, rows.data()->data()))
+    return std::nullopt;
+  return rows;
+}
+
+// splitmix64 finalizer
+std::uint64_t MixHash(std::uint64_t hash) {
+  hash ^= hash >> 30;
+  hash *= 0xBF58476D1CE4E5B9ull;
+  hash ^= hash >> 27;
+  hash *= 0x94D049BB133111EBull;
+  hash ^= hash >> 31;
+  return hash;
+}
+
+std::optional<H5CheckpointManager> H5CheckpointManager::Open(
+    const std::string& filename, std::size_t generations,
+    std::size_t chunkSize) {
+  if (generations == 0 || chunkSize == 0) return std::nullopt;
+  auto file = H5File::Open(filename, H5File_DEFAULT);
+  if (!file) return std::nullopt;
+  H5CheckpointManager manager(std::move(*file), generations, chunkSize);
+  if (!manager.LoadChunkTable()) return std::nullopt;
+  return std::make_optional(std::move(manager));
+}
+
+H5CheckpointManager::H5CheckpointManager(H5File file, std::size_t generations,
+                                         std::size_t chunkSize)
+    : m_file(std::move(file)),
+      m_generations(generations),
+      m_chunkSize(chunkSize) {}
+
+std::uint64_t H5CheckpointManager::HashChunk(const std::uint8_t* data,
+                                             std::size_t size) {
+  // word-wise multiply-rotate hash with a splitmix64 finalizer
+  constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+  constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+  auto rotl = [](std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+  std::uint64_t hash = prime2 ^ (size * prime1);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    hash ^= rotl(word * prime2, 31) * prime1;
+    hash = rotl(hash, 27) * prime1 + prime2;
+  }
+  for (; i < size; i++) {
+    hash ^= data[i] * prime1;
+    hash = rotl(hash, 11) * prime2;
+  }
+  return MixHash(hash);
+}
+
+H5CheckpointManager::Hash_t H5CheckpointManager::HashChunk128(
+    const std::uint8_t* data, std::size_t size) {
+  // two lanes of the hash of HashChunk with different seeds and rotations
+  constexpr std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+  constexpr std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+  constexpr std::uint64_t prime3 = 0x165667B19E3779F9ull;
+  auto rotl = [](std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+  std::uint64_t hash1 = prime2 ^ (size * prime1);
+  std::uint64_t hash2 = prime3 ^ (size * prime2);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, data + i, 8);
+    hash1 ^= rotl(word * prime2, 31) * prime1;
+    hash1 = rotl(hash1, 27) * prime1 + prime2;
+    hash2 ^= rotl(word * prime3, 29) * prime2;
+    hash2 = rotl(hash2, 23) * prime2 + prime3;
+  }
+  for (; i < size; i++) {
+    hash1 ^= data[i] * prime1;
+    hash1 = rotl(hash1, 11) * prime2;
+    hash2 ^= data[i] * prime2;
+    hash2 = rotl(hash2, 13) * prime3;
+  }
+
+  // both halves depend on both lanes
+  hash1 += hash2;
+  hash2 += hash1;
+  return {MixHash(hash1), MixHash(hash2)};
+}
+
+std::string H5CheckpointManager::GetGenerationName(std::uint64_t generation) {
+  // zero padded such that the name order equals the generation order
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%020llu",
+                static_cast<unsigned long long>(generation));
+  return buffer;
+}
+
+std::vector<std::uint64_t> H5CheckpointManager::GetGenerations() {
+  std::vector<std::uint64_t> generations;
+  if (!m_file.HasSubgroup("generations")) return generations;
+  auto gens = m_file.OpenSubgroup("generations");
+  if (!gens) return generations;
+
+  gens->EnumerateSubgroups([&](const std::string& name) {
+    auto gen = gens->OpenSubgroup(name);
+    if (gen && gen->GetAttribute<std::uint8_t>("complete") == 1)
+      generations.push_back(std::stoull(name));
+  });
+  std::sort(generations.begin(), generations.end());
+  return generations;
+}
+
+std::optional<H5Dataset> H5CheckpointManager::OpenChunkData() {
+  auto chunks = m_file.OpenSubgroup("chunks");
+  if (!chunks) return std::nullopt;
+  if (chunks->HasDataset("data")) return chunks->OpenExistingDataset("data");
+  // a HDF5 chunk per slot: rewriting a slot touches no other slot
+  return chunks->CreateAppendableDataset<std::uint8_t>("data", {m_chunkSize},
+                                                       1);
+}
+
+bool H5CheckpointManager::LoadChunkTable() {
+  m_chunks.clear();
+  m_freeSlots.clear();
+  auto data = OpenChunkData();
+  if (!data) return false;
+  const auto shape = data->GetShape();
+  if (shape.size() != 2 || shape[1] == 0) return false;
+  m_chunkSize = shape[1];
+
+  // slots of all complete generations are in use
+  std::vector<bool> used(shape[0], false);
+  if (m_file.HasSubgroup("generations")) {
+    auto gens = m_file.OpenSubgroup("generations");
+    if (!gens) return false;
+    bool success = true;
+    for (auto generation : GetGenerations()) {
+      auto gen = gens->OpenSubgroup(GetGenerationName(generation));
+      if (!gen) return false;
+      gen->EnumerateDatasets([&](const std::string& name) {
+        auto ds = gen->OpenExistingDataset(name);
+        auto rows = ds ? ReadChunkRows(*ds) : std::nullopt;
+        if (!rows) {
+          success = false;
+          return;
+        }
+        for (const auto& row : *rows) {
+          if (row[0] >= used.size()) {
+            success = false;
+            return;
+          }
+          used[row[0]] = true;
+          m_chunks[{row[1], row[2]}] = {row[0], row[3]};
+        }
+      });
+    }
+    // never reuse slots that might still be in use
+    if (!success) return false;
+  }
+
+  // lowest slots first
+  for (std::size_t slot = used.size(); slot-- > 0;) {
+    if (!used[slot]) m_freeSlots.push_back(slot);
+  }
+  return true;
+}
+
+bool H5CheckpointManager::WriteEntry(H5Group& gen, H5Dataset& data,
+                                     const Entry& entry) {
+  std::vector<std::uint8_t> bytes;
+  std::vector<std::size_t> shape;
+  entry.save(bytes, shape);
+
+  std::vector<ChunkRow_t> rows;
+  for (std::size_t pos = 0; pos < bytes.size(); pos += m_chunkSize) {
+    const std::size_t size = std::min(m_chunkSize, bytes.size() - pos);
+    const auto hash = HashChunk128(bytes.data() + pos, size);
+
+    // unchanged chunks are found in memory without reading them back
+    auto it = m_chunks.find(hash);
+    if (it != m_chunks.end() && it->second.size == size) {
+      rows.push_back({it->second.slot, hash[0], hash[1], size});
+      m_lastReused++;
+      continue;
+    }
+
+    // reuse a slot that no retained generation references or add one
+    std::uint64_t slot;
+    if (!m_freeSlots.empty()) {
+      slot = m_freeSlots.back();
+      m_freeSlots.pop_back();
+    } else {
+      const auto dataShape = data.GetShape();
+      if (dataShape.size() != 2) return false;
+      slot = dataShape[0];
+      if (!data.SetRowCount(slot + 1)) return false;
+    }
+    if (!data.SetSlabData({slot, 0}, {1, size}, bytes.data() + pos, false))
+      return false;
+    m_chunks[hash] = {slot, size};
+    rows.push_back({slot, hash[0], hash[1], size});
+    m_lastWritten++;
+  }
+
+  auto ds = gen.CreateUninitializedDataset<std::uint64_t>(entry.name,
+                                                           {rows.size(), 4});
+  if (!ds) return false;
+  if (!rows.empty() && !ds->SetSlabData({0, 0}, {rows.size(), 4},
+                                        rows.data()->data(), false))
+    return false;
+  // HDF5 does not allow empty attributes: the shape is omitted for scalars
+  std::vector<std::uint64_t> shape64(shape.begin(), shape.end());
+  if (!shape.empty() && !ds->SetAttribute("shape", shape64)) return false;
+  return ds->SetAttribute("rank", std::uint64_t(shape.size())) &&
+         ds->SetAttribute("bytes", std::uint64_t(bytes.size()));
+}
+
+std::optional<std::function<void()>> H5CheckpointManager::LoadEntry(
+    H5Group& gen, H5Dataset& data, const Entry& entry) {
+  auto ds = gen.OpenExistingDataset(entry.name);
+  if (!ds) return std::nullopt;
+  auto rows = ReadChunkRows(*ds);
+  auto rank = ds->GetAttribute<std::uint64_t>("rank");
+  auto size = ds->GetAttribute<std::uint64_t>("bytes");
+  if (!rows || !rank || !size) return std::nullopt;
+  auto shape64 = std::make_optional<std::vector<std::uint64_t>>();
+  if (*rank != 0)
+    shape64 = ds->GetAttribute<std::vector<std::uint64_t>>("shape");
+  if (!shape64 || shape64->size() != *rank) return std::nullopt;
+
+  // reassemble the serialized object from its chunks
+  const auto dataShape = data.GetShape();
+  if (dataShape.size() != 2) return std::nullopt;
+  std::vector<std::uint8_t> bytes(*size);
+  std::size_t pos = 0;
+  for (const auto& row : *rows) {
+    const std::size_t chunkSize = row[3];
+    if (row[0] >= dataShape[0] || chunkSize > dataShape[1] ||
+        pos + chunkSize > bytes.size())
+      return std::nullopt;
+    if (chunkSize != 0 &&
+        !data.GetSlabData({row[0], 0}, {1, chunkSize}, bytes.data() + pos))
+      return std::nullopt;
+    if (HashChunk128(bytes.data() + pos, chunkSize) != Hash_t{row[1], row[2]})
+      return std::nullopt;
+    pos += chunkSize;
+  }
+  if (pos != bytes.size()) return std::nullopt;
+
+  std::vector<std::size_t> shape(shape64->begin(), shape64->end());
+  auto commit = entry.load(bytes, shape);
+  if (!commit) return std::nullopt;
+  return commit;
+}
+
+std::optional<std::uint64_t> H5CheckpointManager::Write() {
+  m_lastWritten = 0;
+  m_lastReused = 0;
+
+  const auto existing = GetGenerations();
+  const std::uint64_t generation = existing.empty() ? 0 : existing.back() + 1;
+
+  auto gens = m_file.OpenSubgroup("generations");
+  auto data = OpenChunkData();
+  if (!gens || !data) return std::nullopt;
+
+  // remove leftovers of an interrupted checkpoint with the same number
+  const auto name = GetGenerationName(generation);
+  gens->Remove(name);
+  auto gen = gens->OpenSubgroup(name);
+  if (!gen) return std::nullopt;
+
+  for (const auto& entry : m_entries) {
+    if (!WriteEntry(*gen, *data, entry)) return std::nullopt;
+  }
+  // all chunks are on disk before the generation is marked as complete
+  if (!m_file.Flush() || !gen->SetAttribute("complete", std::uint8_t(1)) ||
+      !m_file.Flush())
+    return std::nullopt;
+
+  CollectGarbage();
+  return generation;
+}
+
+bool H5CheckpointManager::Restore() {
+  const auto generations = GetGenerations();
+  if (generations.empty()) return false;
+  return Restore(generations.back());
+}
+
+bool H5CheckpointManager::Restore(std::uint64_t generation) {
+  if (!m_file.HasSubgroup("generations")) return false;
+  auto gens = m_file.OpenSubgroup("generations");
+  auto data = OpenChunkData();
+  if (!gens || !data) return false;
+
+  const auto name = GetGenerationName(generation);
+  if (!gens->HasSubgroup(name)) return false;
+  auto gen = gens->OpenSubgroup(name);
+  if (!gen || gen->GetAttribute<std::uint8_t>("complete") != 1) return false;
+
+  // stage everything first, then commit: all objects or none are modified
+  std::vector<std::function<void()>> commits;
+  for (const auto& entry : m_entries) {
+    auto commit = LoadEntry(*gen, *data, entry);
+    if (!commit) return false;
+    commits.push_back(std::move(*commit));
+  }
+  for (auto& commit : commits) commit();
+  return true;
+}
+
+void H5CheckpointManager::CollectGarbage() {
+  auto gens = m_file.OpenSubgroup("generations");
+  if (!gens) return;
+
+  // drop incomplete and surplus generations
+  const auto complete = GetGenerations();
+  const std::size_t drop =
+      complete.size() > m_generations ? complete.size() - m_generations : 0;
+  std::unordered_set<std::uint64_t> keep(complete.begin() + drop,
+                                         complete.end());
+  std::vector<std::string> obsolete;
+  gens->EnumerateSubgroups([&](const std::string& name) {
+    if (keep.count(std::stoull(name)) == 0) obsolete.push_back(name);
+  });
+  for (const auto& name : obsolete) gens->Remove(name);
+
+  // the slots of the dropped generations are reused by later checkpoints
+  // (none if the table cannot be rebuilt)
+  if (!LoadChunkTable()) m_freeSlots.clear();
+}
+
+}  // namespace QPT
@@ -0,0 +1,150 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5CHECKPOINT_H_
+#define QPT_HDF5_H5CHECKPOINT_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../Serialization.h"
+#include "H5File.h"
+
+namespace QPT {
+
+// Incremental checkpoint/restart on top of a HDF5 file.
+// The serialized state of every registered object is cut into fixed-size
+// chunks which are stored in the slots (rows) of the dataset "/chunks/data".
+// A checkpoint generation only stores the rows (slot, 128 bit hash, size) of
+// the chunks of every object. A chunk whose hash matches a chunk of a
+// retained generation (kept in memory) is reused without any I/O, hence the
+// cost of a checkpoint scales with the changed state. Slots that are no
+// longer referenced by a retained generation are reused by later checkpoints
+// (also after reopening the file), so the file does not grow beyond the
+// chunks of the retained generations plus one.
+// Generations are marked as complete after all their data has been written,
+// so a checkpoint that was interrupted is never restored. Restored chunks
+// are verified against their hash.
+// Note: Serialized data is stored as raw bytes in the native byte order.
+class H5CheckpointManager {
+ public:
+  // chunkSize only applies to new files (a file keeps its slot size)
+  static std::optional<H5CheckpointManager> Open(
+      const std::string& filename, std::size_t generations,
+      std::size_t chunkSize = 1 << 16);
+
+ protected:
+  H5CheckpointManager(H5File file, std::size_t generations,
+                      std::size_t chunkSize);
+
+ public:
+  // Registers an object that is saved by Write() and restored by Restore().
+  // The object must outlive the checkpoint manager.
+  template <typename T, typename = std::enable_if_t<
+                            std::is_default_constructible_v<T> &&
+                            std::is_move_assignable_v<T>>>
+  void Register(const std::string& name, T& obj);
+
+  // Writes a new checkpoint generation and drops generations exceeding the
+  // configured number of generations. Returns the generation number.
+  std::optional<std::uint64_t> Write();
+
+  // Restores all registered objects from the latest (or a given) complete
+  // generation. Either all objects are restored or none is touched.
+  bool Restore();
+  bool Restore(std::uint64_t generation);
+
+  std::vector<std::uint64_t> GetGenerations();
+
+  // Statistics of the last Write() call
+  std::size_t GetLastWrittenChunkCount() const { return m_lastWritten; }
+  std::size_t GetLastReusedChunkCount() const { return m_lastReused; }
+
+  using Hash_t = std::array<std::uint64_t, 2>;
+  static std::uint64_t HashChunk(const std::uint8_t* data, std::size_t size);
+  static Hash_t HashChunk128(const std::uint8_t* data, std::size_t size);
+
+ private:
+  struct Entry {
+    std::string name;
+    // returns the raw bytes of the serialized object and its shape
+    std::function<void(std::vector<std::uint8_t>&, std::vector<std::size_t>&)>
+        save;
+    // deserializes into a staging object and returns a function that
+    // commits the staged value into the registered object
+    std::function<std::function<void()>(const std::vector<std::uint8_t>&,
+                                        const std::vector<std::size_t>&)>
+        load;
+  };
+
+  struct Chunk {
+    std::uint64_t slot;
+    std::uint64_t size;
+  };
+  struct HashHasher {
+    std::size_t operator()(const Hash_t& hash) const { return hash[0]; }
+  };
+
+  bool WriteEntry(H5Group& gen, H5Dataset& data, const Entry& entry);
+  std::optional<std::function<void()>> LoadEntry(H5Group& gen,
+                                                 H5Dataset& data,
+                                                 const Entry& entry);
+  std::optional<H5Dataset> OpenChunkData();
+  // rebuilds the chunk table and the free slots from the retained
+  // generations
+  bool LoadChunkTable();
+  void CollectGarbage();
+
+  static std::string GetGenerationName(std::uint64_t generation);
+
+ private:
+  H5File m_file;
+  std::size_t m_generations;
+  std::size_t m_chunkSize;
+  std::vector<Entry> m_entries;
+
+  std::unordered_map<Hash_t, Chunk, HashHasher> m_chunks;
+  std::vector<std::uint64_t> m_freeSlots;
+
+  std::size_t m_lastWritten = 0;
+  std::size_t m_lastReused = 0;
+};
+
+// Template function definitions
+template <typename T, typename>
+inline void H5CheckpointManager::Register(const std::string& name, T& obj) {
+  using Storage_t = typename SerializationTraits<T>::Storage_t;
+
+  Entry entry;
+  entry.name = name;
+  entry.save = [&obj](std::vector<std::uint8_t>& bytes,
+                      std::vector<std::size_t>& shape) {
+    auto ser = Serialize(obj);
+    const auto data = reinterpret_cast<const std::uint8_t*>(ser.GetData());
+    bytes.assign(data, data + ser.GetSize() * sizeof(Storage_t));
+    shape = SerializationTraits<T>::GetShape(obj);
+  };
+  entry.load = [&obj](const std::vector<std::uint8_t>& bytes,
+                      const std::vector<std::size_t>& shape)
+      -> std::function<void()> {
+    if (shape.size() != SerializationTraits<T>::GetRank()) return nullptr;
+    auto staged = std::make_shared<T>();
+    Deserializer<T> des(*staged, shape);
+    if (des.GetSize() * sizeof(Storage_t) != bytes.size()) return nullptr;
+    if (!bytes.empty()) std::memcpy(des.GetData(), bytes.data(), bytes.size());
+    des.Execute();
+    return [&obj, staged]() { obj = std::move(*staged); };
+  };
+  m_entries.push_back(std::move(entry));
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5CHECKPOINT_H_
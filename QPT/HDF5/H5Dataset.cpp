@@ -4,11 +4,46 @@
 
 #include <hdf5.h>
 
+#include <algorithm>
+
+#include "../Profiling/Profiler.h"
 #include "../ScopeGuard.h"
 #include "H5Group.h"
 
 namespace QPT {
 
+// Helpers
+// Returns the file dataspace of the dataset with the given hyperslab selected
+// (or H5I_INVALID_HID if the selection is out of bounds)
+hid_t SelectSlab(hid_t dataset, const std::vector<std::size_t>& offset,
+                 const std::vector<std::size_t>& count) {
+  if (offset.size() != count.size()) return H5I_INVALID_HID;
+
+  hid_t fspace = H5Dget_space(dataset);
+  if (fspace < 0) return H5I_INVALID_HID;
+  auto fspaceGuard = CreateScopeGuard([=]() { H5Sclose(fspace); });
+
+  const int ndims = H5Sget_simple_extent_ndims(fspace);
+  if (ndims < 0 || static_cast<std::size_t>(ndims) != offset.size())
+    return H5I_INVALID_HID;
+
+  std::vector<hsize_t> dims(ndims);
+  if (H5Sget_simple_extent_dims(fspace, dims.data(), nullptr) < 0)
+    return H5I_INVALID_HID;
+  for (std::size_t i = 0; i < dims.size(); i++) {
+    if (offset[i] + count[i] > dims[i]) return H5I_INVALID_HID;
+  }
+
+  std::vector<hsize_t> start(offset.begin(), offset.end());
+  std::vector<hsize_t> cnt(count.begin(), count.end());
+  if (H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start.data(), nullptr,
+                          cnt.data(), nullptr) < 0)
+    return H5I_INVALID_HID;
+
+  fspaceGuard.Dismiss();
+  return fspace;
+}
+
 std::optional<H5Dataset> H5Dataset::Create(
     hid_t grp, hid_t sType, const std::string& name,
     const std::vector<std::size_t>& shape) {
@@ -28,6 +63,47 @@ std::optional<H5Dataset> H5Dataset::Create(
   return (dataset >= 0) ? std::make_optional(H5Dataset(dataset)) : std::nullopt;
 }
 
+std::optional<H5Dataset> H5Dataset::CreateAppendable(
+    hid_t grp, hid_t sType, const std::string& name,
+    const std::vector<std::size_t>& rowShape, std::size_t chunkRows) {
+  if (H5Lexists(grp, name.c_str(), H5P_DEFAULT) != 0) return std::nullopt;
+
+  // first dimension is unlimited (starts empty), requires chunked layout
+  std::vector<hsize_t> dims = {0};
+  std::vector<hsize_t> maxDims = {H5S_UNLIMITED};
+  std::vector<hsize_t> chunk = {0};
+  std::size_t rowBytes = H5Tget_size(sType);
+  if (rowBytes == 0) return std::nullopt;
+  for (auto n : rowShape) {
+    dims.push_back(n);
+    maxDims.push_back(n);
+    chunk.push_back(std::max<hsize_t>(n, 1));
+    rowBytes *= std::max<std::size_t>(n, 1);
+  }
+  // HDF5 limits chunks to 4 GB, large chunks also waste space in short files
+  constexpr std::size_t maxChunkBytes = 1 << 20;
+  const std::size_t maxRows =
+      std::max<std::size_t>(maxChunkBytes / rowBytes, 1);
+  chunk[0] = std::clamp<std::size_t>(chunkRows, 1, maxRows);
+
+  hid_t dspace = H5Screate_simple(dims.size(), dims.data(), maxDims.data());
+  if (dspace < 0) return std::nullopt;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+  if (dcpl < 0) return std::nullopt;
+  auto dcplGuard = CreateScopeGuard([=]() { H5Pclose(dcpl); });
+  if (H5Pset_chunk(dcpl, chunk.size(), chunk.data()) < 0) return std::nullopt;
+
+  hid_t dataset = H5I_INVALID_HID;
+  H5E_BEGIN_TRY
+  dataset = H5Dcreate2(grp, name.c_str(), sType, dspace, H5P_DEFAULT, dcpl,
+                       H5P_DEFAULT);
+  H5E_END_TRY
+
+  return (dataset >= 0) ? std::make_optional(H5Dataset(dataset)) : std::nullopt;
+}
+
 H5Dataset::H5Dataset(hid_t hid) : H5Object(hid) {}
 
 std::vector<std::size_t> H5Dataset::GetShape() {
@@ -45,17 +121,233 @@ std::vector<std::size_t> H5Dataset::GetShape() {
   return std::vector<std::size_t>(dims.begin(), dims.end());
 }
 
+std::size_t H5Dataset::GetStorageSize() {
+  return H5Dget_storage_size(GetHandle());
+}
+
+std::vector<std::size_t> H5Dataset::GetChunkShape() {
+  hid_t dcpl = H5Dget_create_plist(GetHandle());
+  if (dcpl < 0) return std::vector<std::size_t>{};
+  auto dcplGuard = CreateScopeGuard([=]() { H5Pclose(dcpl); });
+  if (H5Pget_layout(dcpl) != H5D_CHUNKED) return std::vector<std::size_t>{};
+
+  const int ndims = H5Pget_chunk(dcpl, 0, nullptr);
+  if (ndims <= 0) return std::vector<std::size_t>{};
+  std::vector<hsize_t> dims(ndims);
+  if (H5Pget_chunk(dcpl, ndims, dims.data()) < 0)
+    return std::vector<std::size_t>{};
+
+  return std::vector<std::size_t>(dims.begin(), dims.end());
+}
+
+bool H5Dataset::HasCompatibleChunks(H5Dataset& other) {
+  const auto chunk = GetChunkShape();
+  if (chunk.empty() || chunk != other.GetChunkShape()) return false;
+
+  hid_t type = H5Dget_type(GetHandle());
+  if (type < 0) return false;
+  auto typeGuard = CreateScopeGuard([=]() { H5Tclose(type); });
+  hid_t otherType = H5Dget_type(other.GetHandle());
+  if (otherType < 0) return false;
+  auto otherTypeGuard = CreateScopeGuard([=]() { H5Tclose(otherType); });
+  if (H5Tequal(type, otherType) <= 0) return false;
+  // variable length data and references point into the source file
+  if (H5Tdetect_class(type, H5T_VLEN) > 0 || H5Tis_variable_str(type) > 0 ||
+      H5Tdetect_class(type, H5T_REFERENCE) > 0)
+    return false;
+
+  hid_t dcpl = H5Dget_create_plist(GetHandle());
+  if (dcpl < 0) return false;
+  auto dcplGuard = CreateScopeGuard([=]() { H5Pclose(dcpl); });
+  hid_t otherDcpl = H5Dget_create_plist(other.GetHandle());
+  if (otherDcpl < 0) return false;
+  auto otherDcplGuard = CreateScopeGuard([=]() { H5Pclose(otherDcpl); });
+
+  // id, flags and parameters of every filter
+  auto getFilter = [](hid_t plist, int index) {
+    unsigned flags = 0;
+    std::size_t count = 16;
+    std::vector<unsigned> values(count);
+    const H5Z_filter_t id = H5Pget_filter2(plist, index, &flags, &count,
+                                           values.data(), 0, nullptr, nullptr);
+    values.resize(std::min<std::size_t>(count, values.size()));
+    values.insert(values.begin(), {unsigned(id), flags, unsigned(count)});
+    return (id >= 0) ? values : std::vector<unsigned>{};
+  };
+  const int filters = H5Pget_nfilters(dcpl);
+  if (filters < 0 || filters != H5Pget_nfilters(otherDcpl)) return false;
+  for (int i = 0; i < filters; i++) {
+    const auto filter = getFilter(dcpl, i);
+    if (filter.empty() || filter != getFilter(otherDcpl, i)) return false;
+  }
+  return true;
+}
+
+std::optional<H5StringTable> H5Dataset::GetStrings() {
+  hid_t type = H5Dget_type(GetHandle());
+  if (type < 0) return std::nullopt;
+  auto typeGuard = CreateScopeGuard([=]() { H5Tclose(type); });
+  hid_t dspace = H5Dget_space(GetHandle());
+  if (dspace < 0) return std::nullopt;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  const hssize_t count = H5Sget_simple_extent_npoints(dspace);
+  if (count < 0) return std::nullopt;
+  return H5StringTable::ReadH5(type, count, [&](hid_t mtype, void* data) {
+    return count == 0 || GetRaw(mtype, data);
+  });
+}
+
+bool H5Dataset::ReadRawChunk(const std::vector<std::size_t>& offset,
+                             std::uint32_t& filterMask,
+                             std::vector<std::uint8_t>& data) {
+  QPT_PROFILE_SCOPE("H5Dataset::ReadRawChunk");
+  std::vector<hsize_t> off(offset.begin(), offset.end());
+  unsigned mask = 0;
+  haddr_t address = HADDR_UNDEF;
+  hsize_t size = 0;
+  if (H5Dget_chunk_info_by_coord(GetHandle(), off.data(), &mask, &address,
+                                 &size) < 0)
+    return false;
+  if (address == HADDR_UNDEF) {
+    data.clear();
+    return true;
+  }
+
+  std::uint32_t filters = 0;
+  data.resize(size);
+  if (H5Dread_chunk(GetHandle(), H5P_DEFAULT, off.data(), &filters,
+                    data.data()) < 0)
+    return false;
+  filterMask = filters;
+  return true;
+}
+
+bool H5Dataset::WriteRawChunk(const std::vector<std::size_t>& offset,
+                              std::uint32_t filterMask,
+                              const std::vector<std::uint8_t>& data) {
+  QPT_PROFILE_SCOPE("H5Dataset::WriteRawChunk");
+  std::vector<hsize_t> off(offset.begin(), offset.end());
+  return H5Dwrite_chunk(GetHandle(), H5P_DEFAULT, filterMask, off.data(),
+                        data.size(), data.data()) >= 0;
+}
+
+bool H5Dataset::CopySlab(const std::vector<std::size_t>& offset,
+                         const std::vector<std::size_t>& count,
+                         H5Dataset& dest,
+                         const std::vector<std::size_t>& destOffset,
+                         std::size_t maxBytes) {
+  if (offset.size() != count.size() || count.size() != destOffset.size())
+    return false;
+  if (count.empty()) return true;
+
+  hid_t destType = H5Dget_type(dest.GetHandle());
+  if (destType < 0) return false;
+  auto destTypeGuard = CreateScopeGuard([=]() { H5Tclose(destType); });
+  hid_t nType = H5Tget_native_type(destType, H5T_DIR_DEFAULT);
+  if (nType < 0) return false;
+  auto nTypeGuard = CreateScopeGuard([=]() { H5Tclose(nType); });
+  const bool vlen =
+      H5Tdetect_class(nType, H5T_VLEN) > 0 || H5Tis_variable_str(nType) > 0;
+
+  // pieces of whole rows along the first dimension
+  std::size_t rowBytes = H5Tget_size(nType);
+  for (std::size_t i = 1; i < count.size(); i++) rowBytes *= count[i];
+  if (rowBytes == 0) return true;
+  const std::size_t pieceRows = std::max<std::size_t>(maxBytes / rowBytes, 1);
+
+  std::vector<std::uint8_t> buffer;
+  auto srcOff = offset, destOff = destOffset, cnt = count;
+  for (std::size_t row = 0; row < count[0]; row += pieceRows) {
+    cnt[0] = std::min(pieceRows, count[0] - row);
+    srcOff[0] = offset[0] + row;
+    destOff[0] = destOffset[0] + row;
+    buffer.resize(cnt[0] * rowBytes);
+    if (!GetRawSlab(nType, srcOff, cnt, buffer.data())) return false;
+    bool success = dest.SetRawSlab(nType, destOff, cnt, buffer.data());
+    if (vlen) {
+      std::vector<hsize_t> dims(cnt.begin(), cnt.end());
+      hid_t mspace = H5Screate_simple(dims.size(), dims.data(), nullptr);
+      if (mspace < 0) return false;
+      auto mspaceGuard = CreateScopeGuard([=]() { H5Sclose(mspace); });
+      H5Dvlen_reclaim(nType, mspace, H5P_DEFAULT, buffer.data());
+    }
+    if (!success) return false;
+  }
+  return true;
+}
+
 bool H5Dataset::GetRaw(hid_t nType, void* data) {
+  QPT_PROFILE_SCOPE("H5Dataset::Read");
   if (H5Dread(GetHandle(), nType, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) < 0)
     return false;
   return true;
 }
 
 bool H5Dataset::SetRaw(hid_t nType, const void* data) {
+  QPT_PROFILE_SCOPE("H5Dataset::Write");
   if (H5Dwrite(GetHandle(), nType, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) < 0)
     return false;
   if (H5Dflush(GetHandle()) < 0) return false;
   return true;
 }
 
+bool H5Dataset::GetRawSlab(hid_t nType, const std::vector<std::size_t>& offset,
+                           const std::vector<std::size_t>& count, void* data) {
+  QPT_PROFILE_SCOPE("H5Dataset::ReadSlab");
+  hid_t fspace = SelectSlab(GetHandle(), offset, count);
+  if (fspace < 0) return false;
+  auto fspaceGuard = CreateScopeGuard([=]() { H5Sclose(fspace); });
+
+  std::vector<hsize_t> dims(count.begin(), count.end());
+  hid_t mspace = H5Screate_simple(dims.size(), dims.data(), nullptr);
+  if (mspace < 0) return false;
+  auto mspaceGuard = CreateScopeGuard([=]() { H5Sclose(mspace); });
+
+  return H5Dread(GetHandle(), nType, mspace, fspace, H5P_DEFAULT, data) >= 0;
+}
+
+bool H5Dataset::SetRawSlab(hid_t nType, const std::vector<std::size_t>& offset,
+                           const std::vector<std::size_t>& count,
+                           const void* data, bool flush) {
+  QPT_PROFILE_SCOPE("H5Dataset::WriteSlab");
+  hid_t fspace = SelectSlab(GetHandle(), offset, count);
+  if (fspace < 0) return false;
+  auto fspaceGuard = CreateScopeGuard([=]() { H5Sclose(fspace); });
+
+  std::vector<hsize_t> dims(count.begin(), count.end());
+  hid_t mspace = H5Screate_simple(dims.size(), dims.data(), nullptr);
+  if (mspace < 0) return false;
+  auto mspaceGuard = CreateScopeGuard([=]() { H5Sclose(mspace); });
+
+  if (H5Dwrite(GetHandle(), nType, mspace, fspace, H5P_DEFAULT, data) < 0)
+    return false;
+  if (flush && H5Dflush(GetHandle()) < 0) return false;
+  return true;
+}
+
+bool H5Dataset::SetRowCount(std::size_t rows) {
+  auto shape = GetShape();
+  if (shape.empty()) return false;
+  shape[0] = rows;
+  std::vector<hsize_t> dims(shape.begin(), shape.end());
+  return H5Dset_extent(GetHandle(), dims.data()) >= 0;
+}
+
+bool H5Dataset::AppendRaw(hid_t nType, std::size_t rows, const void* data) {
+  auto shape = GetShape();
+  if (shape.empty()) return false;
+  if (rows == 0) return true;
+
+  std::vector<std::size_t> offset(shape.size(), 0);
+  offset[0] = shape[0];
+  shape[0] += rows;
+  std::vector<hsize_t> dims(shape.begin(), shape.end());
+  if (H5Dset_extent(GetHandle(), dims.data()) < 0) return false;
+
+  std::vector<std::size_t> count = shape;
+  count[0] = rows;
+  return SetRawSlab(nType, offset, count, data, false);
+}
+
 }  // namespace QPT
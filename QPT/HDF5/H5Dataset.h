@@ -3,8 +3,11 @@
 #ifndef QPT_HDF5_H5DATASET_H_
 #define QPT_HDF5_H5DATASET_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "../Serialization.h"
 #include "H5Object.h"
@@ -18,10 +21,20 @@ class H5Dataset : public H5Object {
   static std::optional<H5Dataset> Create(hid_t grp, hid_t sType,
                                          const std::string& name,
                                          const std::vector<std::size_t>& shape);
+  static std::optional<H5Dataset> CreateAppendable(
+      hid_t grp, hid_t sType, const std::string& name,
+      const std::vector<std::size_t>& rowShape, std::size_t chunkRows);
   H5Dataset(hid_t hid);
 
  public:
   std::vector<std::size_t> GetShape();
+  // bytes allocated in the file for the data (0 if nothing was written yet)
+  std::size_t GetStorageSize();
+  // shape of the chunks (empty if the dataset is not chunked)
+  std::vector<std::size_t> GetChunkShape();
+  // True if both datasets are chunked with the same chunk shape, type and
+  // filter pipeline, i.e. raw chunks of one are valid chunks of the other
+  bool HasCompatibleChunks(H5Dataset& other);
 
   template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
   bool Get(T& data);
@@ -36,9 +49,69 @@ class H5Dataset : public H5Object {
   template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
   bool Set(const T& data);
 
+  // Hyperslab access: offset has the rank of the dataset, the shape of data
+  // may have a lower rank (missing leading dimensions are treated as 1)
+  template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
+  bool GetSlab(const std::vector<std::size_t>& offset,
+               const std::vector<std::size_t>& shape, T& data);
+  template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
+  bool SetSlab(const std::vector<std::size_t>& offset, const T& data);
+
+  // Appends rows along the first (extendible) dimension of a dataset that
+  // was created with H5Group::CreateAppendableDataset. The shape of data must
+  // match the shape of a single row. Appends are not flushed (see
+  // H5Object::Flush), the rows reach the file at the latest on close.
+  template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
+  bool Append(const T& data);
+  template <typename T>
+  bool AppendData(std::size_t rows, const T* data);
+  // Sets the length of the first (extendible) dimension, e.g. to drop the
+  // rows of an interrupted append
+  bool SetRowCount(std::size_t rows);
+
+  // all strings of a string dataset of any rank (see
+  // H5Group::CreateStringDataset)
+  std::optional<H5StringTable> GetStrings();
+
+  // Raw (still encoded) chunk at the given offset (a multiple of the chunk
+  // shape). data is empty if the chunk has not been allocated yet.
+  bool ReadRawChunk(const std::vector<std::size_t>& offset,
+                    std::uint32_t& filterMask, std::vector<std::uint8_t>& data);
+  bool WriteRawChunk(const std::vector<std::size_t>& offset,
+                     std::uint32_t filterMask,
+                     const std::vector<std::uint8_t>& data);
+
+  // Copies the hyperslab to destOffset in dest (converting to the type of
+  // dest). The data is passed through memory in pieces of at most maxBytes.
+  bool CopySlab(const std::vector<std::size_t>& offset,
+                const std::vector<std::size_t>& count, H5Dataset& dest,
+                const std::vector<std::size_t>& destOffset,
+                std::size_t maxBytes = 64 << 20);
+
+  // Hyperslab access to/from a contiguous buffer of native values. Writes
+  // flush the dataset unless flush is false (e.g. for several writes that
+  // are followed by a single H5Object::Flush).
+  template <typename T>
+  bool GetSlabData(const std::vector<std::size_t>& offset,
+                   const std::vector<std::size_t>& count, T* data);
+  template <typename T>
+  bool SetSlabData(const std::vector<std::size_t>& offset,
+                   const std::vector<std::size_t>& count, const T* data,
+                   bool flush = true);
+
  protected:
   bool GetRaw(hid_t nType, void* data);
   bool SetRaw(hid_t nType, const void* data);
+  bool GetRawSlab(hid_t nType, const std::vector<std::size_t>& offset,
+                  const std::vector<std::size_t>& count, void* data);
+  bool SetRawSlab(hid_t nType, const std::vector<std::size_t>& offset,
+                  const std::vector<std::size_t>& count, const void* data,
+                  bool flush = true);
+  bool AppendRaw(hid_t nType, std::size_t rows, const void* data);
+
+ private:
+  static std::vector<std::size_t> GetSlabCount(
+      std::size_t rank, const std::vector<std::size_t>& shape);
 };
 
 // Template function definitions
@@ -60,6 +133,70 @@ inline bool H5Dataset::Set(const T& data) {
   return SetRaw(TT::GetNativeType(), Serialize(data).GetData());
 }
 
+inline std::vector<std::size_t> H5Dataset::GetSlabCount(
+    std::size_t rank, const std::vector<std::size_t>& shape) {
+  if (shape.size() > rank) return {};
+  std::vector<std::size_t> count(rank, 1);
+  std::copy(shape.begin(), shape.end(), count.end() - shape.size());
+  return count;
+}
+
+template <typename T, typename>
+inline bool H5Dataset::GetSlab(const std::vector<std::size_t>& offset,
+                               const std::vector<std::size_t>& shape,
+                               T& data) {
+  if (SerializationTraits<T>::GetRank() != shape.size()) return false;
+  const auto count = GetSlabCount(offset.size(), shape);
+  if (count.empty()) return false;
+  using TT = H5TypeTraits<typename SerializationTraits<T>::Storage_t>;
+  Deserializer<T> des(data, shape);
+  if (!GetRawSlab(TT::GetNativeType(), offset, count, des.GetData()))
+    return false;
+  des.Execute();
+  return true;
+}
+
+template <typename T, typename>
+inline bool H5Dataset::SetSlab(const std::vector<std::size_t>& offset,
+                               const T& data) {
+  const auto count =
+      GetSlabCount(offset.size(), SerializationTraits<T>::GetShape(data));
+  if (count.empty()) return false;
+  using TT = H5TypeTraits<typename SerializationTraits<T>::Storage_t>;
+  return SetRawSlab(TT::GetNativeType(), offset, count,
+                    Serialize(data).GetData());
+}
+
+template <typename T, typename>
+inline bool H5Dataset::Append(const T& data) {
+  auto shape = GetShape();
+  if (shape.empty()) return false;
+  shape.erase(shape.begin());
+  if (SerializationTraits<T>::GetShape(data) != shape) return false;
+  using TT = H5TypeTraits<typename SerializationTraits<T>::Storage_t>;
+  return AppendRaw(TT::GetNativeType(), 1, Serialize(data).GetData());
+}
+
+template <typename T>
+inline bool H5Dataset::AppendData(std::size_t rows, const T* data) {
+  return AppendRaw(H5TypeTraits<T>::GetNativeType(), rows, data);
+}
+
+template <typename T>
+inline bool H5Dataset::GetSlabData(const std::vector<std::size_t>& offset,
+                                   const std::vector<std::size_t>& count,
+                                   T* data) {
+  return GetRawSlab(H5TypeTraits<T>::GetNativeType(), offset, count, data);
+}
+
+template <typename T>
+inline bool H5Dataset::SetSlabData(const std::vector<std::size_t>& offset,
+                                   const std::vector<std::size_t>& count,
+                                   const T* data, bool flush) {
+  return SetRawSlab(H5TypeTraits<T>::GetNativeType(), offset, count, data,
+                    flush);
+}
+
 }  // namespace QPT
 
 #endif  // !QPT_HDF5_H5DATASET_H_
\ No newline at end of file
@@ -32,6 +32,8 @@ std::optional<H5File> H5File::Open(const std::string& name,
     const auto creationFlags =
         (flag & H5File_MUST_NOT_EXIST) ? H5F_ACC_EXCL : H5F_ACC_TRUNC;
     file = H5Fcreate(name.c_str(), creationFlags, H5P_DEFAULT, H5P_DEFAULT);
+  } else if (flag & H5File_READ_ONLY) {
+    file = H5Fopen(name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
   } else {
     // default open mode
     // open exisiting file -> if it does not exist create new file
@@ -17,6 +17,8 @@ enum H5FileOpenFlag {
   H5File_MUST_EXIST = 1,
   H5File_MUST_NOT_EXIST = 2,
   H5File_TRUNCATE = 4,
+  // opens an existing file without write access
+  H5File_READ_ONLY = 8,
 };
 
 class H5File : public H5Group {
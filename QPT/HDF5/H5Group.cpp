@@ -4,6 +4,8 @@
 
 #include <hdf5.h>
 
+#include "../ScopeGuard.h"
+
 namespace QPT {
 
 // Helpers
@@ -72,6 +74,98 @@ std::optional<H5Dataset> H5Group::OpenExistingDataset(const std::string& name) {
   return (handle >= 0) ? std::make_optional(H5Dataset(handle)) : std::nullopt;
 }
 
+std::optional<H5Dataset> H5Group::CreateStringDataset(
+    const std::string& name, const H5StringTable& strings,
+    H5StringType type) {
+  if (H5Lexists(GetHandle(), name.c_str(), H5P_DEFAULT) != 0)
+    return std::nullopt;
+
+  const hsize_t dims = strings.GetCount();
+  hid_t dspace = H5Screate_simple(1, &dims, nullptr);
+  if (dspace < 0) return std::nullopt;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  hid_t dataset = H5I_INVALID_HID;
+  auto write = [&](hid_t stype, const void* data) {
+    H5E_BEGIN_TRY
+    dataset = H5Dcreate2(GetHandle(), name.c_str(), stype, dspace,
+                         H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5E_END_TRY
+    return dataset >= 0 && H5Dwrite(dataset, stype, H5S_ALL, H5S_ALL,
+                                    H5P_DEFAULT, data) >= 0;
+  };
+  const bool success = strings.WriteH5(type, write);
+
+  if (dataset < 0) return std::nullopt;
+  H5Dataset ds(dataset);
+  if (!success) {
+    Remove(name);
+    return std::nullopt;
+  }
+  return ds;
+}
+
+std::optional<H5Dataset> H5Group::CreateDatasetLike(
+    const std::string& name, H5Dataset& proto,
+    const std::vector<std::size_t>& shape) {
+  if (H5Lexists(GetHandle(), name.c_str(), H5P_DEFAULT) != 0)
+    return std::nullopt;
+
+  hid_t type = H5Dget_type(proto.GetHandle());
+  if (type < 0) return std::nullopt;
+  auto typeGuard = CreateScopeGuard([=]() { H5Tclose(type); });
+  hid_t dcpl = H5Dget_create_plist(proto.GetHandle());
+  if (dcpl < 0) return std::nullopt;
+  auto dcplGuard = CreateScopeGuard([=]() { H5Pclose(dcpl); });
+  hid_t pspace = H5Dget_space(proto.GetHandle());
+  if (pspace < 0) return std::nullopt;
+  auto pspaceGuard = CreateScopeGuard([=]() { H5Sclose(pspace); });
+
+  const int ndims = H5Sget_simple_extent_ndims(pspace);
+  if (ndims < 0 || static_cast<std::size_t>(ndims) != shape.size())
+    return std::nullopt;
+  std::vector<hsize_t> dims(shape.begin(), shape.end());
+  std::vector<hsize_t> maxDims(ndims);
+  if (H5Sget_simple_extent_dims(pspace, nullptr, maxDims.data()) < 0)
+    return std::nullopt;
+  for (int i = 0; i < ndims; i++) {
+    if (maxDims[i] != H5S_UNLIMITED) maxDims[i] = dims[i];
+  }
+
+  // compact storage is limited to 64 KiB
+  if (H5Pget_layout(dcpl) == H5D_COMPACT &&
+      H5Pset_layout(dcpl, H5D_CONTIGUOUS) < 0)
+    return std::nullopt;
+
+  hid_t dspace = H5Screate_simple(ndims, dims.data(), maxDims.data());
+  if (dspace < 0) return std::nullopt;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  hid_t dataset = H5I_INVALID_HID;
+  H5E_BEGIN_TRY
+  dataset = H5Dcreate2(GetHandle(), name.c_str(), type, dspace, H5P_DEFAULT,
+                       dcpl, H5P_DEFAULT);
+  H5E_END_TRY
+
+  return (dataset >= 0) ? std::make_optional(H5Dataset(dataset)) : std::nullopt;
+}
+
+bool H5Group::CopyObject(const std::string& name, H5Group& dest,
+                         const std::string& destName) {
+  if (H5Lexists(GetHandle(), name.c_str(), H5P_DEFAULT) <= 0) return false;
+  herr_t status = -1;
+  H5E_BEGIN_TRY
+  status = H5Ocopy(GetHandle(), name.c_str(), dest.GetHandle(),
+                   destName.c_str(), H5P_DEFAULT, H5P_DEFAULT);
+  H5E_END_TRY
+  return status >= 0;
+}
+
+bool H5Group::Remove(const std::string& name) {
+  if (H5Lexists(GetHandle(), name.c_str(), H5P_DEFAULT) <= 0) return false;
+  return H5Ldelete(GetHandle(), name.c_str(), H5P_DEFAULT) >= 0;
+}
+
 void H5Group::EnumerateSubgroups(
     std::function<void(const std::string&)> callback) {
   H5Literate(GetHandle(), H5_INDEX_NAME, H5_ITER_NATIVE, nullptr,
@@ -28,6 +28,34 @@ class H5Group : public H5Object {
       const std::string& name, const std::vector<std::size_t>& shape);
   template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
   std::optional<H5Dataset> CreateDataset(const std::string& name, const T& val);
+  // Creates an empty dataset whose first dimension grows with every call to
+  // H5Dataset::Append. rowShape is the shape of a single row of type T.
+  // chunkRows is reduced such that a chunk holds at most 1 MiB (but at least
+  // a single row).
+  template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
+  std::optional<H5Dataset> CreateAppendableDataset(
+      const std::string& name, const std::vector<std::size_t>& rowShape,
+      std::size_t chunkRows = 1024);
+
+  // one-dimensional dataset of strings (written at once)
+  std::optional<H5Dataset> CreateStringDataset(
+      const std::string& name, const H5StringTable& strings,
+      H5StringType type = H5String_VARIABLE);
+
+  // Creates an empty dataset with the type and the creation properties
+  // (layout, chunk shape, filters, fill value) of proto but another shape.
+  // Dimensions that are extendible in proto stay extendible.
+  std::optional<H5Dataset> CreateDatasetLike(
+      const std::string& name, H5Dataset& proto,
+      const std::vector<std::size_t>& shape);
+
+  // Copies the subgroup or dataset name (including all attributes and
+  // subobjects) to destName in dest. Chunks are copied without decoding.
+  bool CopyObject(const std::string& name, H5Group& dest,
+                  const std::string& destName);
+
+  // removes the link to a subgroup or dataset
+  bool Remove(const std::string& name);
 
   void EnumerateSubgroups(std::function<void(const std::string&)> callback);
   void EnumerateDatasets(std::function<void(const std::string&)> callback);
@@ -51,6 +79,16 @@ inline std::optional<H5Dataset> H5Group::CreateDataset(const std::string& name,
   return optDs;
 }
 
+template <typename T, typename>
+inline std::optional<H5Dataset> H5Group::CreateAppendableDataset(
+    const std::string& name, const std::vector<std::size_t>& rowShape,
+    std::size_t chunkRows) {
+  const auto stype = H5TypeTraits<
+      typename SerializationTraits<T>::Storage_t>::GetStorageType();
+  return H5Dataset::CreateAppendable(GetHandle(), stype, name, rowShape,
+                                     chunkRows);
+}
+
 }  // namespace QPT
 
 #endif  // !QPT_HDF5_H5GROUP_H_
\ No newline at end of file
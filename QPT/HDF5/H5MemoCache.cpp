@@ -0,0 +1,242 @@
+// Philipp Neufeld, 2023
+
+#include "H5MemoCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "H5Checkpoint.h"
+
+namespace QPT {
+
+//
+// H5MemoKey
+//
+
+std::vector<std::uint8_t> H5MemoKey::GetBytes() const {
+  // format version first, such that the key is never empty
+  std::vector<std::uint8_t> bytes = {'Q', 'P', 'T', 1};
+  for (const auto& [name, param] : m_parameters)
+    bytes.insert(bytes.end(), param.bytes.begin(), param.bytes.end());
+  return bytes;
+}
+
+std::uint64_t H5MemoKey::GetHash() const {
+  const auto bytes = GetBytes();
+  return H5CheckpointManager::HashChunk(bytes.data(), bytes.size());
+}
+
+bool H5MemoKey::WriteAttributes(H5Object& obj) const {
+  for (const auto& [name, param] : m_parameters) {
+    if (!param.write(obj, "param." + name)) return false;
+  }
+  return true;
+}
+
+//
+// H5MemoCache
+//
+
+std::optional<H5MemoCache> H5MemoCache::Open(const std::string& filename,
+                                             std::size_t maxBytes) {
+  auto file = H5File::Open(filename, H5File_DEFAULT);
+  if (!file) return std::nullopt;
+  H5MemoCache cache(std::move(*file), maxBytes);
+  if (!cache.m_entries || !cache.LoadIndex() || !cache.ReconcileIndex())
+    return std::nullopt;
+  return std::make_optional(std::move(cache));
+}
+
+H5MemoCache::H5MemoCache(H5File file, std::size_t maxBytes)
+    : m_file(std::move(file)), m_maxBytes(maxBytes) {
+  m_entries = m_file->OpenSubgroup("entries");
+}
+
+H5MemoCache::~H5MemoCache() {
+  if (m_dirty && m_file && m_file->IsValid()) Flush();
+}
+
+std::string H5MemoCache::GetEntryName(std::uint64_t hash) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return buffer;
+}
+
+std::size_t H5MemoCache::GetStorageSize(H5Group& group) {
+  std::size_t size = 0;
+  group.EnumerateDatasets([&](const std::string& name) {
+    auto ds = group.OpenExistingDataset(name);
+    if (ds) size += ds->GetStorageSize();
+  });
+  group.EnumerateSubgroups([&](const std::string& name) {
+    auto sub = group.OpenSubgroup(name);
+    if (sub) size += GetStorageSize(*sub);
+  });
+  return size;
+}
+
+bool H5MemoCache::LoadIndex() {
+  // rows (hash, bytes), least recently used last
+  if (!m_file->HasDataset("index")) return true;
+  auto ds = m_file->OpenExistingDataset("index");
+  if (!ds) return false;
+  const auto shape = ds->GetShape();
+  if (shape.size() != 2 || shape[1] != 2) return false;
+
+  std::vector<std::uint64_t> rows(shape[0] * 2);
+  if (shape[0] > 0 && !ds->GetSlabData({0, 0}, shape, rows.data()))
+    return false;
+  for (std::size_t i = 0; i < shape[0]; i++) {
+    const std::uint64_t hash = rows[2 * i];
+    // skip stale rows (e.g. the file was modified without a flush)
+    if (m_index.count(hash) || !m_entries->HasSubgroup(GetEntryName(hash)))
+      continue;
+    m_lru.push_back(hash);
+    m_index[hash] = Entry{rows[2 * i + 1], std::prev(m_lru.end())};
+    m_totalBytes += rows[2 * i + 1];
+  }
+  return true;
+}
+
+bool H5MemoCache::ReconcileIndex() {
+  std::vector<std::string> names;
+  m_entries->EnumerateSubgroups(
+      [&](const std::string& name) { names.push_back(name); });
+
+  for (const auto& name : names) {
+    const std::uint64_t hash = std::strtoull(name.c_str(), nullptr, 16);
+    const bool named = name == GetEntryName(hash);
+    if (named && m_index.count(hash)) continue;
+
+    // the key is written last: entries without it are incomplete
+    auto group = m_entries->OpenSubgroup(name);
+    if (!group) return false;
+    const bool complete = named && group->HasAttribute("key");
+    m_dirty = true;
+    if (!complete) {
+      if (!m_entries->Remove(name)) return false;
+      continue;
+    }
+    const std::size_t bytes = GetStorageSize(*group);
+    m_lru.push_front(hash);
+    m_index[hash] = Entry{bytes, m_lru.begin()};
+    m_totalBytes += bytes;
+  }
+  Evict(0);
+  return true;
+}
+
+bool H5MemoCache::Flush() {
+  std::vector<std::uint64_t> rows;
+  rows.reserve(2 * m_lru.size());
+  for (auto hash : m_lru) {
+    rows.push_back(hash);
+    rows.push_back(m_index[hash].bytes);
+  }
+
+  m_file->Remove("index");
+  auto ds = m_file->CreateUninitializedDataset<std::uint64_t>(
+      "index", {m_lru.size(), 2});
+  if (!ds) return false;
+  if (!rows.empty() &&
+      !ds->SetSlabData({0, 0}, {m_lru.size(), 2}, rows.data()))
+    return false;
+  m_dirty = false;
+  return true;
+}
+
+std::optional<H5Group> H5MemoCache::OpenStoredEntry(std::uint64_t hash,
+                                                    const H5MemoKey& key) {
+  if (m_index.count(hash) == 0) return std::nullopt;
+  auto group = m_entries->OpenSubgroup(GetEntryName(hash));
+  const auto stored = group
+                          ? group->GetAttribute<std::vector<std::uint8_t>>(
+                                "key")
+                          : std::nullopt;
+  if (!stored || *stored != key.GetBytes()) return std::nullopt;
+  return group;
+}
+
+std::optional<H5Group> H5MemoCache::OpenEntry(std::uint64_t hash,
+                                              const H5MemoKey& key) {
+  auto group = OpenStoredEntry(hash, key);
+  if (!group) return std::nullopt;
+
+  // mark as most recently used
+  m_lru.splice(m_lru.begin(), m_lru, m_index[hash].lru);
+  m_dirty = true;
+  return group;
+}
+
+bool H5MemoCache::RemoveEntry(std::uint64_t hash) {
+  auto it = m_index.find(hash);
+  if (it == m_index.end()) return false;
+  m_totalBytes -= it->second.bytes;
+  m_lru.erase(it->second.lru);
+  m_index.erase(it);
+  m_dirty = true;
+  return m_entries->Remove(GetEntryName(hash));
+}
+
+void H5MemoCache::Evict(std::uint64_t keep) {
+  while (m_totalBytes > m_maxBytes && !m_lru.empty() &&
+         m_lru.back() != keep)
+    RemoveEntry(m_lru.back());
+}
+
+std::optional<H5Group> H5MemoCache::Find(const H5MemoKey& key) {
+  auto group = OpenEntry(key.GetHash(), key);
+  if (group)
+    m_hits++;
+  else
+    m_misses++;
+  return group;
+}
+
+bool H5MemoCache::Contains(const H5MemoKey& key) {
+  return OpenStoredEntry(key.GetHash(), key).has_value();
+}
+
+bool H5MemoCache::Remove(const H5MemoKey& key) {
+  return RemoveEntry(key.GetHash());
+}
+
+void H5MemoCache::SetMaxSize(std::size_t maxBytes) {
+  m_maxBytes = maxBytes;
+  Evict(0);
+}
+
+std::optional<H5Group> H5MemoCache::GetOrCompute(const H5MemoKey& key,
+                                                 const Compute_t& compute) {
+  const std::uint64_t hash = key.GetHash();
+  if (auto group = OpenEntry(hash, key)) {
+    m_hits++;
+    return group;
+  }
+  m_misses++;
+
+  // a different key with the same hash (or a leftover) is replaced
+  const auto name = GetEntryName(hash);
+  RemoveEntry(hash);
+  m_entries->Remove(name);
+
+  auto group = m_entries->OpenSubgroup(name);
+  if (!group) return std::nullopt;
+  if (!compute(*group) || !key.WriteAttributes(*group) ||
+      !group->SetAttribute("key", key.GetBytes())) {
+    m_entries->Remove(name);
+    return std::nullopt;
+  }
+
+  const std::size_t bytes = GetStorageSize(*group);
+  m_lru.push_front(hash);
+  m_index[hash] = Entry{bytes, m_lru.begin()};
+  m_totalBytes += bytes;
+  m_dirty = true;
+  Evict(hash);
+  return group;
+}
+
+}  // namespace QPT
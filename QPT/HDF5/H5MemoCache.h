@@ -0,0 +1,175 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5MEMOCACHE_H_
+#define QPT_HDF5_H5MEMOCACHE_H_
+
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../Serialization.h"
+#include "H5File.h"
+
+namespace QPT {
+
+// Input parameters of a memoized computation. Every parameter is serialized
+// with its SerializationTraits into a canonical byte string (name, type,
+// shape and raw values, ordered by name), i.e. the order of the calls to
+// Add does not matter. The hash of the byte string addresses the results
+// in a H5MemoCache.
+class H5MemoKey {
+ public:
+  template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
+  H5MemoKey& Add(const std::string& name, const T& value);
+
+  // canonical serialization of all parameters
+  std::vector<std::uint8_t> GetBytes() const;
+  std::uint64_t GetHash() const;
+
+  // stores the parameters as attributes "param.<name>" (for inspection)
+  bool WriteAttributes(H5Object& obj) const;
+
+ private:
+  struct Parameter {
+    std::vector<std::uint8_t> bytes;
+    std::function<bool(H5Object&, const std::string&)> write;
+  };
+  std::map<std::string, Parameter> m_parameters;
+};
+
+// Memoization of computations whose results are stored in a HDF5 file.
+// Every entry is a group "/entries/<hash>" holding the result datasets, the
+// canonical key bytes (attribute "key", compared on every hit such that
+// hash collisions are never returned as hits) and the parameters as
+// attributes. An in-memory index (persisted in the dataset "/index" by
+// Flush and on destruction) maps the hash to the entry, so lookups never
+// enumerate groups. Open reconciles the index with the entries: entries
+// that were inserted after the last Flush (e.g. before a crash) are added,
+// incomplete entries (without key) are removed. When the total storage size
+// of the entries exceeds the limit, the least recently used entries are
+// removed.
+// Note: HDF5 does not return the space of removed entries to the file
+// system, it is reused for new entries while the file is open.
+class H5MemoCache {
+ public:
+  // computes the results of a miss into the given (empty) group
+  using Compute_t = std::function<bool(H5Group&)>;
+
+  static std::optional<H5MemoCache> Open(const std::string& filename,
+                                         std::size_t maxBytes);
+
+ protected:
+  H5MemoCache(H5File file, std::size_t maxBytes);
+
+ public:
+  ~H5MemoCache();
+
+  H5MemoCache(const H5MemoCache&) = delete;
+  H5MemoCache(H5MemoCache&&) = default;
+  H5MemoCache& operator=(const H5MemoCache&) = delete;
+  H5MemoCache& operator=(H5MemoCache&&) = default;
+
+  // Returns the results group of the key. On a miss the group is created
+  // and filled by compute; it is discarded if compute fails.
+  std::optional<H5Group> GetOrCompute(const H5MemoKey& key,
+                                      const Compute_t& compute);
+  // results group of the key (std::nullopt on a miss)
+  std::optional<H5Group> Find(const H5MemoKey& key);
+  bool Contains(const H5MemoKey& key);
+  bool Remove(const H5MemoKey& key);
+
+  void SetMaxSize(std::size_t maxBytes);
+  std::size_t GetMaxSize() const { return m_maxBytes; }
+  std::size_t GetTotalSize() const { return m_totalBytes; }
+  std::size_t GetEntryCount() const { return m_index.size(); }
+  std::size_t GetHitCount() const { return m_hits; }
+  std::size_t GetMissCount() const { return m_misses; }
+
+  // writes the index (entries in LRU order)
+  bool Flush();
+
+ private:
+  struct Entry {
+    std::size_t bytes;
+    std::list<std::uint64_t>::iterator lru;
+  };
+
+  bool LoadIndex();
+  // adds the entries that are missing in the index (most recently used)
+  bool ReconcileIndex();
+  // the entry if it is indexed and stores the key (without marking it as
+  // used)
+  std::optional<H5Group> OpenStoredEntry(std::uint64_t hash,
+                                         const H5MemoKey& key);
+  std::optional<H5Group> OpenEntry(std::uint64_t hash, const H5MemoKey& key);
+  bool RemoveEntry(std::uint64_t hash);
+  void Evict(std::uint64_t keep);
+
+  static std::string GetEntryName(std::uint64_t hash);
+  static std::size_t GetStorageSize(H5Group& group);
+
+ private:
+  std::optional<H5File> m_file;
+  std::optional<H5Group> m_entries;
+  std::size_t m_maxBytes;
+  std::size_t m_totalBytes = 0;
+  std::size_t m_hits = 0;
+  std::size_t m_misses = 0;
+  bool m_dirty = false;
+
+  // most recently used entries first
+  std::list<std::uint64_t> m_lru;
+  std::unordered_map<std::uint64_t, Entry> m_index;
+};
+
+// Template function definitions
+template <typename T, typename>
+H5MemoKey& H5MemoKey::Add(const std::string& name, const T& value) {
+  using Storage_t = typename SerializationTraits<T>::Storage_t;
+  auto append = [](std::vector<std::uint8_t>& bytes, const void* data,
+                   std::size_t size) {
+    const auto ptr = static_cast<const std::uint8_t*>(data);
+    bytes.insert(bytes.end(), ptr, ptr + size);
+  };
+
+  // name, type (size, floating point, signed, character; complex numbers:
+  // component size, floating point and bit 4), shape, values
+  Parameter param;
+  const std::uint64_t nameSize = name.size();
+  append(param.bytes, &nameSize, sizeof(nameSize));
+  append(param.bytes, name.data(), name.size());
+  constexpr bool complex = std::is_same_v<Storage_t, std::complex<float>> ||
+                           std::is_same_v<Storage_t, std::complex<double>>;
+  const std::uint8_t type = static_cast<std::uint8_t>(
+      complex ? (sizeof(Storage_t) / 2) | 0x90
+              : sizeof(Storage_t) | (std::is_floating_point_v<Storage_t> << 7) |
+                    (std::is_signed_v<Storage_t> << 6) |
+                    (std::is_same_v<Storage_t, char> << 5));
+  append(param.bytes, &type, sizeof(type));
+  const auto shape = SerializationTraits<T>::GetShape(value);
+  const std::uint64_t rank = shape.size();
+  append(param.bytes, &rank, sizeof(rank));
+  for (std::uint64_t dim : shape) append(param.bytes, &dim, sizeof(dim));
+  auto ser = Serialize(value);
+  append(param.bytes, ser.GetData(), ser.GetSize() * sizeof(Storage_t));
+
+  // HDF5 does not allow empty attributes
+  const bool empty = (ser.GetSize() == 0);
+  param.write = [value, empty](H5Object& obj, const std::string& attr) {
+    return empty || obj.SetAttribute(attr, value);
+  };
+  m_parameters[name] = std::move(param);
+  return *this;
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5MEMOCACHE_H_
@@ -0,0 +1,168 @@
+// Philipp Neufeld, 2023
+
+#include "H5Merge.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace QPT {
+
+// Helpers
+// names in the order of their first occurrence
+void AddUniqueName(std::vector<std::string>& names, const std::string& name) {
+  if (std::find(names.begin(), names.end(), name) == names.end())
+    names.push_back(name);
+}
+
+// Shape of the concatenation of the parts along axis and the offsets of the
+// parts (std::nullopt if the ranks or the other dimensions differ)
+std::optional<std::vector<std::size_t>> GetConcatenatedShape(
+    std::vector<H5Dataset>& parts, std::size_t axis,
+    std::vector<std::size_t>& offsets) {
+  auto shape = parts[0].GetShape();
+  if (axis >= shape.size()) return std::nullopt;
+  offsets.clear();
+  shape[axis] = 0;
+  for (auto& part : parts) {
+    auto partShape = part.GetShape();
+    if (partShape.size() != shape.size()) return std::nullopt;
+    offsets.push_back(shape[axis]);
+    shape[axis] += partShape[axis];
+    partShape[axis] = shape[axis];
+    if (partShape != shape) return std::nullopt;
+  }
+  return shape;
+}
+
+bool H5Merger::Merge(std::vector<H5Group> sources, H5Group& dest) {
+  m_stats = Statistics();
+  if (sources.empty()) return false;
+  return MergeGroups(sources, dest, "");
+}
+
+bool H5Merger::MergeGroups(std::vector<H5Group>& sources, H5Group& dest,
+                           const std::string& path) {
+  for (auto& source : sources) {
+    if (!source.CopyAttributes(dest)) return false;
+  }
+
+  std::vector<std::string> groups, datasets;
+  for (auto& source : sources) {
+    source.EnumerateSubgroups(
+        [&](const std::string& name) { AddUniqueName(groups, name); });
+    source.EnumerateDatasets(
+        [&](const std::string& name) { AddUniqueName(datasets, name); });
+  }
+
+  for (const auto& name : groups) {
+    std::vector<std::size_t> owners;
+    for (std::size_t i = 0; i < sources.size(); i++) {
+      if (sources[i].HasSubgroup(name)) owners.push_back(i);
+    }
+    if (owners.size() == 1) {
+      if (!sources[owners[0]].CopyObject(name, dest, name)) return false;
+      m_stats.copiedObjects++;
+      continue;
+    }
+
+    std::vector<H5Group> subgroups;
+    for (auto i : owners) subgroups.push_back(*sources[i].OpenSubgroup(name));
+    auto sub = dest.OpenSubgroup(name);
+    if (!sub || !MergeGroups(subgroups, *sub, path + name + "/")) return false;
+  }
+
+  for (const auto& name : datasets) {
+    std::vector<H5Dataset> parts;
+    std::size_t first = sources.size();
+    for (std::size_t i = 0; i < sources.size(); i++) {
+      if (auto ds = sources[i].OpenExistingDataset(name)) {
+        parts.push_back(std::move(*ds));
+        first = std::min(first, i);
+      }
+    }
+    std::vector<std::size_t> offsets;
+    std::optional<std::vector<std::size_t>> shape;
+    const bool concatenate =
+        parts.size() > 1 && (!m_filter || m_filter(path + name));
+    if (concatenate) shape = GetConcatenatedShape(parts, m_axis, offsets);
+    if (!shape) {
+      if (!sources[first].CopyObject(name, dest, name)) return false;
+      m_stats.copiedObjects++;
+      if (concatenate) m_stats.incompatibleDatasets++;
+      continue;
+    }
+    if (!Concatenate(parts, *shape, offsets, dest, name)) return false;
+  }
+  return true;
+}
+
+bool H5Merger::Concatenate(std::vector<H5Dataset>& sources,
+                           const std::vector<std::size_t>& shape,
+                           const std::vector<std::size_t>& offsets,
+                           H5Group& dest, const std::string& name) {
+  auto merged = dest.CreateDatasetLike(name, sources[0], shape);
+  if (!merged) return false;
+  for (auto& source : sources) {
+    if (!source.CopyAttributes(*merged)) return false;
+  }
+
+  // raw chunks require the chunk grids to line up, i.e. only the last
+  // source may end with a partial chunk along the axis
+  const auto chunk = merged->GetChunkShape();
+  bool converted = false;
+  for (std::size_t i = 0; i < sources.size(); i++) {
+    auto count = sources[i].GetShape();
+    const bool aligned =
+        !chunk.empty() && offsets[i] % chunk[m_axis] == 0 &&
+        (i + 1 == sources.size() || count[m_axis] % chunk[m_axis] == 0);
+    if (aligned && sources[i].HasCompatibleChunks(*merged)) {
+      if (!CopyChunks(sources[i], *merged, offsets[i])) return false;
+      continue;
+    }
+
+    std::vector<std::size_t> offset(count.size(), 0);
+    std::vector<std::size_t> destOffset(count.size(), 0);
+    destOffset[m_axis] = offsets[i];
+    if (!sources[i].CopySlab(offset, count, *merged, destOffset)) return false;
+    converted = true;
+  }
+
+  m_stats.concatenatedDatasets++;
+  if (converted) m_stats.convertedDatasets++;
+  return true;
+}
+
+bool H5Merger::CopyChunks(H5Dataset& source, H5Dataset& dest,
+                          std::size_t shift) {
+  const auto shape = source.GetShape();
+  const auto chunk = source.GetChunkShape();
+  for (std::size_t i = 0; i < shape.size(); i++) {
+    if (shape[i] == 0) return true;
+  }
+
+  // visit the chunk grid in row-major order (unallocated chunks are skipped
+  // and stay at the fill value)
+  std::vector<std::size_t> offset(shape.size(), 0);
+  std::vector<std::uint8_t> data;
+  while (true) {
+    std::uint32_t filterMask = 0;
+    if (!source.ReadRawChunk(offset, filterMask, data)) return false;
+    if (!data.empty()) {
+      auto destOffset = offset;
+      destOffset[m_axis] += shift;
+      if (!dest.WriteRawChunk(destOffset, filterMask, data)) return false;
+      m_stats.rawChunks++;
+    }
+
+    std::size_t dim = shape.size();
+    while (dim > 0) {
+      dim--;
+      offset[dim] += chunk[dim];
+      if (offset[dim] < shape[dim]) break;
+      offset[dim] = 0;
+      if (dim == 0) return true;
+    }
+  }
+}
+
+}  // namespace QPT
@@ -0,0 +1,75 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5MERGE_H_
+#define QPT_HDF5_H5MERGE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "H5Group.h"
+
+namespace QPT {
+
+// Merges the group hierarchies of several sources into a destination group.
+// Groups are merged recursively, objects that only exist in a single source
+// are copied as a whole (H5Ocopy). Datasets that exist in several sources
+// are concatenated along the merge axis in the order of the sources; the
+// result has the type and creation properties of the first source. Datasets
+// that cannot be concatenated (rank not larger than the axis, e.g. scalars,
+// or other dimensions that differ) are copied from the first source.
+// Attributes of the first source that has them win.
+// Chunks of a concatenated dataset are copied raw (without decompressing
+// and recompressing) if the source has the chunk shape, type and filters of
+// the destination, its position along the axis is chunk aligned and the
+// type holds no variable length data or references.
+// Otherwise the data passes through memory in bounded pieces.
+class H5Merger {
+ public:
+  // path of a dataset relative to the merged groups (e.g. "sweep/results")
+  using Filter_t = std::function<bool(const std::string& path)>;
+
+  struct Statistics {
+    std::size_t concatenatedDatasets = 0;
+    std::size_t copiedObjects = 0;
+    std::size_t rawChunks = 0;
+    std::size_t convertedDatasets = 0;
+    // found in several sources but not concatenable (copied from the first
+    // source, included in copiedObjects)
+    std::size_t incompatibleDatasets = 0;
+  };
+
+  explicit H5Merger(std::size_t axis = 0) : m_axis(axis) {}
+
+  void SetAxis(std::size_t axis) { m_axis = axis; }
+  std::size_t GetAxis() const { return m_axis; }
+  // Datasets found in several sources are only concatenated if the filter
+  // accepts their path, otherwise the dataset of the first source is copied
+  // (e.g. for grid axes that are identical in all sources). By default all
+  // datasets are concatenated.
+  void SetConcatenationFilter(Filter_t filter) { m_filter = std::move(filter); }
+
+  bool Merge(std::vector<H5Group> sources, H5Group& dest);
+
+  // statistics of the last call to Merge
+  const Statistics& GetStatistics() const { return m_stats; }
+
+ private:
+  bool MergeGroups(std::vector<H5Group>& sources, H5Group& dest,
+                   const std::string& path);
+  bool Concatenate(std::vector<H5Dataset>& sources,
+                   const std::vector<std::size_t>& shape,
+                   const std::vector<std::size_t>& offsets, H5Group& dest,
+                   const std::string& name);
+  bool CopyChunks(H5Dataset& source, H5Dataset& dest, std::size_t shift);
+
+ private:
+  std::size_t m_axis;
+  Filter_t m_filter;
+  Statistics m_stats;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5MERGE_H_
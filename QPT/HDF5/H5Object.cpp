@@ -6,6 +6,39 @@
 
 namespace QPT {
 
+// Helpers
+herr_t CopyAttributeHelper(hid_t src, const char* name, const H5A_info_t*,
+                           void* data) {
+  const hid_t dest = *static_cast<hid_t*>(data);
+  if (H5Aexists(dest, name) > 0) return 0;
+
+  hid_t attr = H5Aopen(src, name, H5P_DEFAULT);
+  if (attr < 0) return -1;
+  auto attrGuard = CreateScopeGuard([=]() { H5Aclose(attr); });
+  hid_t type = H5Aget_type(attr);
+  if (type < 0) return -1;
+  auto typeGuard = CreateScopeGuard([=]() { H5Tclose(type); });
+  hid_t dspace = H5Aget_space(attr);
+  if (dspace < 0) return -1;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  // read and write with the stored type, i.e. without any conversion
+  const hssize_t points = H5Sget_simple_extent_npoints(dspace);
+  if (points < 0) return -1;
+  std::vector<std::uint8_t> buffer(points * H5Tget_size(type));
+  if (H5Aread(attr, type, buffer.data()) < 0) return -1;
+  const bool vlen = H5Tdetect_class(type, H5T_VLEN) > 0 ||
+                    H5Tis_variable_str(type) > 0;
+  auto vlenGuard = CreateScopeGuard([&]() {
+    if (vlen) H5Dvlen_reclaim(type, dspace, H5P_DEFAULT, buffer.data());
+  });
+
+  hid_t copy = H5Acreate2(dest, name, type, dspace, H5P_DEFAULT, H5P_DEFAULT);
+  if (copy < 0) return -1;
+  auto copyGuard = CreateScopeGuard([=]() { H5Aclose(copy); });
+  return (H5Awrite(copy, type, buffer.data()) >= 0) ? 0 : -1;
+}
+
 H5Object::H5Object(hid_t hid) : m_hid(hid) {}
 
 H5Object::~H5Object() {
@@ -32,10 +65,59 @@ H5Object& H5Object::operator=(H5Object&& rhs) {
 
 bool H5Object::IsValid() const { return m_hid >= 0; }
 
+bool H5Object::Flush() { return H5Fflush(m_hid, H5F_SCOPE_LOCAL) >= 0; }
+
 bool H5Object::HasAttribute(const std::string& name) {
   return (H5Aexists(m_hid, name.c_str()) > 0);
 }
 
+bool H5Object::SetStringAttribute(const std::string& name,
+                                  const H5StringTable& strings,
+                                  H5StringType type) {
+  // HDF5 does not allow empty attributes
+  if (strings.IsEmpty()) return false;
+  if (HasAttribute(name) && H5Adelete(m_hid, name.c_str()) < 0) return false;
+
+  const hsize_t dims = strings.GetCount();
+  hid_t dspace = H5Screate_simple(1, &dims, nullptr);
+  if (dspace < 0) return false;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  return strings.WriteH5(type, [&](hid_t stype, const void* data) {
+    hid_t attr = H5Acreate2(m_hid, name.c_str(), stype, dspace, H5P_DEFAULT,
+                            H5P_DEFAULT);
+    if (attr < 0) return false;
+    auto attrGuard = CreateScopeGuard([=]() { H5Aclose(attr); });
+    return H5Awrite(attr, stype, data) >= 0;
+  });
+}
+
+std::optional<H5StringTable> H5Object::GetStringAttribute(
+    const std::string& name) {
+  if (!HasAttribute(name)) return std::nullopt;
+  hid_t attr = H5Aopen(m_hid, name.c_str(), H5P_DEFAULT);
+  if (attr < 0) return std::nullopt;
+  auto attrGuard = CreateScopeGuard([=]() { H5Aclose(attr); });
+  hid_t type = H5Aget_type(attr);
+  if (type < 0) return std::nullopt;
+  auto typeGuard = CreateScopeGuard([=]() { H5Tclose(type); });
+  hid_t dspace = H5Aget_space(attr);
+  if (dspace < 0) return std::nullopt;
+  auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
+
+  const hssize_t count = H5Sget_simple_extent_npoints(dspace);
+  if (count < 0) return std::nullopt;
+  return H5StringTable::ReadH5(type, count, [&](hid_t mtype, void* data) {
+    return H5Aread(attr, mtype, data) >= 0;
+  });
+}
+
+bool H5Object::CopyAttributes(H5Object& dest) {
+  hid_t destHandle = dest.m_hid;
+  return H5Aiterate2(m_hid, H5_INDEX_NAME, H5_ITER_NATIVE, nullptr,
+                     &CopyAttributeHelper, &destHandle) >= 0;
+}
+
 std::optional<std::vector<std::size_t>> H5Object::GetAttributeShape(
     const std::string& name) {
   std::optional<std::vector<std::size_t>> res = std::nullopt;
@@ -58,10 +140,10 @@ std::optional<std::vector<std::size_t>> H5Object::GetAttributeShape(
   auto dspaceGuard = CreateScopeGuard([=]() { H5Sclose(dspace); });
 
   int ndims = H5Sget_simple_extent_ndims(dspace);
-  if (ndims <= 0) return std::nullopt;
+  if (ndims < 0) return std::nullopt;
 
   std::vector<hsize_t> dims(ndims);
-  if (H5Sget_simple_extent_dims(dspace, &dims[0], nullptr) < 0)
+  if (H5Sget_simple_extent_dims(dspace, dims.data(), nullptr) < 0)
     return std::nullopt;
 
   return std::make_optional(std::vector<std::size_t>(dims.begin(), dims.end()));
@@ -91,7 +173,11 @@ bool H5Object::SetAttributeRaw(const std::string& name, hid_t nType,
 
   if (HasAttribute(name)) {
     attr = H5Aopen(m_hid, name.c_str(), H5P_DEFAULT);
-    if (GetAttributeShape(attr) != shape) return false;
+    if (attr < 0) return false;
+    if (GetAttributeShape(attr) != shape) {
+      H5Aclose(attr);
+      return false;
+    }
   } else {
     // create dataspace
     std::vector<hsize_t> dims(shape.begin(), shape.end());
@@ -106,6 +192,7 @@ bool H5Object::SetAttributeRaw(const std::string& name, hid_t nType,
   }
 
   // write data
+  auto attrGuard = CreateScopeGuard([=]() { H5Aclose(attr); });
   return H5Awrite(attr, nType, data) >= 0;
 }
 
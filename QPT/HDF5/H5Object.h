@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "../Serialization.h"
+#include "H5StringTable.h"
 #include "H5Types.h"
 
 namespace QPT {
@@ -27,6 +28,8 @@ class H5Object {
   H5Object& operator=(H5Object&& rhs);
 
   bool IsValid() const;
+  // writes the buffered data of the file containing the object to disk
+  bool Flush();
 
   bool HasAttribute(const std::string& name);
   std::optional<std::vector<std::size_t>> GetAttributeShape(
@@ -44,6 +47,18 @@ class H5Object {
   template <typename T, typename = std::enable_if_t<H5TypeIsSerializable_v<T>>>
   bool SetAttribute(const std::string& name, const T& data);
 
+  // Lists of strings as HDF5 string types (one-dimensional, written at
+  // once). An existing attribute of the same name is replaced.
+  bool SetStringAttribute(const std::string& name,
+                          const H5StringTable& strings,
+                          H5StringType type = H5String_VARIABLE);
+  // all strings of a string attribute of any rank
+  std::optional<H5StringTable> GetStringAttribute(const std::string& name);
+
+  // Copies all attributes (with their stored types) that dest does not have
+  // yet
+  bool CopyAttributes(H5Object& dest);
+
  protected:
   hid_t GetHandle() const { return m_hid; }
 
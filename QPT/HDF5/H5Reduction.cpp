@@ -0,0 +1,294 @@
+// Philipp Neufeld, 2023
+
+#include "H5Reduction.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "H5BlockReader.h"
+
+namespace QPT {
+
+// Helpers
+std::size_t GetElementCount(std::vector<std::size_t>::const_iterator begin,
+                            std::vector<std::size_t>::const_iterator end) {
+  std::size_t count = 1;
+  for (auto it = begin; it != end; ++it) count *= *it;
+  return count;
+}
+
+//
+// Results
+//
+
+bool H5ReductionResult::Save(H5Group& group, const std::string& name) const {
+  if (values.size() != GetElementCount(shape.begin(), shape.end()))
+    return false;
+  if (shape.empty()) return group.CreateDataset(name, values[0]).has_value();
+
+  auto ds = group.CreateUninitializedDataset<double>(name, shape);
+  if (!ds) return false;
+  const std::vector<std::size_t> offset(shape.size(), 0);
+  return ds->SetSlabData(offset, shape, values.data());
+}
+
+bool H5Statistics::Save(H5Group& group, const std::string& name) const {
+  auto sub = group.OpenSubgroup(name);
+  return sub && sub->SetAttribute("count", std::uint64_t(count)) &&
+         mean.Save(*sub, "mean") && variance.Save(*sub, "variance") &&
+         min.Save(*sub, "min") && max.Save(*sub, "max");
+}
+
+bool H5Histogram::Save(H5Group& group, const std::string& name) const {
+  auto ds = group.CreateDataset(name, counts);
+  return ds && ds->SetAttribute("lower", lower) &&
+         ds->SetAttribute("upper", upper) &&
+         ds->SetAttribute("underflow", underflow) &&
+         ds->SetAttribute("overflow", overflow);
+}
+
+//
+// H5StreamReducer
+//
+
+H5StreamReducer::H5StreamReducer(ThreadPool& pool, std::size_t memoryLimit)
+    : m_pool(pool), m_memoryLimit(memoryLimit) {}
+
+void H5StreamReducer::Wait(std::future<void>& future) {
+  // help out instead of blocking (the caller may be a worker of the pool)
+  while (future.wait_for(std::chrono::seconds(0)) !=
+         std::future_status::ready) {
+    if (!m_pool.RunPendingTask()) std::this_thread::yield();
+  }
+  future.get();
+}
+
+bool H5StreamReducer::Stream(H5Dataset& dataset,
+                             const std::vector<std::size_t>& shape,
+                             const Process_t& process, const Merge_t& merge) {
+  const std::size_t rows = shape[0];
+  const std::size_t rowSize = GetElementCount(shape.begin() + 1, shape.end());
+  if (rows == 0 || rowSize == 0) return true;
+
+  // rows per block, a multiple of the chunk rows if possible (one block
+  // more than there are slots is read ahead)
+  const std::size_t slots = GetSlotCount();
+  const std::size_t rowBytes = rowSize * sizeof(double);
+  std::size_t blockRows =
+      std::max<std::size_t>(m_memoryLimit / (slots + 1) / rowBytes, 1);
+  const auto chunk = dataset.GetChunkShape();
+  if (!chunk.empty() && chunk[0] > 0 && blockRows >= chunk[0])
+    blockRows -= blockRows % chunk[0];
+
+  // block k uses the slot k % slots, which is merged before it is reused
+  H5BlockReader<double> reader(dataset, blockRows, slots + 1);
+  std::vector<std::future<void>> pending(slots);
+  std::size_t block = 0;
+  while (auto next = reader.Next()) {
+    const std::size_t slot = block++ % slots;
+    if (pending[slot].valid()) {
+      Wait(pending[slot]);
+      merge(slot);
+    }
+    pending[slot] =
+        m_pool.Submit([&process, slot, view = std::move(*next)]() mutable {
+          // returns the buffer to the reader as soon as possible
+          const auto block = std::move(view);
+          process(slot, block.GetRowOffset(), block.GetRowCount(),
+                  block.GetData());
+        });
+  }
+  const bool success = !reader.HasFailed();
+
+  // remaining blocks (oldest first)
+  for (std::size_t i = 0; i < slots; i++) {
+    const std::size_t slot = (block + i) % slots;
+    if (!pending[slot].valid()) continue;
+    Wait(pending[slot]);
+    if (success) merge(slot);
+  }
+  return success;
+}
+
+std::optional<H5Statistics> H5StreamReducer::ComputeStatistics(
+    H5Dataset& dataset) {
+  const auto shape = dataset.GetShape();
+  if (shape.empty() || shape[0] == 0) return std::nullopt;
+  const std::vector<std::size_t> rowShape(shape.begin() + 1, shape.end());
+  const std::size_t rowSize = GetElementCount(rowShape.begin(), rowShape.end());
+
+  // mean and sum of squared deviations of every block, combined with the
+  // pairwise update of Chan et al.
+  struct Partial {
+    std::size_t count = 0;
+    std::vector<double> mean, m2, min, max;
+  };
+  std::vector<Partial> partials(GetSlotCount());
+  Partial total;
+
+  auto process = [&](std::size_t slot, std::size_t, std::size_t rows,
+                     const double* data) {
+    auto& p = partials[slot];
+    p.count = rows;
+    p.mean.assign(data, data + rowSize);
+    p.min.assign(data, data + rowSize);
+    p.max.assign(data, data + rowSize);
+    for (std::size_t r = 1; r < rows; r++) {
+      const double* x = data + r * rowSize;
+      for (std::size_t j = 0; j < rowSize; j++) {
+        p.mean[j] += x[j];
+        p.min[j] = (x[j] < p.min[j]) ? x[j] : p.min[j];
+        p.max[j] = (x[j] > p.max[j]) ? x[j] : p.max[j];
+      }
+    }
+    for (std::size_t j = 0; j < rowSize; j++) p.mean[j] /= rows;
+
+    p.m2.assign(rowSize, 0.0);
+    for (std::size_t r = 0; r < rows; r++) {
+      const double* x = data + r * rowSize;
+      for (std::size_t j = 0; j < rowSize; j++) {
+        const double d = x[j] - p.mean[j];
+        p.m2[j] += d * d;
+      }
+    }
+  };
+
+  auto merge = [&](std::size_t slot) {
+    auto& p = partials[slot];
+    if (total.count == 0) {
+      std::swap(total, p);
+      return;
+    }
+    const double na = total.count, nb = p.count, n = na + nb;
+    for (std::size_t j = 0; j < rowSize; j++) {
+      const double delta = p.mean[j] - total.mean[j];
+      total.mean[j] += delta * (nb / n);
+      total.m2[j] += p.m2[j] + delta * delta * (na * nb / n);
+      total.min[j] = (p.min[j] < total.min[j]) ? p.min[j] : total.min[j];
+      total.max[j] = (p.max[j] > total.max[j]) ? p.max[j] : total.max[j];
+    }
+    total.count += p.count;
+  };
+
+  if (!Stream(dataset, shape, process, merge)) return std::nullopt;
+
+  // empty rows are never processed
+  total.mean.resize(rowSize);
+  total.m2.resize(rowSize);
+  total.min.resize(rowSize);
+  total.max.resize(rowSize);
+  const double norm = (total.count > 1) ? 1.0 / (total.count - 1) : 0.0;
+  for (auto& m2 : total.m2) m2 *= norm;
+
+  H5Statistics stats;
+  stats.count = total.count;
+  stats.mean = {rowShape, std::move(total.mean)};
+  stats.variance = {rowShape, std::move(total.m2)};
+  stats.min = {rowShape, std::move(total.min)};
+  stats.max = {rowShape, std::move(total.max)};
+  return stats;
+}
+
+std::optional<H5Histogram> H5StreamReducer::ComputeHistogram(
+    H5Dataset& dataset, double lower, double upper, std::size_t bins) {
+  const auto shape = dataset.GetShape();
+  if (shape.empty() || bins == 0 || !(upper > lower)) return std::nullopt;
+  const std::size_t rowSize = GetElementCount(shape.begin() + 1, shape.end());
+
+  H5Histogram hist;
+  hist.lower = lower;
+  hist.upper = upper;
+  hist.counts.assign(bins, 0);
+  std::vector<H5Histogram> partials(GetSlotCount());
+  const double scale = bins / (upper - lower);
+
+  auto process = [&](std::size_t slot, std::size_t, std::size_t rows,
+                     const double* data) {
+    auto& p = partials[slot];
+    p.counts.assign(bins, 0);
+    p.underflow = p.overflow = 0;
+    for (std::size_t i = 0; i < rows * rowSize; i++) {
+      const double x = data[i];
+      if (x < lower) {
+        p.underflow++;
+      } else if (x >= upper) {
+        p.overflow++;
+      } else if (x == x) {
+        // rounding may push values just below upper into the next bin
+        const auto bin = static_cast<std::size_t>((x - lower) * scale);
+        p.counts[std::min(bin, bins - 1)]++;
+      }
+    }
+  };
+
+  auto merge = [&](std::size_t slot) {
+    const auto& p = partials[slot];
+    for (std::size_t b = 0; b < bins; b++) hist.counts[b] += p.counts[b];
+    hist.underflow += p.underflow;
+    hist.overflow += p.overflow;
+  };
+
+  if (!Stream(dataset, shape, process, merge)) return std::nullopt;
+  return hist;
+}
+
+std::optional<H5ReductionResult> H5StreamReducer::ComputeWeightedSum(
+    H5Dataset& dataset, std::size_t axis, const std::vector<double>& weights) {
+  const auto shape = dataset.GetShape();
+  if (axis >= shape.size() || weights.size() != shape[axis])
+    return std::nullopt;
+
+  H5ReductionResult result;
+  result.shape = shape;
+  result.shape.erase(result.shape.begin() + axis);
+  result.values.assign(
+      GetElementCount(result.shape.begin(), result.shape.end()), 0.0);
+  const std::size_t rowSize = GetElementCount(shape.begin() + 1, shape.end());
+
+  if (axis == 0) {
+    // every block contributes to all elements of the result
+    std::vector<std::vector<double>> partials(GetSlotCount());
+    auto process = [&](std::size_t slot, std::size_t rowOffset,
+                       std::size_t rows, const double* data) {
+      auto& p = partials[slot];
+      p.assign(rowSize, 0.0);
+      for (std::size_t r = 0; r < rows; r++) {
+        const double w = weights[rowOffset + r];
+        const double* x = data + r * rowSize;
+        for (std::size_t j = 0; j < rowSize; j++) p[j] += w * x[j];
+      }
+    };
+    auto merge = [&](std::size_t slot) {
+      const auto& p = partials[slot];
+      for (std::size_t j = 0; j < rowSize; j++) result.values[j] += p[j];
+    };
+    if (!Stream(dataset, shape, process, merge)) return std::nullopt;
+    return result;
+  }
+
+  // every row of the dataset yields outer x inner elements of the result
+  const std::size_t outer =
+      GetElementCount(shape.begin() + 1, shape.begin() + axis);
+  const std::size_t length = shape[axis];
+  const std::size_t inner =
+      GetElementCount(shape.begin() + axis + 1, shape.end());
+  auto process = [&](std::size_t, std::size_t rowOffset, std::size_t rows,
+                     const double* data) {
+    for (std::size_t r = 0; r < rows; r++) {
+      for (std::size_t o = 0; o < outer; o++) {
+        double* y = &result.values[((rowOffset + r) * outer + o) * inner];
+        const double* x = data + (r * outer + o) * length * inner;
+        for (std::size_t i = 0; i < length; i++) {
+          const double w = weights[i];
+          for (std::size_t k = 0; k < inner; k++) y[k] += w * x[i * inner + k];
+        }
+      }
+    }
+  };
+  if (!Stream(dataset, shape, process, [](std::size_t) {}))
+    return std::nullopt;
+  return result;
+}
+
+}  // namespace QPT
@@ -0,0 +1,103 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5REDUCTION_H_
+#define QPT_HDF5_H5REDUCTION_H_
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../Parallel/ThreadPool.h"
+#include "H5Dataset.h"
+#include "H5Group.h"
+
+namespace QPT {
+
+// Array of doubles in row-major order
+struct H5ReductionResult {
+  std::vector<std::size_t> shape;
+  std::vector<double> values;
+
+  // creates the dataset name (a scalar dataset if the shape is empty)
+  bool Save(H5Group& group, const std::string& name) const;
+};
+
+// Element-wise statistics along the first dimension of a dataset (e.g. the
+// trajectory index). The results have the shape of a single row.
+struct H5Statistics {
+  std::size_t count = 0;
+  H5ReductionResult mean;
+  // sample variance (normalized by count - 1, zero for a single row)
+  H5ReductionResult variance;
+  H5ReductionResult min;
+  H5ReductionResult max;
+
+  // creates the subgroup name with the datasets "mean", "variance", "min"
+  // and "max" and the attribute "count"
+  bool Save(H5Group& group, const std::string& name) const;
+};
+
+// Histogram of all values of a dataset with uniform bins on [lower, upper).
+// NaN values are not counted.
+struct H5Histogram {
+  double lower = 0.0;
+  double upper = 1.0;
+  std::vector<std::uint64_t> counts;
+  std::uint64_t underflow = 0;
+  std::uint64_t overflow = 0;
+
+  // creates the dataset name with the counts and the attributes "lower",
+  // "upper", "underflow" and "overflow"
+  bool Save(H5Group& group, const std::string& name) const;
+};
+
+// Reductions over datasets that are too large to be loaded at once. The
+// dataset is read in blocks of whole rows (slices along the first dimension,
+// aligned to the chunks of chunked datasets) by a H5BlockReader while the
+// blocks read before are reduced on the thread pool. At most
+// GetThreadCount() + 2 blocks are in memory, the memory limit is split
+// evenly between them (a block holds at least one row). The partial results
+// of the blocks are combined in the order of the blocks, i.e. the results
+// are reproducible (they depend on the block size only via rounding).
+// All values are converted to double when they are read.
+class H5StreamReducer {
+ public:
+  explicit H5StreamReducer(ThreadPool& pool,
+                           std::size_t memoryLimit = 256 << 20);
+
+  void SetMemoryLimit(std::size_t bytes) { m_memoryLimit = bytes; }
+  std::size_t GetMemoryLimit() const { return m_memoryLimit; }
+
+  // mean, variance, min and max along the first dimension
+  std::optional<H5Statistics> ComputeStatistics(H5Dataset& dataset);
+  std::optional<H5Histogram> ComputeHistogram(H5Dataset& dataset,
+                                              double lower, double upper,
+                                              std::size_t bins);
+  // sum_i weights[i] x[..., i, ...] along the given axis. The result has the
+  // shape of the dataset without that axis and is kept in memory.
+  std::optional<H5ReductionResult> ComputeWeightedSum(
+      H5Dataset& dataset, std::size_t axis,
+      const std::vector<double>& weights);
+
+ private:
+  // reduces the rows [rowOffset, rowOffset + rows) into the slot
+  using Process_t = std::function<void(std::size_t slot, std::size_t rowOffset,
+                                       std::size_t rows, const double* data)>;
+  // combines the partial result of the slot with the total
+  using Merge_t = std::function<void(std::size_t slot)>;
+
+  std::size_t GetSlotCount() const { return m_pool.GetThreadCount() + 1; }
+  bool Stream(H5Dataset& dataset, const std::vector<std::size_t>& shape,
+              const Process_t& process, const Merge_t& merge);
+  void Wait(std::future<void>& future);
+
+ private:
+  ThreadPool& m_pool;
+  std::size_t m_memoryLimit;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5REDUCTION_H_
@@ -0,0 +1,170 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5SPARSEMATRIX_H_
+#define QPT_HDF5_H5SPARSEMATRIX_H_
+
+#include <Eigen/SparseCore>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "H5Group.h"
+
+namespace QPT {
+
+// Compressed sparse matrices stored as a group with the datasets "data"
+// (non-zero values), "indices" (inner indices) and "indptr" (outer index
+// pointers, outer size + 1 entries) and the attributes "format" ("csr" for
+// row-major, "csc" for column-major matrices) and "shape" (rows, columns),
+// the layout used by scipy (h5sparse, anndata).
+// Write passes Eigen's compressed buffers to HDF5 directly (uncompressed
+// matrices are compressed in a copy first). Read resizes the matrix and
+// reads straight into its buffers; a matrix stored in the other storage
+// order is transposed in memory, unsorted or duplicate inner indices (allowed
+// by scipy) are sorted and summed.
+class H5SparseMatrix {
+ public:
+  template <typename Scalar, int Options, typename Index>
+  static bool Write(H5Group& group, const std::string& name,
+                    const Eigen::SparseMatrix<Scalar, Options, Index>& mat);
+
+  template <typename Matrix_t>
+  static std::optional<Matrix_t> Read(H5Group& group, const std::string& name);
+
+ private:
+  // reads into mat (a sparse matrix in the stored storage order)
+  template <typename Matrix_t>
+  static bool ReadAs(H5Group& group, const std::array<std::uint64_t, 2>& shape,
+                     Matrix_t& mat);
+
+  template <typename T>
+  static bool WriteArray(H5Group& group, const std::string& name,
+                         const T* data, std::size_t size);
+  template <typename T>
+  static bool ReadArray(H5Group& group, const std::string& name, T* data,
+                        std::size_t size);
+};
+
+// Template function definitions
+template <typename T>
+bool H5SparseMatrix::WriteArray(H5Group& group, const std::string& name,
+                                const T* data, std::size_t size) {
+  auto ds = group.CreateUninitializedDataset<T>(name, {size});
+  return ds && (size == 0 || ds->SetSlabData({0}, {size}, data));
+}
+
+template <typename T>
+bool H5SparseMatrix::ReadArray(H5Group& group, const std::string& name,
+                               T* data, std::size_t size) {
+  auto ds = group.OpenExistingDataset(name);
+  if (!ds || ds->GetShape() != std::vector<std::size_t>{size}) return false;
+  return size == 0 || ds->GetSlabData({0}, {size}, data);
+}
+
+template <typename Scalar, int Options, typename Index>
+bool H5SparseMatrix::Write(
+    H5Group& group, const std::string& name,
+    const Eigen::SparseMatrix<Scalar, Options, Index>& mat) {
+  using Matrix_t = Eigen::SparseMatrix<Scalar, Options, Index>;
+  if (!mat.isCompressed()) {
+    Matrix_t compressed = mat;
+    compressed.makeCompressed();
+    return Write(group, name, compressed);
+  }
+  if (group.HasSubgroup(name) || group.HasDataset(name)) return false;
+  auto sub = group.OpenSubgroup(name);
+  if (!sub) return false;
+
+  const std::size_t nnz = mat.nonZeros();
+  const std::array<std::uint64_t, 2> shape = {std::uint64_t(mat.rows()),
+                                              std::uint64_t(mat.cols())};
+  const char* format = Matrix_t::IsRowMajor ? "csr" : "csc";
+  return sub->SetStringAttribute("format", H5StringTable({format}),
+                                 H5String_FIXED) &&
+         sub->SetAttribute("shape", shape) &&
+         WriteArray(*sub, "data", mat.valuePtr(), nnz) &&
+         WriteArray(*sub, "indices", mat.innerIndexPtr(), nnz) &&
+         WriteArray(*sub, "indptr", mat.outerIndexPtr(), mat.outerSize() + 1);
+}
+
+template <typename Matrix_t>
+bool H5SparseMatrix::ReadAs(H5Group& group,
+                            const std::array<std::uint64_t, 2>& shape,
+                            Matrix_t& mat) {
+  using Scalar = typename Matrix_t::Scalar;
+  using Index = typename Matrix_t::StorageIndex;
+  auto data = group.OpenExistingDataset("data");
+  if (!data || data->GetShape().size() != 1) return false;
+  const std::size_t nnz = data->GetShape()[0];
+
+  mat.resize(shape[0], shape[1]);
+  mat.resizeNonZeros(nnz);
+  if (!ReadArray(group, "data", mat.valuePtr(), nnz) ||
+      !ReadArray(group, "indices", mat.innerIndexPtr(), nnz) ||
+      !ReadArray(group, "indptr", mat.outerIndexPtr(), mat.outerSize() + 1))
+    return false;
+
+  // Eigen relies on valid, sorted and unique inner indices
+  const Index* outer = mat.outerIndexPtr();
+  const Index* inner = mat.innerIndexPtr();
+  if (outer[0] != 0 || outer[mat.outerSize()] != Index(nnz)) return false;
+  bool sorted = true;
+  for (Index j = 0; j < mat.outerSize(); j++) {
+    if (outer[j + 1] < outer[j]) return false;
+    for (Index k = outer[j]; k < outer[j + 1]; k++) {
+      if (inner[k] < 0 || inner[k] >= mat.innerSize()) return false;
+      if (k > outer[j] && inner[k] <= inner[k - 1]) sorted = false;
+    }
+  }
+  if (sorted) return true;
+
+  std::vector<Eigen::Triplet<Scalar, Index>> triplets;
+  triplets.reserve(nnz);
+  for (Index j = 0; j < mat.outerSize(); j++) {
+    for (typename Matrix_t::InnerIterator it(mat, j); it; ++it)
+      triplets.emplace_back(it.row(), it.col(), it.value());
+  }
+  Matrix_t unique(shape[0], shape[1]);
+  unique.setFromTriplets(triplets.begin(), triplets.end());
+  mat.swap(unique);
+  return true;
+}
+
+template <typename Matrix_t>
+std::optional<Matrix_t> H5SparseMatrix::Read(H5Group& group,
+                                             const std::string& name) {
+  using Scalar = typename Matrix_t::Scalar;
+  using Index = typename Matrix_t::StorageIndex;
+  // Eigen 3.4 sparse matrices have no move constructor: every path returns
+  // result such that it is constructed in place
+  std::optional<Matrix_t> result;
+  if (!group.HasSubgroup(name)) return result;
+  auto sub = group.OpenSubgroup(name);
+  if (!sub) return result;
+  auto format = sub->GetStringAttribute("format");
+  auto shape = sub->GetAttribute<std::array<std::uint64_t, 2>>("shape");
+  if (!format || format->GetCount() != 1 || !shape) return result;
+  if ((*format)[0] != "csr" && (*format)[0] != "csc") return result;
+
+  const bool rowMajor = (*format)[0] == "csr";
+  bool success;
+  result.emplace();
+  if (rowMajor == bool(Matrix_t::IsRowMajor)) {
+    success = ReadAs(*sub, *shape, *result);
+  } else {
+    constexpr int Options = Matrix_t::IsRowMajor ? Eigen::ColMajor
+                                                 : Eigen::RowMajor;
+    Eigen::SparseMatrix<Scalar, Options, Index> stored;
+    success = ReadAs(*sub, *shape, stored);
+    if (success) *result = stored;
+  }
+  if (!success) result.reset();
+  return result;
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5SPARSEMATRIX_H_
@@ -0,0 +1,121 @@
+// Philipp Neufeld, 2023
+
+#include "H5StringTable.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../ScopeGuard.h"
+
+namespace QPT {
+
+H5StringTable::H5StringTable(const std::vector<std::string>& strings)
+    : H5StringTable() {
+  std::size_t chars = 0;
+  for (const auto& str : strings) chars += str.size() + 1;
+  Reserve(strings.size(), chars);
+  for (const auto& str : strings) Add(str);
+}
+
+void H5StringTable::Reserve(std::size_t count, std::size_t chars) {
+  m_offsets.reserve(count + 1);
+  m_chars.reserve(chars);
+}
+
+void H5StringTable::Add(std::string_view str) {
+  m_chars.append(str.data(), str.size());
+  m_chars.push_back('\0');
+  m_offsets.push_back(m_chars.size());
+}
+
+void H5StringTable::Clear() {
+  m_chars.clear();
+  m_offsets.assign(1, 0);
+}
+
+std::size_t H5StringTable::GetMaxLength() const {
+  std::size_t length = 0;
+  for (std::size_t i = 0; i < GetCount(); i++)
+    length = std::max(length, m_offsets[i + 1] - m_offsets[i] - 1);
+  return length;
+}
+
+std::vector<std::string_view> H5StringTable::GetViews() const {
+  std::vector<std::string_view> views(GetCount());
+  for (std::size_t i = 0; i < views.size(); i++) views[i] = (*this)[i];
+  return views;
+}
+
+std::vector<std::string> H5StringTable::ToVector() const {
+  std::vector<std::string> strings(GetCount());
+  for (std::size_t i = 0; i < strings.size(); i++)
+    strings[i] = std::string((*this)[i]);
+  return strings;
+}
+
+bool H5StringTable::WriteH5(H5StringType type, const Write_t& write) const {
+  hid_t stype = H5Tcopy(H5T_C_S1);
+  if (stype < 0) return false;
+  auto stypeGuard = CreateScopeGuard([=]() { H5Tclose(stype); });
+  if (H5Tset_cset(stype, H5T_CSET_UTF8) < 0) return false;
+
+  if (type == H5String_VARIABLE) {
+    // pointers into the packed buffer
+    if (H5Tset_size(stype, H5T_VARIABLE) < 0) return false;
+    std::vector<const char*> ptrs(GetCount());
+    for (std::size_t i = 0; i < ptrs.size(); i++) ptrs[i] = GetCString(i);
+    return write(stype, ptrs.data());
+  }
+
+  // padded copy (HDF5 does not allow strings of size zero)
+  const std::size_t width = std::max<std::size_t>(GetMaxLength(), 1);
+  if (H5Tset_size(stype, width) < 0 ||
+      H5Tset_strpad(stype, H5T_STR_NULLPAD) < 0)
+    return false;
+  std::string padded(GetCount() * width, '\0');
+  for (std::size_t i = 0; i < GetCount(); i++) {
+    const auto str = (*this)[i];
+    std::copy(str.begin(), str.end(), padded.begin() + i * width);
+  }
+  return write(stype, padded.data());
+}
+
+std::optional<H5StringTable> H5StringTable::ReadH5(hid_t fileType,
+                                                   std::size_t count,
+                                                   const Read_t& read) {
+  if (H5Tget_class(fileType) != H5T_STRING) return std::nullopt;
+  hid_t mtype = H5Tcopy(fileType);
+  if (mtype < 0) return std::nullopt;
+  auto mtypeGuard = CreateScopeGuard([=]() { H5Tclose(mtype); });
+
+  H5StringTable table;
+  if (H5Tis_variable_str(fileType) > 0) {
+    std::vector<char*> ptrs(count, nullptr);
+    if (!read(mtype, ptrs.data())) return std::nullopt;
+    std::size_t chars = 0;
+    for (auto ptr : ptrs) chars += (ptr ? std::strlen(ptr) : 0) + 1;
+    table.Reserve(count, chars);
+    for (auto ptr : ptrs) {
+      table.Add(ptr ? std::string_view(ptr) : std::string_view());
+      H5free_memory(ptr);
+    }
+    return table;
+  }
+
+  // fixed length: strings end at the first zero or fill the whole width
+  const std::size_t width = H5Tget_size(fileType);
+  if (width == 0) return std::nullopt;
+  std::string padded(count * width, '\0');
+  if (!read(mtype, padded.data())) return std::nullopt;
+  const bool spacePad = (H5Tget_strpad(fileType) == H5T_STR_SPACEPAD);
+  table.Reserve(count, count * (width + 1));
+  for (std::size_t i = 0; i < count; i++) {
+    const char* str = padded.data() + i * width;
+    std::size_t length = std::find(str, str + width, '\0') - str;
+    while (spacePad && length > 0 && str[length - 1] == ' ') length--;
+    table.Add(std::string_view(str, length));
+  }
+  return table;
+}
+
+}  // namespace QPT
@@ -0,0 +1,75 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_HDF5_H5STRINGTABLE_H_
+#define QPT_HDF5_H5STRINGTABLE_H_
+
+#include <hdf5.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace QPT {
+
+enum H5StringType {
+  // one heap object per string (no padding, any length)
+  H5String_VARIABLE = 0,
+  // every string is padded to the length of the longest one (fast access,
+  // compresses well for labels of similar length)
+  H5String_FIXED = 1,
+};
+
+// List of strings packed into a single buffer, e.g. the labels of the axis of
+// a dataset. Every string is followed by a terminating zero, i.e. the buffer
+// can be handed to HDF5 without copying the strings. Reading returns views
+// into the buffer. Strings must not contain zero characters (HDF5 strings
+// end at the first zero).
+class H5StringTable {
+ public:
+  H5StringTable() : m_offsets{0} {}
+  H5StringTable(const std::vector<std::string>& strings);
+
+  void Reserve(std::size_t count, std::size_t chars);
+  void Add(std::string_view str);
+  void Clear();
+
+  std::size_t GetCount() const { return m_offsets.size() - 1; }
+  bool IsEmpty() const { return GetCount() == 0; }
+  std::string_view operator[](std::size_t i) const {
+    return std::string_view(m_chars.data() + m_offsets[i],
+                            m_offsets[i + 1] - m_offsets[i] - 1);
+  }
+  // zero terminated string i
+  const char* GetCString(std::size_t i) const {
+    return m_chars.data() + m_offsets[i];
+  }
+  std::size_t GetMaxLength() const;
+
+  std::vector<std::string_view> GetViews() const;
+  std::vector<std::string> ToVector() const;
+
+  // packed strings including the terminating zeros
+  const std::string& GetBuffer() const { return m_chars; }
+
+  // Used by H5Object and H5Dataset: write is called once with the string
+  // type (memory and file type) and the buffer of all strings. read is
+  // called once with the memory type matching fileType and a buffer for
+  // count strings.
+  using Write_t = std::function<bool(hid_t type, const void* data)>;
+  using Read_t = std::function<bool(hid_t type, void* data)>;
+  bool WriteH5(H5StringType type, const Write_t& write) const;
+  static std::optional<H5StringTable> ReadH5(hid_t fileType,
+                                             std::size_t count,
+                                             const Read_t& read);
+
+ private:
+  std::string m_chars;
+  // start of every string and the end of the buffer
+  std::vector<std::size_t> m_offsets;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_HDF5_H5STRINGTABLE_H_
@@ -5,6 +5,7 @@
 
 #include <hdf5.h>
 
+#include <complex>
 #include <cstdint>
 #include <type_traits>
 
@@ -103,6 +104,46 @@ class H5TypeTraits<char> {
   static hid_t GetNativeType() { return H5T_NATIVE_CHAR; }
 };
 
+// Complex numbers are stored as compound types with the members "r" and "i"
+// (the convention of h5py). The types are created once and kept open.
+inline hid_t H5CreateComplexType(hid_t component) {
+  const std::size_t size = H5Tget_size(component);
+  hid_t type = H5Tcreate(H5T_COMPOUND, 2 * size);
+  if (type < 0) return H5I_INVALID_HID;
+  if (H5Tinsert(type, "r", 0, component) < 0 ||
+      H5Tinsert(type, "i", size, component) < 0) {
+    H5Tclose(type);
+    return H5I_INVALID_HID;
+  }
+  return type;
+}
+
+template <>
+class H5TypeTraits<std::complex<float>> {
+ public:
+  static hid_t GetStorageType() {
+    static const hid_t type = H5CreateComplexType(H5T_IEEE_F32LE);
+    return type;
+  }
+  static hid_t GetNativeType() {
+    static const hid_t type = H5CreateComplexType(H5T_NATIVE_FLOAT);
+    return type;
+  }
+};
+
+template <>
+class H5TypeTraits<std::complex<double>> {
+ public:
+  static hid_t GetStorageType() {
+    static const hid_t type = H5CreateComplexType(H5T_IEEE_F64LE);
+    return type;
+  }
+  static hid_t GetNativeType() {
+    static const hid_t type = H5CreateComplexType(H5T_NATIVE_DOUBLE);
+    return type;
+  }
+};
+
 }  // namespace QPT
 
 #endif  // !QPT_HDF5_H5TYPES_H_
\ No newline at end of file
@@ -0,0 +1,242 @@
+// Philipp Neufeld, 2023
+
+#include "LanczosEigensolver.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+namespace {
+
+// counter based generator: element i does not depend on the thread that
+// computes it
+double UniformRandom(std::uint64_t seed, std::uint64_t i) {
+  // splitmix64
+  std::uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ull;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  z = z ^ (z >> 31);
+  return (z >> 11) * 0x1.0p-53;
+}
+
+}  // namespace
+
+void LanczosEigensolver::StartVector(ThreadPool& pool, Eigen::VectorXd& v) {
+  pool.ParallelForBlocks(0, v.size(), m_blockSize,
+                         [&](std::size_t b, std::size_t e) {
+                           for (std::size_t i = b; i < e; i++)
+                             v[i] = UniformRandom(m_seed, i) - 0.5;
+                         });
+  Scale(pool, v, 1 / std::sqrt(Dot(pool, v, v)));
+}
+
+double LanczosEigensolver::Dot(ThreadPool& pool,
+                               const Eigen::Ref<const Eigen::VectorXd>& a,
+                               const Eigen::Ref<const Eigen::VectorXd>& b) {
+  const std::size_t size = a.size();
+  m_partialSums.assign((size + m_blockSize - 1) / m_blockSize, 0.0);
+  pool.ParallelForBlocks(
+      0, size, m_blockSize, [&](std::size_t begin, std::size_t end) {
+        const std::size_t len = end - begin;
+        m_partialSums[begin / m_blockSize] =
+            a.segment(begin, len).dot(b.segment(begin, len));
+      });
+  double sum = 0;
+  for (double partial : m_partialSums) sum += partial;
+  return sum;
+}
+
+void LanczosEigensolver::Scale(ThreadPool& pool, Eigen::VectorXd& v,
+                               double factor) const {
+  pool.ParallelForBlocks(0, v.size(), m_blockSize,
+                         [&](std::size_t b, std::size_t e) {
+                           v.segment(b, e - b) *= factor;
+                         });
+}
+
+void LanczosEigensolver::Orthogonalize(ThreadPool& pool, Eigen::VectorXd& w,
+                                       const Eigen::VectorXd& v, double alpha,
+                                       const Eigen::VectorXd& u,
+                                       double beta) const {
+  pool.ParallelForBlocks(0, w.size(), m_blockSize,
+                         [&](std::size_t b, std::size_t e) {
+                           w.segment(b, e - b) -=
+                               alpha * v.segment(b, e - b) +
+                               beta * u.segment(b, e - b);
+                         });
+}
+
+std::vector<Eigen::Index> LanczosEigensolver::SelectRitzValues(
+    std::size_t m, std::size_t count) {
+  const Eigen::Map<const Eigen::VectorXd> alpha(m_alpha.data(), m);
+  const Eigen::Map<const Eigen::VectorXd> beta(m_beta.data(), m - 1);
+  m_ritz.computeFromTridiagonal(alpha, beta, Eigen::ComputeEigenvectors);
+  const auto& theta = m_ritz.eigenvalues();
+  const auto& s = m_ritz.eigenvectors();
+
+  // Lanczos matrix without the first row and column (Cullum-Willoughby)
+  Eigen::VectorXd reduced;
+  if (m > 1) {
+    m_reduced.computeFromTridiagonal(alpha.tail(m - 1), beta.tail(m - 2),
+                                     Eigen::EigenvaluesOnly);
+    reduced = m_reduced.eigenvalues();
+  }
+
+  const double scale =
+      std::max({1.0, std::abs(theta[0]), std::abs(theta[m - 1])});
+  const double tol = std::max(m_tol, 1e-12) * scale;
+  std::vector<Eigen::Index> selected;
+  for (Eigen::Index i = 0; i < theta.size() && selected.size() < count;) {
+    // cluster of numerically equal Ritz values
+    Eigen::Index end = i + 1;
+    while (end < theta.size() && theta[end] - theta[end - 1] <= tol) end++;
+
+    if (end - i > 1) {
+      // multiple copies are genuine: keep the best representative
+      Eigen::Index best = i;
+      for (Eigen::Index k = i + 1; k < end; k++) {
+        if (std::abs(s(0, k)) > std::abs(s(0, best))) best = k;
+      }
+      selected.push_back(best);
+    } else {
+      // a simple Ritz value that is also an eigenvalue of the reduced
+      // matrix is spurious (its first component vanishes)
+      bool spurious = false;
+      for (Eigen::Index k = 0; k < reduced.size() && !spurious; k++)
+        spurious = std::abs(reduced[k] - theta[i]) <= 1e-12 * scale;
+      if (!spurious) selected.push_back(i);
+    }
+    i = end;
+  }
+  return selected;
+}
+
+bool LanczosEigensolver::Compute(ThreadPool& pool, std::size_t dim,
+                                 const Operator_t& op, std::size_t count) {
+  QPT_PROFILE_SCOPE("LanczosEigensolver::Compute");
+  m_iterations = 0;
+  m_eigenvalues.resize(0);
+  m_eigenvectors.resize(0, 0);
+  if (dim == 0 || count == 0) return false;
+  count = std::min(count, dim);
+
+  // first pass: Lanczos matrix only
+  m_alpha.clear();
+  m_beta.clear();
+  Eigen::VectorXd u = Eigen::VectorXd::Zero(dim), v(dim), w(dim);
+  StartVector(pool, v);
+  std::vector<Eigen::Index> selected;
+  bool converged = false;
+  double scale = 0;
+  for (std::size_t j = 0; j < m_maxIter && !converged; j++) {
+    if (!op(v, w)) return false;
+    const double betaPrev = (j > 0) ? m_beta[j - 1] : 0;
+    const double alpha = Dot(pool, v, w);
+    Orthogonalize(pool, w, v, alpha, u, betaPrev);
+    const double beta = std::sqrt(Dot(pool, w, w));
+    m_alpha.push_back(alpha);
+    m_beta.push_back(beta);
+    m_iterations = j + 1;
+
+    // the Krylov space is exhausted if beta vanishes: the eigenpairs of the
+    // invariant subspace are returned, possibly fewer than count
+    scale = std::max(scale, std::abs(alpha) + beta + betaPrev);
+    const bool invariant = beta <= 1e-14 * scale;
+    const std::size_t m = j + 1;
+    if (invariant || (m >= count && (m % 10 == 0 || m == m_maxIter))) {
+      selected = SelectRitzValues(m, count);
+      const auto& theta = m_ritz.eigenvalues();
+      const auto& s = m_ritz.eigenvectors();
+      converged = invariant || selected.size() == count;
+      for (std::size_t k = 0; k < selected.size() && converged; k++) {
+        const auto idx = selected[k];
+        converged = beta * std::abs(s(m - 1, idx)) <=
+                    m_tol * std::max(1.0, std::abs(theta[idx]));
+      }
+    }
+    if (!converged) {
+      std::swap(u, v);
+      v = w;
+      Scale(pool, v, 1 / beta);
+    }
+  }
+  if (!converged || selected.empty()) return false;
+
+  // second pass: the same recurrence accumulates the Ritz vectors
+  const std::size_t m = m_iterations;
+  const std::size_t n = selected.size();
+  Eigen::MatrixXd coeffs(m, n);
+  m_eigenvalues.resize(n);
+  for (std::size_t k = 0; k < n; k++) {
+    coeffs.col(k) = m_ritz.eigenvectors().col(selected[k]);
+    m_eigenvalues[k] = m_ritz.eigenvalues()[selected[k]];
+  }
+
+  m_eigenvectors.setZero(dim, n);
+  u.setZero();
+  StartVector(pool, v);
+  for (std::size_t j = 0; j < m; j++) {
+    pool.ParallelForBlocks(0, dim, m_blockSize,
+                           [&](std::size_t b, std::size_t e) {
+                             m_eigenvectors.middleRows(b, e - b) +=
+                                 v.segment(b, e - b) * coeffs.row(j);
+                           });
+    if (j + 1 == m) break;
+    if (!op(v, w)) return false;
+    Orthogonalize(pool, w, v, m_alpha[j], u, (j > 0) ? m_beta[j - 1] : 0);
+    std::swap(u, v);
+    v = w;
+    Scale(pool, v, 1 / m_beta[j]);
+  }
+
+  // the Lanczos vectors are not exactly orthonormal
+  for (std::size_t k = 0; k < n; k++) {
+    const auto x = m_eigenvectors.col(k);
+    m_eigenvectors.col(k) /= std::sqrt(Dot(pool, x, x));
+  }
+  return true;
+}
+
+bool LanczosEigensolver::Compute(ThreadPool& pool,
+                                 SpinHamiltonian& hamiltonian,
+                                 std::size_t count) {
+  auto op = [&](const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+    return hamiltonian.Apply(pool, x, y);
+  };
+  return Compute(pool, hamiltonian.GetBasis().GetSize(), op, count);
+}
+
+bool LanczosEigensolver::Save(H5Group& group) const {
+  const std::size_t n = m_eigenvectors.cols();
+  const std::size_t dim = m_eigenvectors.rows();
+  if (n == 0) return false;
+
+  group.Remove("eigenvalues");
+  group.Remove("eigenvectors");
+  const std::vector<double> eigenvalues(m_eigenvalues.data(),
+                                        m_eigenvalues.data() + n);
+  if (!group.CreateDataset("eigenvalues", eigenvalues)) return false;
+  auto vectors =
+      group.CreateUninitializedDataset<double>("eigenvectors", {n, dim});
+  if (!vectors) return false;
+  // column major: every eigenvector is contiguous
+  for (std::size_t k = 0; k < n; k++) {
+    if (!vectors->SetSlabData({k, 0}, {1, dim}, m_eigenvectors.col(k).data()))
+      return false;
+  }
+  return true;
+}
+
+bool LanczosEigensolver::Save(H5Group& group, const SpinBasis& basis) const {
+  const auto excitations = basis.GetExcitationCount();
+  const std::int32_t sites = static_cast<std::int32_t>(basis.GetSiteCount());
+  const std::int32_t count =
+      excitations ? static_cast<std::int32_t>(*excitations) : -1;
+  return Save(group) && group.SetAttribute("sites", sites) &&
+         group.SetAttribute("excitations", count);
+}
+
+}  // namespace QPT
@@ -0,0 +1,105 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_MANYBODY_LANCZOSEIGENSOLVER_H_
+#define QPT_MANYBODY_LANCZOSEIGENSOLVER_H_
+
+#include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/ThreadPool.h"
+#include "SpinBasis.h"
+#include "SpinHamiltonian.h"
+
+namespace QPT {
+
+// Lowest eigenpairs of a large real symmetric operator that is only
+// available as a matrix-vector product. Two-pass Lanczos: the first pass runs
+// the three-term recurrence keeping only three vectors until the lowest Ritz
+// values have converged; spurious copies caused by the loss of orthogonality
+// are removed with the Cullum-Willoughby test. The second pass repeats the
+// (deterministic) recurrence and accumulates the Ritz vectors, so the memory
+// is (3 + count) vectors instead of one vector per iteration.
+// Degenerate eigenvalues are found only once; split them with a symmetry
+// sector (see SpinBasis). All reductions are evaluated in fixed blocks and
+// summed in order, i.e. the results do not depend on the number of threads.
+class LanczosEigensolver {
+ public:
+  // y = A x, returns false on failure
+  using Operator_t =
+      std::function<bool(const Eigen::VectorXd& x, Eigen::VectorXd& y)>;
+
+  // relative residual |A x - lambda x| / max(1, |lambda|) of the eigenpairs
+  void SetTolerance(double tol) { m_tol = tol; }
+  void SetMaxIterations(std::size_t iter) { m_maxIter = iter; }
+  // seed of the pseudo-random start vector
+  void SetSeed(std::uint64_t seed) { m_seed = seed; }
+  // number of vector elements per task
+  void SetBlockSize(std::size_t size) {
+    m_blockSize = std::max<std::size_t>(size, 1);
+  }
+
+  // Computes the count lowest eigenpairs of the operator of dimension dim.
+  // Fails if the operator fails or if the eigenpairs did not converge within
+  // the maximum number of iterations.
+  // Note: if the start vector lies in an invariant subspace of dimension
+  // less than count (e.g. it only overlaps a symmetry sector), the Lanczos
+  // recurrence breaks down and only the eigenpairs of that subspace are
+  // returned, i.e. fewer than count. The recurrence is not restarted (the
+  // Lanczos vectors are not stored); check the size of GetEigenvalues().
+  bool Compute(ThreadPool& pool, std::size_t dim, const Operator_t& op,
+               std::size_t count);
+  bool Compute(ThreadPool& pool, SpinHamiltonian& hamiltonian,
+               std::size_t count);
+
+  // ascending eigenvalues and the corresponding normalized eigenvectors
+  // (columns)
+  const Eigen::VectorXd& GetEigenvalues() const { return m_eigenvalues; }
+  const Eigen::MatrixXd& GetEigenvectors() const { return m_eigenvectors; }
+  std::size_t GetIterationCount() const { return m_iterations; }
+
+  // Writes the datasets "eigenvalues" [count] and "eigenvectors"
+  // [count, dim] (one row per eigenvector) into group
+  bool Save(H5Group& group) const;
+  // Additionally stores the attributes "sites" and "excitations" (-1 for the
+  // full basis) needed to map a vector index onto a basis state
+  bool Save(H5Group& group, const SpinBasis& basis) const;
+
+ private:
+  // deterministic pseudo-random unit vector
+  void StartVector(ThreadPool& pool, Eigen::VectorXd& v);
+  double Dot(ThreadPool& pool, const Eigen::Ref<const Eigen::VectorXd>& a,
+             const Eigen::Ref<const Eigen::VectorXd>& b);
+  void Scale(ThreadPool& pool, Eigen::VectorXd& v, double factor) const;
+  // w <- w - alpha v - beta u
+  void Orthogonalize(ThreadPool& pool, Eigen::VectorXd& w,
+                     const Eigen::VectorXd& v, double alpha,
+                     const Eigen::VectorXd& u, double beta) const;
+  // Ritz pairs of the Lanczos matrix of dimension m, returns the indices of
+  // the (at most count) lowest non-spurious Ritz values
+  std::vector<Eigen::Index> SelectRitzValues(std::size_t m, std::size_t count);
+
+ private:
+  double m_tol = 1e-10;
+  std::size_t m_maxIter = 500;
+  std::uint64_t m_seed = 0;
+  std::size_t m_blockSize = 16384;
+
+  std::size_t m_iterations = 0;
+  Eigen::VectorXd m_eigenvalues;
+  Eigen::MatrixXd m_eigenvectors;
+
+  // Lanczos matrix and its eigendecomposition
+  std::vector<double> m_alpha, m_beta;
+  std::vector<double> m_partialSums;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> m_ritz;
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> m_reduced;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_MANYBODY_LANCZOSEIGENSOLVER_H_
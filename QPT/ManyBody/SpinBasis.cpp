@@ -0,0 +1,65 @@
+// Philipp Neufeld, 2023
+
+#include "SpinBasis.h"
+
+#include <algorithm>
+
+namespace QPT {
+
+SpinBasis::SpinBasis(std::size_t sites)
+    : m_sites(std::min<std::size_t>(sites, 62)),
+      m_size(std::size_t(1) << m_sites) {}
+
+SpinBasis::SpinBasis(std::size_t sites, std::size_t excitations)
+    : m_sites(std::min<std::size_t>(sites, 62)),
+      m_excitations(std::min(excitations, m_sites)) {
+  // Pascal's triangle: row n holds C(n, 0 ... n)
+  const std::size_t n = m_sites + 1;
+  m_binomial.assign(n * n, 0);
+  for (std::size_t i = 0; i < n; i++) {
+    m_binomial[i * n] = 1;
+    for (std::size_t j = 1; j <= i; j++)
+      m_binomial[i * n + j] =
+          m_binomial[(i - 1) * n + j - 1] + m_binomial[(i - 1) * n + j];
+  }
+  const std::size_t k = *m_excitations;
+  m_size = GetBinomial(m_sites, k);
+
+  // rank = sum_r C(n_r, r + 1) over the excited sites n_0 < n_1 < ...,
+  // split into the contributions of the individual bytes
+  const std::size_t bytes = (m_sites + 7) / 8;
+  m_rankTable.assign(bytes * (k + 1) * 256, 0);
+  for (std::size_t c = 0; c < bytes; c++) {
+    for (std::size_t offset = 0; offset <= k; offset++) {
+      for (std::size_t byte = 0; byte < 256; byte++) {
+        std::size_t value = 0, r = offset;
+        for (std::size_t bit = 0; bit < 8; bit++) {
+          if ((byte & (std::size_t(1) << bit)) == 0) continue;
+          const std::size_t site = 8 * c + bit;
+          // states with too many excitations are rejected by GetIndex
+          if (r < k && site < m_sites) value += GetBinomial(site, r + 1);
+          r++;
+        }
+        m_rankTable[(c * (k + 1) + offset) * 256 + byte] = value;
+      }
+    }
+  }
+}
+
+SpinBasis::State_t SpinBasis::GetState(std::size_t index) const {
+  if (!m_excitations) return index;
+
+  // greedy decomposition index = sum_r C(n_r, r + 1), n_0 < n_1 < ...
+  State_t state = 0;
+  std::size_t n = m_sites;
+  for (std::size_t r = *m_excitations; r-- > 0;) {
+    do {
+      n--;
+    } while (GetBinomial(n, r + 1) > index);
+    state |= State_t(1) << n;
+    index -= GetBinomial(n, r + 1);
+  }
+  return state;
+}
+
+}  // namespace QPT
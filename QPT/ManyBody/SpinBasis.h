@@ -0,0 +1,122 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_MANYBODY_SPINBASIS_H_
+#define QPT_MANYBODY_SPINBASIS_H_
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "../Platform.h"
+
+#ifdef QPT_COMPILER_MSVC
+#include <intrin.h>
+#endif
+
+namespace QPT {
+
+// Product basis of a lattice of two-level systems (spins or ground/Rydberg
+// atoms). A basis state is encoded as a bit string with bit i set if site i
+// is excited. The basis either spans the full 2^N dimensional space or the
+// sector with a fixed number of excitations (conserved by Hamiltonians with
+// only diagonal and exchange terms). Within a sector the states are ordered
+// by their integer value and the index of a state is its rank in the
+// combinatorial number system. No list of states is stored: the rank is the
+// sum of one precomputed table entry per byte of the state (given the number
+// of excitations in the lower bytes) and the unrank is O(N).
+class SpinBasis {
+ public:
+  using State_t = std::uint64_t;
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  // full basis (at most 62 sites)
+  explicit SpinBasis(std::size_t sites);
+  // sector with a fixed number of excitations
+  SpinBasis(std::size_t sites, std::size_t excitations);
+
+  std::size_t GetSiteCount() const { return m_sites; }
+  std::size_t GetSize() const { return m_size; }
+  std::optional<std::size_t> GetExcitationCount() const {
+    return m_excitations;
+  }
+
+  // state with the given index (unrank)
+  State_t GetState(std::size_t index) const;
+  // index of a state (rank), npos if the state is not part of the basis
+  std::size_t GetIndex(State_t state) const;
+  // state following state in index order
+  State_t GetNextState(State_t state) const;
+
+ private:
+  static int PopCount(State_t state);
+  static int CountTrailingZeros(State_t state);
+  // binomial coefficient C(n, k)
+  std::size_t GetBinomial(std::size_t n, std::size_t k) const {
+    return (k <= n) ? m_binomial[n * (m_sites + 1) + k] : 0;
+  }
+
+ private:
+  std::size_t m_sites;
+  std::optional<std::size_t> m_excitations;
+  std::size_t m_size;
+  std::vector<std::size_t> m_binomial;
+  // rank contribution of a byte value at byte position c with offset
+  // excitations in the lower bytes: [c][offset][byte]
+  std::vector<std::size_t> m_rankTable;
+};
+
+// Inline function definitions
+inline int SpinBasis::PopCount(State_t state) {
+#if defined(QPT_COMPILER_MSVC)
+  return static_cast<int>(__popcnt64(state));
+#elif defined(__POPCNT__)
+  return __builtin_popcountll(state);
+#else
+  // without hardware support the builtin is a library call
+  state = state - ((state >> 1) & 0x5555555555555555ull);
+  state = (state & 0x3333333333333333ull) +
+          ((state >> 2) & 0x3333333333333333ull);
+  state = (state + (state >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+  return static_cast<int>((state * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+inline int SpinBasis::CountTrailingZeros(State_t state) {
+#ifdef QPT_COMPILER_MSVC
+  unsigned long index;
+  _BitScanForward64(&index, state);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(state);
+#endif
+}
+
+inline std::size_t SpinBasis::GetIndex(State_t state) const {
+  if ((state >> m_sites) != 0) return npos;
+  if (!m_excitations) return state;
+  const std::size_t excitations = *m_excitations;
+  if (static_cast<std::size_t>(PopCount(state)) != excitations) return npos;
+
+  std::size_t index = 0, offset = 0;
+  for (std::size_t c = 0; state != 0; c++, state >>= 8) {
+    const auto byte = static_cast<std::size_t>(state & 0xFF);
+    index += m_rankTable[(c * (excitations + 1) + offset) * 256 + byte];
+    offset += PopCount(byte);
+  }
+  return index;
+}
+
+inline SpinBasis::State_t SpinBasis::GetNextState(State_t state) const {
+  if (!m_excitations) return state + 1;
+  if (state == 0) return 0;
+
+  // next larger integer with the same number of set bits (Gosper's hack)
+  const State_t lowest = state & (~state + 1);
+  const State_t ripple = state + lowest;
+  return ripple | (((ripple ^ state) >> 2) >> CountTrailingZeros(state));
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_MANYBODY_SPINBASIS_H_
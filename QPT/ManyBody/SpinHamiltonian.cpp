@@ -0,0 +1,87 @@
+// Philipp Neufeld, 2023
+
+#include "SpinHamiltonian.h"
+
+namespace QPT {
+
+SpinHamiltonian::SpinHamiltonian(const SpinBasis& basis) : m_basis(basis) {}
+
+bool SpinHamiltonian::AddField(std::size_t site, double h) {
+  if (site >= m_basis.GetSiteCount()) return false;
+  m_diagonalTerms.push_back({SpinBasis::State_t(1) << site, h});
+  m_diagonalValid = false;
+  return true;
+}
+
+bool SpinHamiltonian::AddInteraction(std::size_t i, std::size_t j, double V) {
+  const std::size_t sites = m_basis.GetSiteCount();
+  if (i >= sites || j >= sites) return false;
+  // n_i n_i = n_i
+  const auto mask = (SpinBasis::State_t(1) << i) | (SpinBasis::State_t(1) << j);
+  m_diagonalTerms.push_back({mask, V});
+  m_diagonalValid = false;
+  return true;
+}
+
+bool SpinHamiltonian::AddRabiCoupling(std::size_t site, double Omega) {
+  if (site >= m_basis.GetSiteCount()) return false;
+  m_rabiTerms.push_back({SpinBasis::State_t(1) << site, Omega / 2});
+  return true;
+}
+
+bool SpinHamiltonian::AddExchange(std::size_t i, std::size_t j, double J) {
+  const std::size_t sites = m_basis.GetSiteCount();
+  if (i >= sites || j >= sites || i == j) return false;
+  const auto mask = (SpinBasis::State_t(1) << i) | (SpinBasis::State_t(1) << j);
+  m_exchangeTerms.push_back({mask, J});
+  return true;
+}
+
+void SpinHamiltonian::UpdateDiagonal(ThreadPool& pool) {
+  m_diagonal.resize(m_basis.GetSize());
+  pool.ParallelForBlocks(
+      0, m_basis.GetSize(), m_blockSize, [&](std::size_t b, std::size_t e) {
+        auto state = m_basis.GetState(b);
+        for (std::size_t i = b; i < e; i++) {
+          double value = 0;
+          for (const auto& term : m_diagonalTerms) {
+            if ((state & term.mask) == term.mask) value += term.value;
+          }
+          m_diagonal[i] = value;
+          state = m_basis.GetNextState(state);
+        }
+      });
+  m_diagonalValid = true;
+}
+
+bool SpinHamiltonian::Apply(ThreadPool& pool, const Eigen::VectorXd& x,
+                            Eigen::VectorXd& y) {
+  const std::size_t size = m_basis.GetSize();
+  if (static_cast<std::size_t>(x.size()) != size) return false;
+  if (m_basis.GetExcitationCount() && !ConservesExcitations()) return false;
+  if (!m_diagonalValid) UpdateDiagonal(pool);
+
+  // every task generates the rows of consecutive basis states (gather, no
+  // write conflicts since H is symmetric)
+  y.resize(size);
+  pool.ParallelForBlocks(0, size, m_blockSize, [&](std::size_t b,
+                                                   std::size_t e) {
+    auto state = m_basis.GetState(b);
+    for (std::size_t i = b; i < e; i++) {
+      double value = m_diagonal[i] * x[i];
+      for (const auto& term : m_rabiTerms)
+        value += term.value * x[m_basis.GetIndex(state ^ term.mask)];
+      for (const auto& term : m_exchangeTerms) {
+        // exactly one of the two sites is excited
+        const auto bits = state & term.mask;
+        if (bits != 0 && bits != term.mask)
+          value += term.value * x[m_basis.GetIndex(state ^ term.mask)];
+      }
+      y[i] = value;
+      state = m_basis.GetNextState(state);
+    }
+  });
+  return true;
+}
+
+}  // namespace QPT
@@ -0,0 +1,69 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_MANYBODY_SPINHAMILTONIAN_H_
+#define QPT_MANYBODY_SPINHAMILTONIAN_H_
+
+#include <Eigen/Dense>
+#include <vector>
+
+#include "../Parallel/ThreadPool.h"
+#include "SpinBasis.h"
+
+namespace QPT {
+
+// Real Hamiltonian of a lattice of two-level systems, e.g. Rydberg atoms
+//   H = sum_i (Omega_i / 2) sigma_x^i + sum_i h_i n_i + sum_ij V_ij n_i n_j
+//       + sum_ij J_ij (sigma_+^i sigma_-^j + sigma_-^i sigma_+^j)
+// (n_i = |r><r| of site i). The matrix is never stored: Apply generates the
+// elements of every row on the fly from the bit encoded basis states, so the
+// memory is dominated by the state vectors. Only the diagonal is cached (one
+// vector) since it is the most expensive part (all pairs of excitations).
+class SpinHamiltonian {
+ public:
+  explicit SpinHamiltonian(const SpinBasis& basis);
+
+  const SpinBasis& GetBasis() const { return m_basis; }
+
+  // The functions below return false if a site is out of range
+  // h n_i
+  bool AddField(std::size_t site, double h);
+  // V n_i n_j
+  bool AddInteraction(std::size_t i, std::size_t j, double V);
+  // (Omega / 2) sigma_x^i, does not conserve the number of excitations
+  bool AddRabiCoupling(std::size_t site, double Omega);
+  // J (sigma_+^i sigma_-^j + sigma_-^i sigma_+^j)
+  bool AddExchange(std::size_t i, std::size_t j, double J);
+
+  bool ConservesExcitations() const { return m_rabiTerms.empty(); }
+
+  // minimum number of rows per task
+  void SetBlockSize(std::size_t size) { m_blockSize = size; }
+
+  // y = H x (x and y must not alias). Fails if the size of x does not match
+  // the basis or if the Hamiltonian couples different excitation sectors
+  // but the basis is restricted to one of them.
+  bool Apply(ThreadPool& pool, const Eigen::VectorXd& x, Eigen::VectorXd& y);
+
+ private:
+  // a term acts on the sites whose bits are set in mask
+  struct Term {
+    SpinBasis::State_t mask;
+    double value;
+  };
+
+  void UpdateDiagonal(ThreadPool& pool);
+
+ private:
+  SpinBasis m_basis;
+  std::size_t m_blockSize = 4096;
+  std::vector<Term> m_diagonalTerms;
+  std::vector<Term> m_rabiTerms;
+  std::vector<Term> m_exchangeTerms;
+
+  bool m_diagonalValid = false;
+  Eigen::VectorXd m_diagonal;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_MANYBODY_SPINHAMILTONIAN_H_
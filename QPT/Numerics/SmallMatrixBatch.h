@@ -0,0 +1,439 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_NUMERICS_SMALLMATRIXBATCH_H_
+#define QPT_NUMERICS_SMALLMATRIXBATCH_H_
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace QPT {
+
+// Many complex N x M matrices of the same (small, fixed) size in
+// structure-of-arrays layout. The matrices are grouped into blocks of Lanes
+// matrices; within a block every element is stored as Lanes real parts
+// followed by Lanes imaginary parts:
+//   block b: re(i, j)[0 .. Lanes), ..., im(i, j)[0 .. Lanes), ...
+// All kernels loop over the lanes of a block in their innermost loop with a
+// compile-time trip count, so every SIMD lane works on a different system
+// (the width follows from the compiler flags, e.g. -march=native). Unused
+// lanes of the last block hold identity matrices.
+template <int N, int M = N>
+class SmallMatrixBatch {
+ public:
+  static constexpr std::size_t Lanes = 8;
+  static constexpr std::size_t BlockSize = 2 * N * M * Lanes;
+  using Matrix_t = Eigen::Matrix<std::complex<double>, N, M>;
+
+  explicit SmallMatrixBatch(std::size_t count = 0) { Resize(count); }
+
+  // all matrices are set to zero
+  void Resize(std::size_t count);
+  void SetZero();
+  std::size_t GetCount() const { return m_count; }
+  std::size_t GetBlockCount() const { return (m_count + Lanes - 1) / Lanes; }
+
+  void Set(std::size_t idx, const Matrix_t& mat);
+  Matrix_t Get(std::size_t idx) const;
+
+  double* GetBlock(std::size_t block) {
+    return m_data.data() + block * BlockSize;
+  }
+  const double* GetBlock(std::size_t block) const {
+    return m_data.data() + block * BlockSize;
+  }
+
+ private:
+  std::size_t m_count = 0;
+  std::vector<double> m_data;
+};
+
+template <int N>
+using SmallVectorBatch = SmallMatrixBatch<N, 1>;
+
+// Kernels on single blocks (rows x cols matrices in the layout above)
+template <int N>
+struct SmallMatrixBlock {
+  static constexpr std::size_t L = SmallMatrixBatch<N>::Lanes;
+
+  // c = a b for the N x N block a and the N x cols blocks b, c
+  static void Multiply(const double* a, const double* b, double* c, int cols);
+  // LU decomposition with partial pivoting in place (unit lower triangular
+  // factor below the diagonal). perm receives the row permutation (as
+  // doubles, so that the pivot search stays in vector registers).
+  static void Decompose(double* a, double* perm);
+  // x = A^-1 b (N x cols blocks) from the result of Decompose
+  static void Solve(const double* lu, const double* perm, const double* b,
+                    double* x, int cols);
+  // exp(a) with scaling and squaring and the [13/13] Pade approximant
+  // (Higham, SIAM J. Matrix Anal. Appl. 26, 1179 (2005)). The number of
+  // squarings is the maximum of all lanes. scratch holds 8 blocks and
+  // N * L doubles.
+  static void Exp(const double* a, double* out, double* scratch);
+};
+
+// c[k] = a[k] b[k]
+template <int N, int M>
+void Multiply(const SmallMatrixBatch<N>& a, const SmallMatrixBatch<N, M>& b,
+              SmallMatrixBatch<N, M>& c);
+
+// LU decompositions of a batch of N x N matrices. Lanes with a singular
+// matrix yield non-finite solutions, the other lanes are not affected.
+template <int N>
+class SmallLUBatch {
+ public:
+  SmallLUBatch() = default;
+  explicit SmallLUBatch(const SmallMatrixBatch<N>& a) { Compute(a); }
+
+  void Compute(const SmallMatrixBatch<N>& a);
+  std::size_t GetCount() const { return m_lu.GetCount(); }
+
+  // x[k] = a[k]^-1 b[k] (also for M right-hand sides per system)
+  template <int M>
+  void Solve(const SmallMatrixBatch<N, M>& b,
+             SmallMatrixBatch<N, M>& x) const;
+
+ private:
+  SmallMatrixBatch<N> m_lu;
+  std::vector<double> m_perm;
+};
+
+// out[k] = exp(t a[k])
+template <int N>
+void Exp(const SmallMatrixBatch<N>& a, SmallMatrixBatch<N>& out,
+         double t = 1);
+
+// Template function definitions
+template <int N, int M>
+void SmallMatrixBatch<N, M>::Resize(std::size_t count) {
+  m_count = count;
+  m_data.resize(GetBlockCount() * BlockSize);
+  SetZero();
+}
+
+template <int N, int M>
+void SmallMatrixBatch<N, M>::SetZero() {
+  std::fill(m_data.begin(), m_data.end(), 0.0);
+  // identities in the unused lanes keep the kernels finite
+  if (m_count % Lanes == 0) return;
+  double* block = GetBlock(GetBlockCount() - 1);
+  for (std::size_t l = m_count % Lanes; l < Lanes; l++) {
+    for (int i = 0; i < std::min(N, M); i++) block[(i * M + i) * Lanes + l] = 1;
+  }
+}
+
+template <int N, int M>
+void SmallMatrixBatch<N, M>::Set(std::size_t idx, const Matrix_t& mat) {
+  double* re = GetBlock(idx / Lanes) + idx % Lanes;
+  double* im = re + N * M * Lanes;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < M; j++) {
+      re[(i * M + j) * Lanes] = mat(i, j).real();
+      im[(i * M + j) * Lanes] = mat(i, j).imag();
+    }
+  }
+}
+
+template <int N, int M>
+typename SmallMatrixBatch<N, M>::Matrix_t SmallMatrixBatch<N, M>::Get(
+    std::size_t idx) const {
+  const double* re = GetBlock(idx / Lanes) + idx % Lanes;
+  const double* im = re + N * M * Lanes;
+  Matrix_t mat;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < M; j++)
+      mat(i, j) = {re[(i * M + j) * Lanes], im[(i * M + j) * Lanes]};
+  }
+  return mat;
+}
+
+// The lane loops of the kernels read the blocks and write local arrays
+// only, so the compiler vectorizes them without alias checks.
+template <int N>
+void SmallMatrixBlock<N>::Multiply(const double* a, const double* b,
+                                   double* c, int cols) {
+  const double* aIm = a + N * N * L;
+  const double* bIm = b + N * cols * L;
+  double* cIm = c + N * cols * L;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < cols; j++) {
+      double sr[L] = {}, si[L] = {};
+      for (int k = 0; k < N; k++) {
+        const double* ar = a + (i * N + k) * L;
+        const double* ai = aIm + (i * N + k) * L;
+        const double* br = b + (k * cols + j) * L;
+        const double* bi = bIm + (k * cols + j) * L;
+        for (std::size_t l = 0; l < L; l++) {
+          sr[l] += ar[l] * br[l] - ai[l] * bi[l];
+          si[l] += ar[l] * bi[l] + ai[l] * br[l];
+        }
+      }
+      std::copy(sr, sr + L, c + (i * cols + j) * L);
+      std::copy(si, si + L, cIm + (i * cols + j) * L);
+    }
+  }
+}
+
+template <int N>
+void SmallMatrixBlock<N>::Decompose(double* a, double* perm) {
+  double* aIm = a + N * N * L;
+  for (int i = 0; i < N; i++) std::fill(perm + i * L, perm + (i + 1) * L, i);
+
+  for (int k = 0; k < N; k++) {
+    // pivot search in all lanes at once, the row swaps are the only
+    // lane-dependent addressing
+    double* kr = a + k * N * L;
+    double* ki = aIm + k * N * L;
+    double best[L], pivot[L];
+    for (std::size_t l = 0; l < L; l++) {
+      best[l] = kr[k * L + l] * kr[k * L + l] + ki[k * L + l] * ki[k * L + l];
+      pivot[l] = k;
+    }
+    for (int r = k + 1; r < N; r++) {
+      const double* rr = a + (r * N + k) * L;
+      const double* ri = aIm + (r * N + k) * L;
+      for (std::size_t l = 0; l < L; l++) {
+        const double norm = rr[l] * rr[l] + ri[l] * ri[l];
+        pivot[l] = (norm > best[l]) ? r : pivot[l];
+        best[l] = (norm > best[l]) ? norm : best[l];
+      }
+    }
+    for (std::size_t l = 0; l < L; l++) {
+      const int p = static_cast<int>(pivot[l]);
+      if (p == k) continue;
+      for (int j = 0; j < N; j++) {
+        std::swap(kr[j * L + l], a[(p * N + j) * L + l]);
+        std::swap(ki[j * L + l], aIm[(p * N + j) * L + l]);
+      }
+      std::swap(perm[k * L + l], perm[p * L + l]);
+    }
+
+    // 1 / a_kk
+    double invR[L], invI[L];
+    for (std::size_t l = 0; l < L; l++) {
+      const double re = kr[k * L + l], im = ki[k * L + l];
+      const double norm = 1 / (re * re + im * im);
+      invR[l] = re * norm;
+      invI[l] = -im * norm;
+    }
+
+    for (int r = k + 1; r < N; r++) {
+      double* rr = a + r * N * L;
+      double* ri = aIm + r * N * L;
+      double fr[L], fi[L];
+      for (std::size_t l = 0; l < L; l++) {
+        const double re = rr[k * L + l], im = ri[k * L + l];
+        fr[l] = re * invR[l] - im * invI[l];
+        fi[l] = re * invI[l] + im * invR[l];
+      }
+      std::copy(fr, fr + L, rr + k * L);
+      std::copy(fi, fi + L, ri + k * L);
+      for (int j = k + 1; j < N; j++) {
+        double tr[L], ti[L];
+        for (std::size_t l = 0; l < L; l++) {
+          tr[l] = rr[j * L + l] - (fr[l] * kr[j * L + l] -
+                                   fi[l] * ki[j * L + l]);
+          ti[l] = ri[j * L + l] - (fr[l] * ki[j * L + l] +
+                                   fi[l] * kr[j * L + l]);
+        }
+        std::copy(tr, tr + L, rr + j * L);
+        std::copy(ti, ti + L, ri + j * L);
+      }
+    }
+  }
+}
+
+template <int N>
+void SmallMatrixBlock<N>::Solve(const double* lu, const double* perm,
+                                const double* b, double* x, int cols) {
+  const double* luIm = lu + N * N * L;
+  const double* bIm = b + N * cols * L;
+  double* xIm = x + N * cols * L;
+
+  // x = P b (the only lane-dependent addressing)
+  for (int i = 0; i < N; i++) {
+    for (std::size_t l = 0; l < L; l++) {
+      const int p = static_cast<int>(perm[i * L + l]);
+      for (int j = 0; j < cols; j++) {
+        x[(i * cols + j) * L + l] = b[(p * cols + j) * L + l];
+        xIm[(i * cols + j) * L + l] = bIm[(p * cols + j) * L + l];
+      }
+    }
+  }
+
+  // x_i = (x_i - sum_k a_ik x_k) / a_ii for k in [kBegin, kEnd)
+  auto update = [&](int i, int kBegin, int kEnd, bool divide) {
+    const double* dr = lu + (i * N + i) * L;
+    const double* di = luIm + (i * N + i) * L;
+    for (int j = 0; j < cols; j++) {
+      double sr[L], si[L];
+      std::copy(x + (i * cols + j) * L, x + (i * cols + j + 1) * L, sr);
+      std::copy(xIm + (i * cols + j) * L, xIm + (i * cols + j + 1) * L, si);
+      for (int k = kBegin; k < kEnd; k++) {
+        const double* fr = lu + (i * N + k) * L;
+        const double* fi = luIm + (i * N + k) * L;
+        const double* yr = x + (k * cols + j) * L;
+        const double* yi = xIm + (k * cols + j) * L;
+        for (std::size_t l = 0; l < L; l++) {
+          sr[l] -= fr[l] * yr[l] - fi[l] * yi[l];
+          si[l] -= fr[l] * yi[l] + fi[l] * yr[l];
+        }
+      }
+      if (divide) {
+        for (std::size_t l = 0; l < L; l++) {
+          const double norm = 1 / (dr[l] * dr[l] + di[l] * di[l]);
+          const double re = (sr[l] * dr[l] + si[l] * di[l]) * norm;
+          si[l] = (si[l] * dr[l] - sr[l] * di[l]) * norm;
+          sr[l] = re;
+        }
+      }
+      std::copy(sr, sr + L, x + (i * cols + j) * L);
+      std::copy(si, si + L, xIm + (i * cols + j) * L);
+    }
+  };
+
+  // forward substitution (unit diagonal), backward substitution
+  for (int i = 1; i < N; i++) update(i, 0, i, false);
+  for (int i = N - 1; i >= 0; i--) update(i, i + 1, N, true);
+}
+
+template <int N>
+void SmallMatrixBlock<N>::Exp(const double* a, double* out, double* scratch) {
+  constexpr std::size_t size = SmallMatrixBatch<N>::BlockSize;
+  constexpr double b[14] = {64764752532480000.0,
+                            32382376266240000.0,
+                            7771770303897600.0,
+                            1187353796428800.0,
+                            129060195264000.0,
+                            10559470521600.0,
+                            670442572800.0,
+                            33522128640.0,
+                            1323241920.0,
+                            40840800.0,
+                            960960.0,
+                            16380.0,
+                            182.0,
+                            1.0};
+  // largest 1-norm for which [13/13] is accurate to double precision
+  constexpr double theta13 = 5.371920351148152;
+  double* A = scratch;
+  double* A2 = A + size;
+  double* A4 = A2 + size;
+  double* A6 = A4 + size;
+  double* U = A6 + size;
+  double* V = U + size;
+  double* T = V + size;
+  double* perm = T + size;
+  double* P = perm + N * L;
+
+  // number of squarings: the maximum of all lanes
+  double maxNorm = 0;
+  for (std::size_t l = 0; l < L; l++) {
+    for (int j = 0; j < N; j++) {
+      double sum = 0;
+      for (int i = 0; i < N; i++)
+        sum += std::hypot(a[(i * N + j) * L + l],
+                          a[(N * N + i * N + j) * L + l]);
+      maxNorm = std::max(maxNorm, sum);
+    }
+  }
+  const int s =
+      (maxNorm > theta13) ? static_cast<int>(std::ceil(
+                                std::log2(maxNorm / theta13)))
+                          : 0;
+  const double scale = std::ldexp(1.0, -s);
+  for (std::size_t i = 0; i < size; i++) A[i] = scale * a[i];
+
+  // x = sum_k c_k X_k (+ c_I I)
+  auto combine = [&](double* x, std::initializer_list<double> c,
+                     std::initializer_list<const double*> mats, double cI) {
+    std::fill(x, x + size, 0.0);
+    auto mat = mats.begin();
+    for (auto ck = c.begin(); ck != c.end(); ck++, mat++) {
+      for (std::size_t i = 0; i < size; i++) x[i] += *ck * (*mat)[i];
+    }
+    for (int i = 0; i < N; i++) {
+      for (std::size_t l = 0; l < L; l++) x[(i * N + i) * L + l] += cI;
+    }
+  };
+
+  Multiply(A, A, A2, N);
+  Multiply(A2, A2, A4, N);
+  Multiply(A4, A2, A6, N);
+
+  // U = A (A6 (b13 A6 + b11 A4 + b9 A2) + b7 A6 + b5 A4 + b3 A2 + b1 I)
+  combine(T, {b[13], b[11], b[9]}, {A6, A4, A2}, 0);
+  Multiply(A6, T, U, N);
+  combine(T, {1, b[7], b[5], b[3]}, {U, A6, A4, A2}, b[1]);
+  Multiply(A, T, U, N);
+  // V = A6 (b12 A6 + b10 A4 + b8 A2) + b6 A6 + b4 A4 + b2 A2 + b0 I
+  combine(T, {b[12], b[10], b[8]}, {A6, A4, A2}, 0);
+  Multiply(A6, T, V, N);
+  combine(T, {1, b[6], b[4], b[2]}, {V, A6, A4, A2}, b[0]);
+  std::swap(T, V);
+
+  // r = (V - U)^-1 (V + U)
+  for (std::size_t i = 0; i < size; i++) {
+    T[i] = V[i] - U[i];
+    P[i] = V[i] + U[i];
+  }
+  Decompose(T, perm);
+  Solve(T, perm, P, out, N);
+
+  // undo the scaling
+  for (int k = 0; k < s; k++) {
+    std::copy(out, out + size, T);
+    Multiply(T, T, out, N);
+  }
+}
+
+template <int N, int M>
+void Multiply(const SmallMatrixBatch<N>& a, const SmallMatrixBatch<N, M>& b,
+              SmallMatrixBatch<N, M>& c) {
+  if (c.GetCount() != a.GetCount()) c.Resize(a.GetCount());
+  for (std::size_t k = 0; k < a.GetBlockCount(); k++)
+    SmallMatrixBlock<N>::Multiply(a.GetBlock(k), b.GetBlock(k), c.GetBlock(k),
+                                  M);
+}
+
+template <int N>
+void SmallLUBatch<N>::Compute(const SmallMatrixBatch<N>& a) {
+  constexpr std::size_t L = SmallMatrixBatch<N>::Lanes;
+  m_lu = a;
+  m_perm.resize(m_lu.GetBlockCount() * N * L);
+  for (std::size_t k = 0; k < m_lu.GetBlockCount(); k++)
+    SmallMatrixBlock<N>::Decompose(m_lu.GetBlock(k), &m_perm[k * N * L]);
+}
+
+template <int N>
+template <int M>
+void SmallLUBatch<N>::Solve(const SmallMatrixBatch<N, M>& b,
+                            SmallMatrixBatch<N, M>& x) const {
+  constexpr std::size_t L = SmallMatrixBatch<N>::Lanes;
+  if (x.GetCount() != GetCount()) x.Resize(GetCount());
+  for (std::size_t k = 0; k < m_lu.GetBlockCount(); k++)
+    SmallMatrixBlock<N>::Solve(m_lu.GetBlock(k), &m_perm[k * N * L],
+                               b.GetBlock(k), x.GetBlock(k), M);
+}
+
+template <int N>
+void Exp(const SmallMatrixBatch<N>& a, SmallMatrixBatch<N>& out, double t) {
+  constexpr std::size_t size = SmallMatrixBatch<N>::BlockSize;
+  constexpr std::size_t L = SmallMatrixBatch<N>::Lanes;
+  if (out.GetCount() != a.GetCount()) out.Resize(a.GetCount());
+  std::vector<double> scaled(size);
+  std::vector<double> scratch(8 * size + N * L);
+  for (std::size_t k = 0; k < a.GetBlockCount(); k++) {
+    const double* block = a.GetBlock(k);
+    for (std::size_t i = 0; i < size; i++) scaled[i] = t * block[i];
+    SmallMatrixBlock<N>::Exp(scaled.data(), out.GetBlock(k), scratch.data());
+  }
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_NUMERICS_SMALLMATRIXBATCH_H_
@@ -0,0 +1,235 @@
+// Philipp Neufeld, 2023
+
+#include "TabulatedFunction.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "TabulatedFunctionKernel.h"
+
+namespace QPT {
+
+namespace {
+// at least 4 points (the kernels use 32 bit indices) on a non-empty interval
+bool IsValidGrid(double lower, double upper, std::size_t points) {
+  const std::size_t maxPoints = std::numeric_limits<std::int32_t>::max();
+  return upper > lower && points >= 4 && points <= maxPoints;
+}
+}  // namespace
+
+SplineKernel_t GetSplineKernelScalar() {
+  return &EvaluateSpline<SplineScalarPack>;
+}
+
+TabulatedFunction::TabulatedFunction(double lower, double upper,
+                                     std::vector<double> values,
+                                     SplineType type)
+    : m_lower(lower),
+      m_upper(upper),
+      m_values(std::move(values)),
+      m_type(type),
+      m_kernel(GetSplineKernelScalar()) {
+  ComputeCoefficients();
+
+  // best kernel available
+  for (int level = GetSupportedSimdLevel(); level > Simd_SCALAR; level--) {
+    if (SetSimdLevel(static_cast<SimdLevel>(level))) break;
+  }
+}
+
+std::optional<TabulatedFunction> TabulatedFunction::FromValues(
+    double lower, double upper, std::vector<double> values, SplineType type) {
+  if (!IsValidGrid(lower, upper, values.size())) return std::nullopt;
+  if (type != Spline_CUBIC && type != Spline_MONOTONE) return std::nullopt;
+  for (double v : values) {
+    if (!std::isfinite(v)) return std::nullopt;
+  }
+  return TabulatedFunction(lower, upper, std::move(values), type);
+}
+
+std::optional<TabulatedFunction> TabulatedFunction::Sample(
+    const Function_t& func, double lower, double upper, std::size_t points,
+    SplineType type) {
+  // validated before func is evaluated (the spacing needs 2 points)
+  if (!IsValidGrid(lower, upper, points)) return std::nullopt;
+  std::vector<double> values(points);
+  const double step = (upper - lower) / (points - 1);
+  for (std::size_t i = 0; i < points; i++) values[i] = func(lower + i * step);
+  return FromValues(lower, upper, std::move(values), type);
+}
+
+std::optional<TabulatedFunction> TabulatedFunction::Sample(
+    ThreadPool& pool, const Function_t& func, double lower, double upper,
+    std::size_t points, SplineType type) {
+  if (!IsValidGrid(lower, upper, points)) return std::nullopt;
+  std::vector<double> values(points);
+  const double step = (upper - lower) / (points - 1);
+  pool.ParallelFor(
+      0, points, [&](std::size_t i) { values[i] = func(lower + i * step); },
+      64);
+  return FromValues(lower, upper, std::move(values), type);
+}
+
+const char* TabulatedFunction::GetSplineTypeName(SplineType type) {
+  return (type == Spline_MONOTONE) ? "monotone" : "cubic";
+}
+
+std::optional<TabulatedFunction> TabulatedFunction::Load(
+    H5Group& group, const std::string& name) {
+  if (!group.HasDataset(name)) return std::nullopt;
+  auto ds = group.OpenExistingDataset(name);
+  if (!ds) return std::nullopt;
+  auto values = ds->Get<std::vector<double>>();
+  auto lower = ds->GetAttribute<double>("lower");
+  auto upper = ds->GetAttribute<double>("upper");
+  auto spline = ds->GetAttribute<std::string>("spline");
+  if (!values || !lower || !upper || !spline) return std::nullopt;
+
+  SplineType type;
+  if (*spline == GetSplineTypeName(Spline_CUBIC))
+    type = Spline_CUBIC;
+  else if (*spline == GetSplineTypeName(Spline_MONOTONE))
+    type = Spline_MONOTONE;
+  else
+    return std::nullopt;
+  return FromValues(*lower, *upper, std::move(*values), type);
+}
+
+bool TabulatedFunction::Save(H5Group& group, const std::string& name) const {
+  auto ds = group.CreateDataset(name, m_values);
+  return ds && ds->SetAttribute("lower", m_lower) &&
+         ds->SetAttribute("upper", m_upper) &&
+         ds->SetAttribute("spline", std::string(GetSplineTypeName(m_type)));
+}
+
+std::optional<TabulatedFunction> TabulatedFunction::LoadOrSample(
+    ThreadPool& pool, H5Group& group, const std::string& name,
+    const Function_t& func, double lower, double upper, std::size_t points,
+    SplineType type) {
+  if (auto table = Load(group, name)) {
+    if (table->GetLowerBound() == lower && table->GetUpperBound() == upper &&
+        table->GetPointCount() == points && table->GetSplineType() == type)
+      return table;
+  }
+
+  auto table = Sample(pool, func, lower, upper, points, type);
+  if (!table) return std::nullopt;
+  group.Remove(name);
+  if (!table->Save(group, name)) return std::nullopt;
+  return table;
+}
+
+std::vector<double> TabulatedFunction::ComputeCubicSlopes() const {
+  // clamped spline: S_{i-1} + 4 S_i + S_{i+1} = 3 (y_{i+1} - y_{i-1}) with
+  // the end slopes from third order one-sided differences
+  const auto& y = m_values;
+  const std::size_t n = y.size() - 1;
+  std::vector<double> slopes(n + 1);
+  slopes[0] = (-11 * y[0] + 18 * y[1] - 9 * y[2] + 2 * y[3]) / 6;
+  slopes[n] =
+      (11 * y[n] - 18 * y[n - 1] + 9 * y[n - 2] - 2 * y[n - 3]) / 6;
+
+  // Thomas algorithm for the interior slopes (diagonally dominant)
+  std::vector<double> super(n), rhs(n);
+  for (std::size_t i = 1; i < n; i++) {
+    double r = 3 * (y[i + 1] - y[i - 1]);
+    if (i == 1) r -= slopes[0];
+    if (i == n - 1) r -= slopes[n];
+    const double prevSuper = (i > 1) ? super[i - 1] : 0.0;
+    const double prevRhs = (i > 1) ? rhs[i - 1] : 0.0;
+    const double pivot = 4 - prevSuper;
+    super[i] = 1 / pivot;
+    rhs[i] = (r - prevRhs) / pivot;
+  }
+  slopes[n - 1] = rhs[n - 1];
+  for (std::size_t i = n - 2; i > 0; i--)
+    slopes[i] = rhs[i] - super[i] * slopes[i + 1];
+  return slopes;
+}
+
+std::vector<double> TabulatedFunction::ComputeMonotoneSlopes() const {
+  // Fritsch-Carlson slopes on a uniform grid: harmonic mean of the adjacent
+  // secants, zero at extrema (same as scipy's PchipInterpolator)
+  const auto& y = m_values;
+  const std::size_t n = y.size() - 1;
+  std::vector<double> delta(n);
+  for (std::size_t i = 0; i < n; i++) delta[i] = y[i + 1] - y[i];
+
+  std::vector<double> slopes(n + 1);
+  for (std::size_t i = 1; i < n; i++) {
+    const double d0 = delta[i - 1], d1 = delta[i];
+    slopes[i] = (d0 * d1 > 0) ? 2 * d0 * d1 / (d0 + d1) : 0.0;
+  }
+
+  // shape-preserving three-point end slopes
+  auto edge = [](double d0, double d1) {
+    const double slope = (3 * d0 - d1) / 2;
+    if (slope * d0 <= 0) return 0.0;
+    if (d0 * d1 < 0 && std::abs(slope) > 3 * std::abs(d0)) return 3 * d0;
+    return slope;
+  };
+  slopes[0] = edge(delta[0], delta[1]);
+  slopes[n] = edge(delta[n - 1], delta[n - 2]);
+  return slopes;
+}
+
+void TabulatedFunction::ComputeCoefficients() {
+  const auto slopes = (m_type == Spline_MONOTONE) ? ComputeMonotoneSlopes()
+                                                  : ComputeCubicSlopes();
+
+  // cubic Hermite polynomial of every interval in t = (x - x_i) / h
+  const std::size_t n = m_values.size() - 1;
+  m_coeffs.resize(4 * n);
+  double* a = m_coeffs.data();
+  double* b = a + n;
+  double* c = b + n;
+  double* d = c + n;
+  for (std::size_t i = 0; i < n; i++) {
+    const double y0 = m_values[i], y1 = m_values[i + 1];
+    const double s0 = slopes[i], s1 = slopes[i + 1];
+    a[i] = y0;
+    b[i] = s0;
+    c[i] = 3 * (y1 - y0) - 2 * s0 - s1;
+    d[i] = 2 * (y0 - y1) + s0 + s1;
+  }
+}
+
+bool TabulatedFunction::SetSimdLevel(SimdLevel level) {
+  if (level > GetSupportedSimdLevel()) return false;
+  SplineKernel_t kernel = nullptr;
+  switch (level) {
+    case Simd_SCALAR:
+      kernel = GetSplineKernelScalar();
+      break;
+    case Simd_NEON:
+      kernel = GetSplineKernelNEON();
+      break;
+    case Simd_AVX2:
+      kernel = GetSplineKernelAVX2();
+      break;
+    case Simd_AVX512:
+      kernel = GetSplineKernelAVX512();
+      break;
+  }
+  if (!kernel) return false;
+  m_level = level;
+  m_kernel = kernel;
+  return true;
+}
+
+double TabulatedFunction::Evaluate(double x) const {
+  double y;
+  Evaluate(&x, 1, &y);
+  return y;
+}
+
+void TabulatedFunction::Evaluate(const double* x, std::size_t n,
+                                 double* y) const {
+  const std::size_t intervals = m_values.size() - 1;
+  const double invDx = intervals / (m_upper - m_lower);
+  m_kernel(m_coeffs.data(), intervals, m_lower, invDx, x, n, y);
+}
+
+}  // namespace QPT
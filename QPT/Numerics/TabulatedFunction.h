@@ -0,0 +1,107 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_NUMERICS_TABULATEDFUNCTION_H_
+#define QPT_NUMERICS_TABULATEDFUNCTION_H_
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Parallel/Simd.h"
+#include "../Parallel/ThreadPool.h"
+
+namespace QPT {
+
+enum SplineType {
+  // C2 cubic spline (end slopes from one-sided differences), error O(h^4)
+  Spline_CUBIC = 0,
+  // C1 monotone cubic (Fritsch-Carlson), no overshoots, error O(h^2)
+  Spline_MONOTONE = 1,
+};
+
+// Function of one variable sampled once on a uniform grid and interpolated
+// by a spline. The spline is stored as polynomial coefficients per interval,
+// so an evaluation is a clamped index computation, four table lookups and a
+// Horner scheme without any branches. Batches are evaluated by an explicitly
+// vectorized kernel (gather instructions on AVX2 / AVX-512) that is selected
+// at runtime. Arguments outside of the grid are clamped to the grid (NaN is
+// mapped to the lower bound).
+// Tables are persisted as a dataset of the sampled values with the
+// attributes "lower", "upper" and "spline".
+class TabulatedFunction {
+ public:
+  using Function_t = std::function<double(double)>;
+
+ protected:
+  TabulatedFunction(double lower, double upper, std::vector<double> values,
+                    SplineType type);
+
+ public:
+  // spline through values[i] = f(lower + i (upper - lower) / (n - 1)),
+  // at least 4 finite values
+  static std::optional<TabulatedFunction> FromValues(
+      double lower, double upper, std::vector<double> values,
+      SplineType type = Spline_CUBIC);
+  static std::optional<TabulatedFunction> Sample(
+      const Function_t& func, double lower, double upper, std::size_t points,
+      SplineType type = Spline_CUBIC);
+  // func is evaluated in parallel (it must be thread-safe)
+  static std::optional<TabulatedFunction> Sample(
+      ThreadPool& pool, const Function_t& func, double lower, double upper,
+      std::size_t points, SplineType type = Spline_CUBIC);
+
+  static std::optional<TabulatedFunction> Load(H5Group& group,
+                                               const std::string& name);
+  bool Save(H5Group& group, const std::string& name) const;
+  // Loads the table if the group contains one with the same grid and
+  // spline type, otherwise the function is sampled and the table is saved
+  // (replacing a table with different parameters).
+  static std::optional<TabulatedFunction> LoadOrSample(
+      ThreadPool& pool, H5Group& group, const std::string& name,
+      const Function_t& func, double lower, double upper, std::size_t points,
+      SplineType type = Spline_CUBIC);
+
+  double Evaluate(double x) const;
+  double operator()(double x) const { return Evaluate(x); }
+  // y[i] = f(x[i])
+  void Evaluate(const double* x, std::size_t n, double* y) const;
+
+  // Restricts the kernel to the given instruction set. Returns false (and
+  // keeps the current kernel) if it is not supported by the CPU or was not
+  // compiled in.
+  bool SetSimdLevel(SimdLevel level);
+  SimdLevel GetSimdLevel() const { return m_level; }
+
+  double GetLowerBound() const { return m_lower; }
+  double GetUpperBound() const { return m_upper; }
+  std::size_t GetPointCount() const { return m_values.size(); }
+  const std::vector<double>& GetValues() const { return m_values; }
+  SplineType GetSplineType() const { return m_type; }
+
+ private:
+  using Kernel_t = void (*)(const double*, std::size_t, double, double,
+                            const double*, std::size_t, double*);
+
+  // slopes (per grid step) at the grid points
+  std::vector<double> ComputeCubicSlopes() const;
+  std::vector<double> ComputeMonotoneSlopes() const;
+  void ComputeCoefficients();
+
+  static const char* GetSplineTypeName(SplineType type);
+
+ private:
+  double m_lower;
+  double m_upper;
+  std::vector<double> m_values;
+  SplineType m_type;
+  // blocks a, b, c, d with one value per interval
+  std::vector<double> m_coeffs;
+  SimdLevel m_level = Simd_SCALAR;
+  Kernel_t m_kernel;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_NUMERICS_TABULATEDFUNCTION_H_
@@ -0,0 +1,55 @@
+// Philipp Neufeld, 2023
+
+// compiled with AVX2 and FMA enabled (see CMakeLists.txt)
+
+#include "TabulatedFunctionKernel.h"
+
+// MSVC does not define __FMA__, /arch:AVX2 implies FMA
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#endif
+
+namespace QPT {
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+namespace {
+
+struct SplineAvx2Pack {
+  using Type = __m256d;
+  using Index = __m128i;
+  static constexpr std::size_t Width = 4;
+
+  static Type Load(const double* p) { return _mm256_loadu_pd(p); }
+  static void Store(double* p, Type v) { _mm256_storeu_pd(p, v); }
+  static Type Broadcast(double v) { return _mm256_set1_pd(v); }
+  static Type Sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+  static Type Mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) {
+    return _mm256_fmadd_pd(a, b, c);
+  }
+  static Type Min(Type a, Type b) { return _mm256_min_pd(a, b); }
+  static Type Max(Type a, Type b) { return _mm256_max_pd(a, b); }
+  static Type Floor(Type a) { return _mm256_floor_pd(a); }
+  static Index ToIndex(Type a) { return _mm256_cvttpd_epi32(a); }
+  // masked gather with all lanes enabled: the zeroed source avoids reading
+  // an uninitialized register (-Wmaybe-uninitialized)
+  static Type Gather(const double* base, Index idx) {
+    const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx, mask, 8);
+  }
+};
+
+}  // namespace
+
+SplineKernel_t GetSplineKernelAVX2() {
+  return &EvaluateSpline<SplineAvx2Pack>;
+}
+
+#else
+
+SplineKernel_t GetSplineKernelAVX2() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
@@ -0,0 +1,54 @@
+// Philipp Neufeld, 2023
+
+// compiled with AVX-512F enabled (see CMakeLists.txt)
+
+#include "TabulatedFunctionKernel.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace QPT {
+
+#if defined(__AVX512F__)
+
+namespace {
+
+struct SplineAvx512Pack {
+  using Type = __m512d;
+  using Index = __m256i;
+  static constexpr std::size_t Width = 8;
+
+  static Type Load(const double* p) { return _mm512_loadu_pd(p); }
+  static void Store(double* p, Type v) { _mm512_storeu_pd(p, v); }
+  static Type Broadcast(double v) { return _mm512_set1_pd(v); }
+  static Type Sub(Type a, Type b) { return _mm512_sub_pd(a, b); }
+  static Type Mul(Type a, Type b) { return _mm512_mul_pd(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) {
+    return _mm512_fmadd_pd(a, b, c);
+  }
+  static Type Min(Type a, Type b) { return _mm512_min_pd(a, b); }
+  static Type Max(Type a, Type b) { return _mm512_max_pd(a, b); }
+  static Type Floor(Type a) {
+    return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+  }
+  static Index ToIndex(Type a) { return _mm512_cvttpd_epi32(a); }
+  // masked gather with all lanes enabled (see TabulatedFunctionAVX2.cpp)
+  static Type Gather(const double* base, Index idx) {
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, base, 8);
+  }
+};
+
+}  // namespace
+
+SplineKernel_t GetSplineKernelAVX512() {
+  return &EvaluateSpline<SplineAvx512Pack>;
+}
+
+#else
+
+SplineKernel_t GetSplineKernelAVX512() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
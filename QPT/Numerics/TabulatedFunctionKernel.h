@@ -0,0 +1,97 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_NUMERICS_TABULATEDFUNCTIONKERNEL_H_
+#define QPT_NUMERICS_TABULATEDFUNCTIONKERNEL_H_
+
+// Internal header of the spline kernels. Every kernel translation unit is
+// compiled for its own instruction set, therefore everything in this header
+// has internal linkage (see FaddeevaKernel.h).
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace QPT {
+
+// y[i] = s(x[i]) for the spline with the polynomial coefficients coeffs
+// (blocks a, b, c, d of intervals values each, s = a + t (b + t (c + t d))
+// with the local coordinate t in [0, 1]) on the uniform grid starting at x0
+// with the inverse spacing invDx
+using SplineKernel_t = void (*)(const double* coeffs, std::size_t intervals,
+                                double x0, double invDx, const double* x,
+                                std::size_t n, double* y);
+
+// nullptr if the kernel was not compiled for the instruction set
+SplineKernel_t GetSplineKernelScalar();
+SplineKernel_t GetSplineKernelNEON();
+SplineKernel_t GetSplineKernelAVX2();
+SplineKernel_t GetSplineKernelAVX512();
+
+namespace {
+
+struct SplineScalarPack {
+  using Type = double;
+  using Index = std::int32_t;
+  static constexpr std::size_t Width = 1;
+
+  static Type Load(const double* p) { return *p; }
+  static void Store(double* p, Type v) { *p = v; }
+  static Type Broadcast(double v) { return v; }
+  static Type Sub(Type a, Type b) { return a - b; }
+  static Type Mul(Type a, Type b) { return a * b; }
+  // a * b + c
+  static Type MulAdd(Type a, Type b, Type c) { return a * b + c; }
+  // b if a is NaN (like the x86 instructions)
+  static Type Min(Type a, Type b) { return (a < b) ? a : b; }
+  static Type Max(Type a, Type b) { return (a > b) ? a : b; }
+  static Type Floor(Type a) { return std::floor(a); }
+  // a is integral and within the table
+  static Index ToIndex(Type a) { return static_cast<Index>(a); }
+  static Type Gather(const double* base, Index idx) { return base[idx]; }
+};
+
+// Pack provides the operations of SplineScalarPack for Pack::Width doubles
+template <typename Pack>
+void EvaluateSpline(const double* coeffs, std::size_t intervals, double x0,
+                    double invDx, const double* x, std::size_t n, double* y) {
+  using P = Pack;
+  using V = typename Pack::Type;
+  const double* a = coeffs;
+  const double* b = coeffs + intervals;
+  const double* c = coeffs + 2 * intervals;
+  const double* d = coeffs + 3 * intervals;
+  const V origin = P::Broadcast(x0);
+  const V scale = P::Broadcast(invDx);
+  const V zero = P::Broadcast(0.0);
+  const V upper = P::Broadcast(static_cast<double>(intervals));
+  const V last = P::Broadcast(static_cast<double>(intervals - 1));
+
+  std::size_t i = 0;
+  for (; i + P::Width <= n; i += P::Width) {
+    // grid coordinate clamped to the table (NaN maps to the lower bound),
+    // the upper bound belongs to the last interval (t = 1)
+    V u = P::Mul(P::Sub(P::Load(x + i), origin), scale);
+    u = P::Min(P::Max(u, zero), upper);
+    const V k = P::Min(P::Floor(u), last);
+    const V t = P::Sub(u, k);
+    const auto idx = P::ToIndex(k);
+
+    V s = P::Gather(d, idx);
+    s = P::MulAdd(s, t, P::Gather(c, idx));
+    s = P::MulAdd(s, t, P::Gather(b, idx));
+    s = P::MulAdd(s, t, P::Gather(a, idx));
+    P::Store(y + i, s);
+  }
+
+  // remainder
+  if (i < n) {
+    EvaluateSpline<SplineScalarPack>(coeffs, intervals, x0, invDx, x + i,
+                                     n - i, y + i);
+  }
+}
+
+}  // namespace
+
+}  // namespace QPT
+
+#endif  // !QPT_NUMERICS_TABULATEDFUNCTIONKERNEL_H_
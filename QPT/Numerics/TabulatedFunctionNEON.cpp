@@ -0,0 +1,52 @@
+// Philipp Neufeld, 2023
+
+#include "TabulatedFunctionKernel.h"
+
+#include "../Platform.h"
+
+#if defined(QPT_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace QPT {
+
+#if defined(QPT_ARCH_ARM64)
+
+namespace {
+
+struct SplineNeonPack {
+  using Type = float64x2_t;
+  using Index = int64x2_t;
+  static constexpr std::size_t Width = 2;
+
+  static Type Load(const double* p) { return vld1q_f64(p); }
+  static void Store(double* p, Type v) { vst1q_f64(p, v); }
+  static Type Broadcast(double v) { return vdupq_n_f64(v); }
+  static Type Sub(Type a, Type b) { return vsubq_f64(a, b); }
+  static Type Mul(Type a, Type b) { return vmulq_f64(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) { return vfmaq_f64(c, a, b); }
+  // b if a is NaN
+  static Type Min(Type a, Type b) { return vbslq_f64(vcltq_f64(a, b), a, b); }
+  static Type Max(Type a, Type b) { return vbslq_f64(vcgtq_f64(a, b), a, b); }
+  static Type Floor(Type a) { return vrndmq_f64(a); }
+  static Index ToIndex(Type a) { return vcvtq_s64_f64(a); }
+  // no gather instruction: two scalar loads
+  static Type Gather(const double* base, Index idx) {
+    const Type lo = vld1q_dup_f64(base + vgetq_lane_s64(idx, 0));
+    return vld1q_lane_f64(base + vgetq_lane_s64(idx, 1), lo, 1);
+  }
+};
+
+}  // namespace
+
+SplineKernel_t GetSplineKernelNEON() {
+  return &EvaluateSpline<SplineNeonPack>;
+}
+
+#else
+
+SplineKernel_t GetSplineKernelNEON() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
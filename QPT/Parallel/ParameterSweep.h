@@ -0,0 +1,345 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_PARALLEL_PARAMETERSWEEP_H_
+#define QPT_PARALLEL_PARAMETERSWEEP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../HDF5/H5Group.h"
+#include "../Serialization.h"
+#include "ThreadPool.h"
+
+namespace QPT {
+
+// Maps a function over a multi-dimensional parameter grid. The grid points
+// are enumerated in row-major order (last axis varies fastest) and the result
+// of point i is stored as row i of the dataset "results" inside the sweep
+// group. A second dataset "completed" marks the rows that have been written,
+// so that an interrupted sweep can be resumed by running it again.
+// A sweep can be split into partitions (e.g. one per process): partition k
+// of p only owns the points k, k + p, k + 2p, ... and its datasets hold only
+// these rows. Merge combines the partitions into a complete sweep.
+class ParameterSweep {
+ public:
+  ParameterSweep(H5Group group) : m_group(std::move(group)) {}
+
+  void AddAxis(const std::string& name, std::vector<double> values) {
+    m_axes.emplace_back(name, std::move(values));
+  }
+  std::size_t GetAxisCount() const { return m_axes.size(); }
+  std::vector<std::size_t> GetGridShape() const;
+  std::size_t GetPointCount() const;
+  std::vector<double> GetPoint(std::size_t index) const;
+
+  // Restricts the sweep to the points of partition part of parts
+  // (interleaved such that the cost along the axes is balanced)
+  void SetPartition(std::size_t parts, std::size_t part) {
+    m_parts = std::max<std::size_t>(parts, 1);
+    m_part = std::min(part, m_parts - 1);
+  }
+  // number of points owned by the partition
+  std::size_t GetLocalPointCount() const;
+  // grid index of the local point (row of the datasets)
+  std::size_t GetGlobalIndex(std::size_t local) const {
+    return m_part + local * m_parts;
+  }
+
+  // Number of results that are buffered before they are written to the file.
+  // Smaller values lose less work if the process is killed.
+  void SetWriteBatchSize(std::size_t size) {
+    m_batchSize = std::max<std::size_t>(size, 1);
+  }
+
+  // Evaluates func(point) -> T for every point that is not yet marked as
+  // completed. resultShape is the (fixed) shape of a single result. Returns
+  // the number of points that have been evaluated (0 for an empty
+  // partition) or std::nullopt if the datasets could not be created or do
+  // not match an earlier run.
+  template <typename Func>
+  std::optional<std::size_t> Run(ThreadPool& pool,
+                                 const std::vector<std::size_t>& resultShape,
+                                 Func&& func);
+
+  // Completion state of a (possibly partial) earlier run
+  std::optional<std::vector<std::uint8_t>> GetCompleted();
+
+  // Combines the partitions (shard k holds partition k of shards.size(),
+  // same axes) into this unpartitioned sweep. Points that are not
+  // completed in their shard stay incomplete. Returns the number of
+  // completed points.
+  template <typename T>
+  std::optional<std::size_t> Merge(std::vector<H5Group> shards,
+                                   const std::vector<std::size_t>& resultShape);
+
+ private:
+  bool WriteAxes();
+  bool CheckAxes();
+
+  template <typename T>
+  std::optional<H5Dataset> PrepareResults(
+      const std::vector<std::size_t>& resultShape);
+  std::optional<H5Dataset> PrepareCompleted();
+
+ private:
+  H5Group m_group;
+  std::vector<std::pair<std::string, std::vector<double>>> m_axes;
+  std::size_t m_batchSize = 64;
+  std::size_t m_parts = 1;
+  std::size_t m_part = 0;
+};
+
+// Function definitions
+inline std::vector<std::size_t> ParameterSweep::GetGridShape() const {
+  std::vector<std::size_t> shape;
+  for (const auto& axis : m_axes) shape.push_back(axis.second.size());
+  return shape;
+}
+
+inline std::size_t ParameterSweep::GetPointCount() const {
+  if (m_axes.empty()) return 0;
+  const auto shape = GetGridShape();
+  return std::accumulate(shape.begin(), shape.end(), std::size_t(1),
+                         std::multiplies<std::size_t>());
+}
+
+inline std::vector<double> ParameterSweep::GetPoint(std::size_t index) const {
+  std::vector<double> point(m_axes.size());
+  for (std::size_t i = m_axes.size(); i-- > 0;) {
+    const auto& values = m_axes[i].second;
+    point[i] = values[index % values.size()];
+    index /= values.size();
+  }
+  return point;
+}
+
+inline std::size_t ParameterSweep::GetLocalPointCount() const {
+  const std::size_t n = GetPointCount();
+  return (n > m_part) ? (n - m_part + m_parts - 1) / m_parts : 0;
+}
+
+inline std::optional<std::vector<std::uint8_t>>
+ParameterSweep::GetCompleted() {
+  if (!m_group.HasDataset("completed")) return std::nullopt;
+  return m_group.OpenExistingDataset("completed")
+      ->Get<std::vector<std::uint8_t>>();
+}
+
+inline bool ParameterSweep::WriteAxes() {
+  const std::vector<std::uint64_t> partition = {m_parts, m_part};
+  if (!m_group.SetAttribute("axis_count", std::uint64_t(m_axes.size())) ||
+      !m_group.SetAttribute("partition", partition))
+    return false;
+  for (std::size_t i = 0; i < m_axes.size(); i++) {
+    const auto prefix = "axis" + std::to_string(i);
+    // the values are a dataset, attributes are limited to 64 KiB
+    m_group.Remove(prefix);
+    if (!m_group.SetAttribute(prefix + "_name", m_axes[i].first) ||
+        !m_group.CreateDataset(prefix, m_axes[i].second))
+      return false;
+  }
+  return true;
+}
+
+inline bool ParameterSweep::CheckAxes() {
+  auto count = m_group.GetAttribute<std::uint64_t>("axis_count");
+  if (!count || *count != m_axes.size()) return false;
+  const std::vector<std::uint64_t> partition = {m_parts, m_part};
+  if (m_group.GetAttribute<std::vector<std::uint64_t>>("partition") !=
+      partition)
+    return false;
+  for (std::size_t i = 0; i < m_axes.size(); i++) {
+    const auto prefix = "axis" + std::to_string(i);
+    const auto name = m_group.GetAttribute<std::string>(prefix + "_name");
+    if (name != m_axes[i].first || !m_group.HasDataset(prefix)) return false;
+    const auto values =
+        m_group.OpenExistingDataset(prefix)->Get<std::vector<double>>();
+    if (values != m_axes[i].second) return false;
+  }
+  return true;
+}
+
+template <typename T>
+inline std::optional<H5Dataset> ParameterSweep::PrepareResults(
+    const std::vector<std::size_t>& resultShape) {
+  std::vector<std::size_t> shape = {GetLocalPointCount()};
+  shape.insert(shape.end(), resultShape.begin(), resultShape.end());
+
+  if (m_group.HasDataset("results")) {
+    auto ds = m_group.OpenExistingDataset("results");
+    if (!ds || ds->GetShape() != shape) return std::nullopt;
+    return ds;
+  }
+  return m_group.CreateUninitializedDataset<T>("results", shape);
+}
+
+inline std::optional<H5Dataset> ParameterSweep::PrepareCompleted() {
+  if (m_group.HasDataset("completed")) {
+    auto ds = m_group.OpenExistingDataset("completed");
+    if (!ds ||
+        ds->GetShape() != std::vector<std::size_t>{GetLocalPointCount()})
+      return std::nullopt;
+    return ds;
+  }
+  return m_group.CreateDataset(
+      "completed", std::vector<std::uint8_t>(GetLocalPointCount(), 0));
+}
+
+template <typename Func>
+std::optional<std::size_t> ParameterSweep::Run(
+    ThreadPool& pool, const std::vector<std::size_t>& resultShape,
+    Func&& func) {
+  using Result_t =
+      std::decay_t<std::invoke_result_t<Func, const std::vector<double>&>>;
+  using Storage_t = typename SerializationTraits<Result_t>::Storage_t;
+  const std::size_t n = GetLocalPointCount();
+  // more partitions than points: nothing to do (skipped by Merge)
+  if (n == 0) return 0;
+
+  // resume if the group already contains a matching sweep
+  const bool resume = m_group.HasDataset("completed");
+  if (resume ? !CheckAxes() : !WriteAxes()) return std::nullopt;
+  auto results = PrepareResults<Result_t>(resultShape);
+  auto completedDs = PrepareCompleted();
+  if (!results || !completedDs) return std::nullopt;
+
+  std::vector<std::uint8_t> completed(n, 0);
+  if (resume && !completedDs->Get(completed)) return std::nullopt;
+
+  std::vector<std::size_t> todo;
+  for (std::size_t i = 0; i < n; i++) {
+    if (!completed[i]) todo.push_back(i);
+  }
+
+  // HDF5 is not thread-safe: results are collected in a buffer and written
+  // in batches by whichever worker fills the buffer. The full buffer is
+  // swapped out, so the other workers keep buffering during the write.
+  const std::size_t rowSize =
+      std::accumulate(resultShape.begin(), resultShape.end(), std::size_t(1),
+                      std::multiplies<std::size_t>());
+  using Batch_t = std::vector<std::pair<std::size_t, std::vector<Storage_t>>>;
+
+  std::mutex mutex, writeMutex;
+  Batch_t buffer;
+  bool success = true;       // guarded by mutex
+  bool writeSuccess = true;  // guarded by writeMutex
+
+  // writes every run of consecutive indices with a single hyperslab
+  auto write = [&](Batch_t batch) {
+    if (batch.empty()) return;
+    std::sort(batch.begin(), batch.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::unique_lock<std::mutex> lock(writeMutex);
+    std::vector<Storage_t> rows;
+    std::vector<std::uint8_t> done;
+    for (std::size_t i = 0; i < batch.size() && writeSuccess;) {
+      std::size_t j = i + 1;
+      while (j < batch.size() && batch[j].first == batch[j - 1].first + 1) j++;
+      rows.clear();
+      for (std::size_t k = i; k < j; k++)
+        rows.insert(rows.end(), batch[k].second.begin(),
+                    batch[k].second.end());
+      done.assign(j - i, 1);
+
+      std::vector<std::size_t> offset(resultShape.size() + 1, 0);
+      std::vector<std::size_t> count = {j - i};
+      offset[0] = batch[i].first;
+      count.insert(count.end(), resultShape.begin(), resultShape.end());
+      writeSuccess =
+          results->SetSlabData(offset, count, rows.data(), false) &&
+          completedDs->SetSlabData({batch[i].first}, {j - i}, done.data(),
+                                   false);
+      i = j;
+    }
+    // a killed process keeps the completed rows of all flushed batches
+    writeSuccess = writeSuccess && m_group.Flush();
+  };
+
+  pool.ParallelFor(0, todo.size(), [&](std::size_t i) {
+    const std::size_t idx = todo[i];
+    const auto result = func(GetPoint(GetGlobalIndex(idx)));
+    auto ser = Serialize(result);
+    if (ser.GetSize() != rowSize) {
+      std::unique_lock<std::mutex> lock(mutex);
+      success = false;
+      return;
+    }
+
+    std::vector<Storage_t> row(ser.GetData(), ser.GetData() + rowSize);
+    Batch_t full;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      buffer.emplace_back(idx, std::move(row));
+      if (buffer.size() < m_batchSize) return;
+      full.swap(buffer);
+    }
+    write(std::move(full));
+  });
+  write(std::move(buffer));
+
+  return success && writeSuccess ? std::make_optional(todo.size())
+                                 : std::nullopt;
+}
+
+template <typename T>
+std::optional<std::size_t> ParameterSweep::Merge(
+    std::vector<H5Group> shards, const std::vector<std::size_t>& resultShape) {
+  using Storage_t = typename SerializationTraits<T>::Storage_t;
+  const std::size_t n = GetPointCount();
+  if (n == 0 || shards.empty() || m_parts != 1) return std::nullopt;
+  const std::size_t rowSize =
+      std::accumulate(resultShape.begin(), resultShape.end(), std::size_t(1),
+                      std::multiplies<std::size_t>());
+
+  // the shards are gathered in memory and written with a single call
+  std::vector<Storage_t> results(n * rowSize);
+  std::vector<std::uint8_t> completed(n, 0);
+  for (std::size_t k = 0; k < shards.size(); k++) {
+    ParameterSweep shard(std::move(shards[k]));
+    shard.m_axes = m_axes;
+    shard.SetPartition(shards.size(), k);
+    const std::size_t local = shard.GetLocalPointCount();
+    if (local == 0) continue;
+    if (!shard.m_group.HasDataset("completed") || !shard.CheckAxes())
+      return std::nullopt;
+    auto shardResults = shard.PrepareResults<T>(resultShape);
+    auto shardCompleted = shard.GetCompleted();
+    if (!shardResults || !shardCompleted) return std::nullopt;
+
+    std::vector<Storage_t> rows(local * rowSize);
+    if (!shardResults->GetSlabData(std::vector<std::size_t>(
+                                       resultShape.size() + 1, 0),
+                                   shardResults->GetShape(), rows.data()))
+      return std::nullopt;
+    for (std::size_t i = 0; i < local; i++) {
+      if (!(*shardCompleted)[i]) continue;
+      const std::size_t idx = shard.GetGlobalIndex(i);
+      std::copy_n(rows.data() + i * rowSize, rowSize,
+                  results.data() + idx * rowSize);
+      completed[idx] = 1;
+    }
+  }
+
+  if (m_group.HasDataset("completed") ? !CheckAxes() : !WriteAxes())
+    return std::nullopt;
+  auto resultsDs = PrepareResults<T>(resultShape);
+  auto completedDs = PrepareCompleted();
+  if (!resultsDs || !completedDs) return std::nullopt;
+  std::vector<std::size_t> shape = {n};
+  shape.insert(shape.end(), resultShape.begin(), resultShape.end());
+  if (!resultsDs->SetSlabData(std::vector<std::size_t>(shape.size(), 0),
+                              shape, results.data()) ||
+      !completedDs->Set(completed))
+    return std::nullopt;
+  return std::count(completed.begin(), completed.end(), 1);
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_PARALLEL_PARAMETERSWEEP_H_
@@ -0,0 +1,67 @@
+// Philipp Neufeld, 2023
+
+#include "Simd.h"
+
+#if defined(QPT_ARCH_X86_64) && defined(QPT_COMPILER_MSVC)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace QPT {
+
+namespace {
+
+SimdLevel DetectSimdLevel() {
+#if defined(QPT_ARCH_X86_64) && \
+    (defined(QPT_COMPILER_GNUC) || defined(QPT_COMPILER_CLANG))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma"))
+    return Simd_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return Simd_AVX2;
+  return Simd_SCALAR;
+#elif defined(QPT_ARCH_X86_64) && defined(QPT_COMPILER_MSVC)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return Simd_SCALAR;
+  __cpuid(info, 1);
+  const bool fma = (info[2] & (1 << 12)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!fma || !osxsave) return Simd_SCALAR;
+  // the operating system must save the (upper) vector registers
+  const unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+  const bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+  if (avx512) return Simd_AVX512;
+  if (avx2) return Simd_AVX2;
+  return Simd_SCALAR;
+#elif defined(QPT_ARCH_ARM64)
+  // Advanced SIMD is mandatory on aarch64
+  return Simd_NEON;
+#else
+  return Simd_SCALAR;
+#endif
+}
+
+}  // namespace
+
+SimdLevel GetSupportedSimdLevel() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+const char* GetSimdLevelName(SimdLevel level) {
+  switch (level) {
+    case Simd_NEON:
+      return "NEON";
+    case Simd_AVX2:
+      return "AVX2";
+    case Simd_AVX512:
+      return "AVX-512";
+    default:
+      return "scalar";
+  }
+}
+
+}  // namespace QPT
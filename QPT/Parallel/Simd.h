@@ -0,0 +1,27 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_PARALLEL_SIMD_H_
+#define QPT_PARALLEL_SIMD_H_
+
+#include "../Platform.h"
+
+namespace QPT {
+
+// Instruction set levels of the explicitly vectorized kernels. The levels
+// are ordered: a CPU supporting a level supports all lower levels of the
+// same architecture.
+enum SimdLevel {
+  Simd_SCALAR = 0,
+  Simd_NEON = 1,    // 2 doubles (aarch64)
+  Simd_AVX2 = 2,    // 4 doubles, AVX2 + FMA (x86-64)
+  Simd_AVX512 = 3,  // 8 doubles, AVX-512F (x86-64)
+};
+
+// Highest level supported by the CPU and the operating system (detected
+// once at runtime)
+SimdLevel GetSupportedSimdLevel();
+const char* GetSimdLevelName(SimdLevel level);
+
+}  // namespace QPT
+
+#endif  // !QPT_PARALLEL_SIMD_H_
@@ -0,0 +1,120 @@
+// Philipp Neufeld, 2023
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "../Profiling/Profiler.h"
+
+namespace QPT {
+
+namespace {
+// identifies the pool (and the slot within it) the current thread works for
+thread_local const ThreadPool* g_workerPool = nullptr;
+thread_local std::size_t g_workerIndex = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+    : m_pending(0), m_nextQueue(0), m_stop(false) {
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  m_queues.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; i++)
+    m_queues.push_back(std::make_unique<TaskQueue>());
+
+  m_workers.reserve(threadCount);
+  for (std::size_t i = 0; i < threadCount; i++)
+    m_workers.emplace_back([this, i]() { WorkerMain(i); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_stop = true;
+  }
+  m_wakeup.notify_all();
+  for (auto& worker : m_workers) worker.join();
+}
+
+std::optional<std::size_t> ThreadPool::GetWorkerIndex() const {
+  if (g_workerPool != this) return std::nullopt;
+  return g_workerIndex;
+}
+
+bool ThreadPool::RunPendingTask() {
+  Task_t task;
+  const auto self = GetWorkerIndex();
+  if (!Pop(self.value_or(0), task)) return false;
+  task();
+  return true;
+}
+
+void ThreadPool::Push(Task_t task) {
+  const auto self = GetWorkerIndex();
+  const std::size_t idx =
+      self ? *self : (m_nextQueue.fetch_add(1) % m_queues.size());
+  m_pending.fetch_add(1);
+  {
+    std::unique_lock<std::mutex> lock(m_queues[idx]->mutex);
+    m_queues[idx]->tasks.push_back(std::move(task));
+  }
+
+  // taking the lock guarantees that a worker that is about to sleep has
+  // either seen the new task or is already waiting for the notification
+  { std::unique_lock<std::mutex> lock(m_sleepMutex); }
+  m_wakeup.notify_one();
+}
+
+bool ThreadPool::Pop(std::size_t self, Task_t& task) {
+  if (m_pending.load() == 0) return false;
+
+  // own queue first (LIFO)
+  {
+    auto& queue = *m_queues[self];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      m_pending.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // steal from the other queues (FIFO)
+  const std::size_t n = m_queues.size();
+  for (std::size_t i = 1; i < n; i++) {
+    auto& queue = *m_queues[(self + i) % n];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      m_pending.fetch_sub(1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::WorkerMain(std::size_t index) {
+  g_workerPool = this;
+  g_workerIndex = index;
+  QPT_PROFILE_THREAD_NAME("worker " + std::to_string(index));
+
+  Task_t task;
+  while (true) {
+    if (Pop(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_wakeup.wait(lock, [this]() { return m_stop || m_pending.load() > 0; });
+    if (m_stop && m_pending.load() == 0) break;
+  }
+}
+
+}  // namespace QPT
@@ -0,0 +1,152 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_PARALLEL_THREADPOOL_H_
+#define QPT_PARALLEL_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace QPT {
+
+// Work-stealing thread pool. Every worker owns a task deque: it pops its own
+// tasks from the back (LIFO, cache friendly) and steals from the front of the
+// other workers' deques when it runs dry. Tasks submitted from inside a worker
+// are pushed onto that worker's deque, external submissions are distributed
+// round-robin.
+class ThreadPool {
+ public:
+  // threadCount == 0 selects std::thread::hardware_concurrency()
+  explicit ThreadPool(std::size_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  std::size_t GetThreadCount() const { return m_workers.size(); }
+
+  // Index of the calling thread within this pool (std::nullopt if the calling
+  // thread is not a worker of this pool)
+  std::optional<std::size_t> GetWorkerIndex() const;
+
+  template <typename Func>
+  std::future<std::invoke_result_t<std::decay_t<Func>>> Submit(Func&& func);
+
+  // Calls func(i) for every i in [begin, end). Iterations are grouped into
+  // tasks of grainSize iterations. Blocks until all iterations are done; the
+  // calling thread participates in the work (safe to nest). The first
+  // exception thrown by func is rethrown after all iterations are done.
+  template <typename Func>
+  void ParallelFor(std::size_t begin, std::size_t end, Func&& func,
+                   std::size_t grainSize = 1);
+
+  // Calls func(blockBegin, blockEnd) for consecutive blocks of at most
+  // blockSize iterations covering [begin, end).
+  template <typename Func>
+  void ParallelForBlocks(std::size_t begin, std::size_t end,
+                         std::size_t blockSize, Func&& func);
+
+  // Executes one pending task on the calling thread. Returns false if no task
+  // was available.
+  bool RunPendingTask();
+
+ private:
+  using Task_t = std::function<void()>;
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<Task_t> tasks;
+  };
+
+  void Push(Task_t task);
+  bool Pop(std::size_t self, Task_t& task);
+  void WorkerMain(std::size_t index);
+
+ private:
+  std::vector<std::unique_ptr<TaskQueue>> m_queues;
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeup;
+  std::atomic<std::size_t> m_pending;
+  std::atomic<std::size_t> m_nextQueue;
+  std::atomic<bool> m_stop;
+};
+
+// Template function definitions
+template <typename Func>
+std::future<std::invoke_result_t<std::decay_t<Func>>> ThreadPool::Submit(
+    Func&& func) {
+  using Result_t = std::invoke_result_t<std::decay_t<Func>>;
+  auto task = std::make_shared<std::packaged_task<Result_t()>>(
+      std::forward<Func>(func));
+  auto future = task->get_future();
+  Push([task]() { (*task)(); });
+  return future;
+}
+
+template <typename Func>
+void ThreadPool::ParallelForBlocks(std::size_t begin, std::size_t end,
+                                   std::size_t blockSize, Func&& func) {
+  if (end <= begin) return;
+  if (blockSize == 0) blockSize = 1;
+
+  const std::size_t blockCount = (end - begin + blockSize - 1) / blockSize;
+  std::atomic<std::size_t> remaining = blockCount;
+
+  // The tasks refer to this stack frame, i.e. every block is counted as done
+  // even if it throws and the first exception is only rethrown once all
+  // blocks have finished.
+  std::exception_ptr error;
+  std::mutex errorMutex;
+  auto run = [&func, &remaining, &error, &errorMutex](std::size_t b,
+                                                       std::size_t e) {
+    try {
+      func(b, e);
+    } catch (...) {
+      std::unique_lock<std::mutex> lock(errorMutex);
+      if (!error) error = std::current_exception();
+    }
+    remaining.fetch_sub(1, std::memory_order_acq_rel);
+  };
+
+  // the last block is executed by the calling thread itself
+  for (std::size_t blk = 0; blk + 1 < blockCount; blk++) {
+    const std::size_t b = begin + blk * blockSize;
+    const std::size_t e = b + blockSize;
+    Push([&run, b, e]() { run(b, e); });
+  }
+  run(begin + (blockCount - 1) * blockSize, end);
+
+  // help out while waiting for the other blocks
+  while (remaining.load(std::memory_order_acquire) != 0) {
+    if (!RunPendingTask()) std::this_thread::yield();
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+template <typename Func>
+void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, Func&& func,
+                             std::size_t grainSize) {
+  ParallelForBlocks(begin, end, grainSize,
+                    [&func](std::size_t b, std::size_t e) {
+                      for (std::size_t i = b; i < e; i++) func(i);
+                    });
+}
+
+}  // namespace QPT
+
+#endif  // !QPT_PARALLEL_THREADPOOL_H_
@@ -0,0 +1,318 @@
+// Philipp Neufeld, 2023
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "../HDF5/H5Group.h"
+
+namespace QPT {
+
+namespace {
+// buffers of the recording threads (ordered by thread) and of exited threads
+// whose events were not collected yet (exited) or were collected (free)
+struct ProfilerRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ProfileRingBuffer>> buffers;
+  std::vector<ProfileRingBuffer*> exited;
+  std::vector<ProfileRingBuffer*> free;
+  std::vector<std::string> threadNames;
+  std::size_t capacity = 1 << 15;
+};
+
+ProfilerRegistry& GetRegistry() {
+  static ProfilerRegistry registry;
+  return registry;
+}
+
+// returns the buffer of the thread to the registry when the thread exits
+struct ThreadBufferOwner {
+  ~ThreadBufferOwner();
+  ProfileRingBuffer* buffer = nullptr;
+};
+
+thread_local ProfileRingBuffer* g_threadBuffer = nullptr;
+thread_local ThreadBufferOwner g_threadBufferOwner;
+
+ThreadBufferOwner::~ThreadBufferOwner() {
+  if (!buffer) return;
+  g_threadBuffer = nullptr;
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  registry.exited.push_back(buffer);
+}
+
+// capacity of a ProfileRingBuffer
+std::size_t RoundCapacity(std::size_t capacity) {
+  std::size_t size = 1;
+  while (size < capacity) size *= 2;
+  return size;
+}
+
+// registry lock held, the events of exited threads have been collected
+void ReleaseExitedBuffers(ProfilerRegistry& registry) {
+  registry.free.insert(registry.free.end(), registry.exited.begin(),
+                       registry.exited.end());
+  registry.exited.clear();
+}
+
+ProfileRingBuffer& GetThreadBuffer() {
+  if (!g_threadBuffer) {
+    auto& registry = GetRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    const auto thread =
+        static_cast<std::uint32_t>(registry.threadNames.size());
+    registry.threadNames.push_back("thread " + std::to_string(thread));
+
+    std::unique_ptr<ProfileRingBuffer> buffer;
+    if (!registry.free.empty()) {
+      auto it = std::find_if(
+          registry.buffers.begin(), registry.buffers.end(),
+          [&](const auto& ptr) { return ptr.get() == registry.free.back(); });
+      buffer = std::move(*it);
+      registry.buffers.erase(it);
+      registry.free.pop_back();
+    }
+    // a changed capacity applies to recycled buffers as well
+    if (buffer && buffer->GetCapacity() == RoundCapacity(registry.capacity))
+      buffer->Reset(thread);
+    else
+      buffer = std::make_unique<ProfileRingBuffer>(thread, registry.capacity);
+    registry.buffers.push_back(std::move(buffer));
+    g_threadBuffer = registry.buffers.back().get();
+    g_threadBufferOwner.buffer = g_threadBuffer;
+  }
+  return *g_threadBuffer;
+}
+
+std::uint64_t GetFirstTime(const std::vector<ProfileEvent>& events) {
+  std::uint64_t first = events.empty() ? 0 : events.front().time;
+  for (const auto& ev : events) first = std::min(first, ev.time);
+  return first;
+}
+
+void WriteJsonString(std::ostream& os, std::string_view str) {
+  os << '"';
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+      os << buffer;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+// microseconds with ns resolution
+std::string FormatMicroseconds(std::uint64_t ns) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3f", ns * 1e-3);
+  return buffer;
+}
+}  // namespace
+
+//
+// ProfileRingBuffer
+//
+
+ProfileRingBuffer::ProfileRingBuffer(std::uint32_t thread,
+                                     std::size_t capacity)
+    : m_thread(thread) {
+  m_events.resize(RoundCapacity(capacity));
+  m_mask = m_events.size() - 1;
+}
+
+std::uint64_t ProfileRingBuffer::GetDroppedCount() const {
+  const std::uint64_t count = m_head.load(std::memory_order_acquire) -
+                              m_tail.load(std::memory_order_relaxed);
+  return count > m_events.size() ? count - m_events.size() : 0;
+}
+
+void ProfileRingBuffer::Collect(std::vector<ProfileEvent>& events) const {
+  const std::uint64_t capacity = m_events.size();
+  const std::uint64_t head = m_head.load(std::memory_order_acquire);
+  const std::uint64_t first =
+      std::max(m_tail.load(std::memory_order_relaxed),
+               head > capacity ? head - capacity : 0);
+  const std::size_t offset = events.size();
+  for (std::uint64_t i = first; i < head; i++)
+    events.push_back(m_events[i & m_mask]);
+
+  // Drop the events the owner overwrote while they were copied. Push writes
+  // the slot of event newHead before publishing it, i.e. that slot (the one
+  // of event newHead - capacity) may be torn as well.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const std::uint64_t newHead = m_head.load(std::memory_order_relaxed);
+  if (newHead + 1 > first + capacity) {
+    const std::uint64_t lost = std::min(newHead + 1 - capacity, head) - first;
+    events.erase(events.begin() + offset, events.begin() + offset + lost);
+  }
+}
+
+void ProfileRingBuffer::Clear() {
+  m_tail.store(m_head.load(std::memory_order_acquire),
+               std::memory_order_relaxed);
+}
+
+void ProfileRingBuffer::Reset(std::uint32_t thread) {
+  Clear();
+  m_thread = thread;
+}
+
+//
+// Profiler
+//
+
+void Profiler::RecordScope(const char* name, std::uint64_t begin,
+                           std::uint64_t end) {
+  auto& buffer = GetThreadBuffer();
+  buffer.Push({name, buffer.GetThread(), ProfileEvent_SCOPE, begin,
+               end - begin, 0.0});
+}
+
+void Profiler::RecordCounter(const char* name, double value) {
+  auto& buffer = GetThreadBuffer();
+  buffer.Push({name, buffer.GetThread(), ProfileEvent_COUNTER, GetTime(), 0,
+               value});
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  const std::uint32_t thread = GetThreadBuffer().GetThread();
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  registry.threadNames[thread] = name;
+}
+
+void Profiler::SetBufferCapacity(std::size_t capacity) {
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  registry.capacity = std::max<std::size_t>(capacity, 1);
+}
+
+std::vector<ProfileEvent> Profiler::Collect() {
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  std::vector<ProfileEvent> events;
+  for (const auto& buffer : registry.buffers) buffer->Collect(events);
+  ReleaseExitedBuffers(registry);
+  return events;
+}
+
+std::vector<std::string> Profiler::GetThreadNames() {
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  return registry.threadNames;
+}
+
+std::uint64_t Profiler::GetDroppedCount() {
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  std::uint64_t dropped = 0;
+  for (const auto& buffer : registry.buffers)
+    dropped += buffer->GetDroppedCount();
+  return dropped;
+}
+
+void Profiler::Clear() {
+  auto& registry = GetRegistry();
+  std::unique_lock<std::mutex> lock(registry.mutex);
+  for (const auto& buffer : registry.buffers) buffer->Clear();
+  ReleaseExitedBuffers(registry);
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filename) {
+  const auto events = Collect();
+  const auto threadNames = GetThreadNames();
+  const std::uint64_t first = GetFirstTime(events);
+
+  std::ofstream os(filename);
+  if (!os) return false;
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool separator = false;
+  for (std::size_t i = 0; i < threadNames.size(); i++) {
+    os << (separator ? ",\n" : "\n")
+       << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << i
+       << ",\"args\":{\"name\":";
+    WriteJsonString(os, threadNames[i]);
+    os << "}}";
+    separator = true;
+  }
+  for (const auto& ev : events) {
+    os << (separator ? ",\n" : "\n") << "{\"name\":";
+    WriteJsonString(os, ev.name);
+    os << ",\"pid\":1,\"tid\":" << ev.thread
+       << ",\"ts\":" << FormatMicroseconds(ev.time - first);
+    if (ev.type == ProfileEvent_SCOPE) {
+      os << ",\"ph\":\"X\",\"dur\":" << FormatMicroseconds(ev.duration)
+         << "}";
+    } else {
+      // JSON has no representation of inf and nan
+      char value[32] = "null";
+      if (std::isfinite(ev.value))
+        std::snprintf(value, sizeof(value), "%.17g", ev.value);
+      os << ",\"ph\":\"C\",\"args\":{";
+      WriteJsonString(os, ev.name);
+      os << ":" << value << "}}";
+    }
+    separator = true;
+  }
+  os << "\n]}\n";
+  return bool(os);
+}
+
+bool Profiler::WriteH5(H5Group& group) {
+  const auto events = Collect();
+  const std::uint64_t first = GetFirstTime(events);
+
+  // names of different events may share the pointer or not
+  H5StringTable names;
+  std::unordered_map<std::string_view, std::uint32_t> nameIndices;
+  std::vector<std::uint32_t> scopeThreads, scopeNames;
+  std::vector<double> scopeBegins, scopeDurations;
+  std::vector<std::uint32_t> counterThreads, counterNames;
+  std::vector<double> counterTimes, counterValues;
+  for (const auto& ev : events) {
+    auto [it, inserted] = nameIndices.emplace(
+        ev.name, static_cast<std::uint32_t>(names.GetCount()));
+    if (inserted) names.Add(ev.name);
+    if (ev.type == ProfileEvent_SCOPE) {
+      scopeThreads.push_back(ev.thread);
+      scopeNames.push_back(it->second);
+      scopeBegins.push_back((ev.time - first) * 1e-9);
+      scopeDurations.push_back(ev.duration * 1e-9);
+    } else {
+      counterThreads.push_back(ev.thread);
+      counterNames.push_back(it->second);
+      counterTimes.push_back((ev.time - first) * 1e-9);
+      counterValues.push_back(ev.value);
+    }
+  }
+
+  if (group.HasSubgroup("scopes") || group.HasSubgroup("counters"))
+    return false;
+  auto scopes = group.OpenSubgroup("scopes");
+  auto counters = group.OpenSubgroup("counters");
+  return group.CreateStringDataset("threads", GetThreadNames()) &&
+         group.CreateStringDataset("names", names) && scopes &&
+         scopes->CreateDataset("thread", scopeThreads) &&
+         scopes->CreateDataset("name", scopeNames) &&
+         scopes->CreateDataset("begin", scopeBegins) &&
+         scopes->CreateDataset("duration", scopeDurations) && counters &&
+         counters->CreateDataset("thread", counterThreads) &&
+         counters->CreateDataset("name", counterNames) &&
+         counters->CreateDataset("time", counterTimes) &&
+         counters->CreateDataset("value", counterValues);
+}
+
+}  // namespace QPT
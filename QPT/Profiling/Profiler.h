@@ -0,0 +1,157 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_PROFILING_PROFILER_H_
+#define QPT_PROFILING_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Instrumentation macros. They expand to nothing unless QPT_PROFILING is
+// defined (CMake option QPT_ENABLE_PROFILING), i.e. the arguments are not
+// evaluated in regular builds. Names must be string literals (only the
+// pointer is recorded).
+//   QPT_PROFILE_SCOPE("name")          times the enclosing scope
+//   QPT_PROFILE_COUNTER("name", value) records the value of a counter
+//   QPT_PROFILE_THREAD_NAME(name)      names the calling thread in traces
+#ifdef QPT_PROFILING
+#define QPT_PROFILE_CONCAT_IMPL(a, b) a##b
+#define QPT_PROFILE_CONCAT(a, b) QPT_PROFILE_CONCAT_IMPL(a, b)
+#define QPT_PROFILE_SCOPE(name) \
+  ::QPT::ProfileScope QPT_PROFILE_CONCAT(qptProfileScope, __LINE__)(name)
+#define QPT_PROFILE_COUNTER(name, value) \
+  ::QPT::Profiler::RecordCounter(name, value)
+#define QPT_PROFILE_THREAD_NAME(name) ::QPT::Profiler::SetThreadName(name)
+#else
+#define QPT_PROFILE_SCOPE(name) ((void)0)
+#define QPT_PROFILE_COUNTER(name, value) ((void)0)
+#define QPT_PROFILE_THREAD_NAME(name) ((void)0)
+#endif  // QPT_PROFILING
+
+namespace QPT {
+
+class H5Group;
+
+enum ProfileEventType {
+  ProfileEvent_SCOPE = 0,
+  ProfileEvent_COUNTER = 1,
+};
+
+struct ProfileEvent {
+  const char* name;
+  std::uint32_t thread;
+  ProfileEventType type;
+  // steady clock time in ns (begin of a scope)
+  std::uint64_t time;
+  // scopes only
+  std::uint64_t duration;
+  // counters only
+  double value;
+};
+
+// Fixed size event buffer of a single thread. The owning thread pushes
+// without locking and overwrites the oldest events when the buffer is full;
+// any thread may collect the events concurrently. The events themselves are
+// plain (non-atomic) data, a concurrent Collect is a seqlock style read: it
+// copies the slots and afterwards drops every event whose slot the owner
+// may have written in the meantime, including the slot of the push that is
+// still in progress, so torn copies are never returned.
+class ProfileRingBuffer {
+ public:
+  // capacity is rounded up to a power of two
+  ProfileRingBuffer(std::uint32_t thread, std::size_t capacity);
+
+  std::uint32_t GetThread() const { return m_thread; }
+  std::size_t GetCapacity() const { return m_events.size(); }
+  // number of events lost because the buffer was full
+  std::uint64_t GetDroppedCount() const;
+
+  // owning thread only
+  void Push(const ProfileEvent& event) {
+    const std::uint64_t head = m_head.load(std::memory_order_relaxed);
+    m_events[head & m_mask] = event;
+    m_head.store(head + 1, std::memory_order_release);
+  }
+
+  void Collect(std::vector<ProfileEvent>& events) const;
+  void Clear();
+  // hands the (cleared) buffer to a new owning thread, no concurrent Push
+  void Reset(std::uint32_t thread);
+
+ private:
+  std::uint32_t m_thread;
+  std::uint64_t m_mask;
+  std::vector<ProfileEvent> m_events;
+  // total number of pushed events, events before m_tail were cleared
+  std::atomic<std::uint64_t> m_head{0};
+  std::atomic<std::uint64_t> m_tail{0};
+};
+
+// Process wide collection of the events of all threads. Every thread records
+// into its own ProfileRingBuffer (created on its first event), so recording
+// never locks. The buffer of an exited thread is kept until its events were
+// collected (Collect, Write*) or cleared and is then reused by the next new
+// thread, i.e. short-lived threads do not accumulate buffers. The traces can
+// be written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) or into
+// a HDF5 group.
+class Profiler {
+ public:
+  static constexpr bool IsEnabled() {
+#ifdef QPT_PROFILING
+    return true;
+#else
+    return false;
+#endif  // QPT_PROFILING
+  }
+
+  static std::uint64_t GetTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  static void RecordScope(const char* name, std::uint64_t begin,
+                          std::uint64_t end);
+  static void RecordCounter(const char* name, double value);
+  static void SetThreadName(const std::string& name);
+
+  // events per thread, applies to threads that did not record yet
+  static void SetBufferCapacity(std::size_t capacity);
+
+  // events of all threads (ordered by thread and time of recording)
+  static std::vector<ProfileEvent> Collect();
+  static std::vector<std::string> GetThreadNames();
+  static std::uint64_t GetDroppedCount();
+  static void Clear();
+
+  // Times are relative to the first event. The HDF5 timeline consists of the
+  // string datasets "threads" and "names" and the subgroups "scopes"
+  // (datasets "thread", "name", "begin", "duration") and "counters"
+  // ("thread", "name", "time", "value"); names and threads are indices into
+  // the string datasets, times are given in seconds.
+  static bool WriteChromeTrace(const std::string& filename);
+  static bool WriteH5(H5Group& group);
+};
+
+// Records the lifetime of the object as a scope (see QPT_PROFILE_SCOPE)
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char* name)
+      : m_name(name), m_begin(Profiler::GetTime()) {}
+  ~ProfileScope() {
+    Profiler::RecordScope(m_name, m_begin, Profiler::GetTime());
+  }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  const char* m_name;
+  std::uint64_t m_begin;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_PROFILING_PROFILER_H_
@@ -0,0 +1,100 @@
+// Philipp Neufeld, 2023
+
+#include "AlkaliAtom.h"
+
+#include <cmath>
+
+#include "../Constants.h"
+
+namespace QPT {
+
+AlkaliAtom::AlkaliAtom(const std::string& name, double mass,
+                       double ionizationEnergy, double corePolarizability)
+    : m_name(name),
+      m_mass(mass),
+      m_ionizationEnergy(ionizationEnergy),
+      m_corePolarizability(corePolarizability) {
+  // reduced mass correction of the Rydberg constant (m^-1 -> cm^-1)
+  const double massRatio = ElectronMass_v / (mass * AtomicMassUnit_v);
+  m_rydbergConstant = 0.01 * RydbergConstant_v / (1 + massRatio);
+}
+
+AlkaliAtom AlkaliAtom::Rubidium87() {
+  // Li et al., PRA 67, 052502 (2003); Han et al., PRA 74, 054502 (2006);
+  // Mack et al., PRA 83, 052515 (2011)
+  AlkaliAtom atom("Rb87", 86.909180527, 33690.94629, 9.0760);
+  atom.SetQuantumDefect(0, 0.5, {3.1311804, 0.1784});
+  atom.SetQuantumDefect(1, 0.5, {2.6548849, 0.2900});
+  atom.SetQuantumDefect(1, 1.5, {2.6416737, 0.2950});
+  atom.SetQuantumDefect(2, 1.5, {1.34809171, -0.60286});
+  atom.SetQuantumDefect(2, 2.5, {1.34646572, -0.59600});
+  atom.SetQuantumDefect(3, 2.5, {0.0165192, -0.085});
+  atom.SetQuantumDefect(3, 3.5, {0.0165437, -0.086});
+  return atom;
+}
+
+AlkaliAtom AlkaliAtom::Cesium133() {
+  // Weber and Sansonetti, PRA 35, 4650 (1987); Goy et al., PRA 26, 2733
+  // (1982); Deiglmayr et al., PRA 93, 013424 (2016)
+  AlkaliAtom atom("Cs133", 132.905451935, 31406.4677325, 15.6440);
+  atom.SetQuantumDefect(0, 0.5, {4.0493532, 0.2391});
+  atom.SetQuantumDefect(1, 0.5, {3.5915871, 0.36273});
+  atom.SetQuantumDefect(1, 1.5, {3.5590676, 0.37469});
+  atom.SetQuantumDefect(2, 1.5, {2.475365, 0.5554});
+  atom.SetQuantumDefect(2, 2.5, {2.4663144, 0.01381});
+  atom.SetQuantumDefect(3, 2.5, {0.033392, -0.191});
+  atom.SetQuantumDefect(3, 3.5, {0.033537, -0.191});
+  return atom;
+}
+
+void AlkaliAtom::SetQuantumDefect(int l, double j,
+                                  const std::vector<double>& series) {
+  const RydbergState key{0, l, j};
+  m_defects[{l, key.GetTwoJ()}] = series;
+}
+
+std::vector<double> AlkaliAtom::GetModelParameters() const {
+  std::vector<double> params = {m_mass, m_ionizationEnergy,
+                                m_corePolarizability};
+  for (const auto& [key, series] : m_defects) {
+    params.insert(params.end(), {double(key.first), double(key.second),
+                                 double(series.size())});
+    params.insert(params.end(), series.begin(), series.end());
+  }
+  return params;
+}
+
+double AlkaliAtom::GetCoreRadius() const {
+  return std::cbrt(m_corePolarizability);
+}
+
+double AlkaliAtom::GetQuantumDefect(const RydbergState& state) const {
+  auto it = m_defects.find({state.l, state.GetTwoJ()});
+  if (it == m_defects.end() || it->second.empty()) return 0.0;
+
+  const auto& series = it->second;
+  const double x = 1 / std::pow(state.n - series[0], 2);
+  double defect = 0, power = 1;
+  for (double coeff : series) {
+    defect += coeff * power;
+    power *= x;
+  }
+  return defect;
+}
+
+double AlkaliAtom::GetEffectivePrincipalNumber(
+    const RydbergState& state) const {
+  return state.n - GetQuantumDefect(state);
+}
+
+double AlkaliAtom::GetEnergy(const RydbergState& state) const {
+  const double nu = GetEffectivePrincipalNumber(state);
+  return -m_rydbergConstant * EnergyInverseCm_v / (nu * nu);
+}
+
+double AlkaliAtom::GetTransitionFrequency(const RydbergState& from,
+                                          const RydbergState& to) const {
+  return (GetEnergy(to) - GetEnergy(from)) / PlanckConstant_v;
+}
+
+}  // namespace QPT
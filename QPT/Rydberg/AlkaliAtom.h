@@ -0,0 +1,71 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_RYDBERG_ALKALIATOM_H_
+#define QPT_RYDBERG_ALKALIATOM_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace QPT {
+
+// Fine structure state |n, l, j> of the valence electron
+struct RydbergState {
+  int n;
+  int l;
+  double j;
+
+  // 2j is integral and used as key
+  int GetTwoJ() const { return static_cast<int>(2 * j + 0.5); }
+};
+
+// Quantum defect model of an alkali atom. The binding energy of the state
+// |n, l, j> is E = -hc R_M / (n - delta)^2 with the modified Rydberg-Ritz
+// series delta = d0 + d2 / (n - d0)^2 + d4 / (n - d0)^4 + ...
+// Orbital angular momenta without a series have a vanishing defect.
+class AlkaliAtom {
+ public:
+  // mass in atomic mass units, ionization energy in cm^-1 and the dipole
+  // polarizability of the ionic core in atomic units (a0^3)
+  AlkaliAtom(const std::string& name, double mass, double ionizationEnergy,
+             double corePolarizability);
+
+  static AlkaliAtom Rubidium87();
+  static AlkaliAtom Cesium133();
+
+  // Rydberg-Ritz coefficients (d0, d2, d4, ...) of the series (l, j)
+  void SetQuantumDefect(int l, double j, const std::vector<double>& series);
+
+  const std::string& GetName() const { return m_name; }
+  // All parameters of the model (mass, ionization energy, core
+  // polarizability and every series as l, 2j, length, coefficients), e.g. to
+  // detect outdated cached results
+  std::vector<double> GetModelParameters() const;
+  double GetMass() const { return m_mass; }
+  // mass corrected Rydberg constant in cm^-1
+  double GetRydbergConstant() const { return m_rydbergConstant; }
+  double GetIonizationEnergy() const { return m_ionizationEnergy; }
+  // radius (a0) below which the potential is not hydrogenic
+  double GetCoreRadius() const;
+
+  double GetQuantumDefect(const RydbergState& state) const;
+  double GetEffectivePrincipalNumber(const RydbergState& state) const;
+  // energy relative to the ionization threshold (J)
+  double GetEnergy(const RydbergState& state) const;
+  // (E_to - E_from) / h in Hz
+  double GetTransitionFrequency(const RydbergState& from,
+                                const RydbergState& to) const;
+
+ private:
+  std::string m_name;
+  double m_mass;
+  double m_ionizationEnergy;
+  double m_corePolarizability;
+  double m_rydbergConstant;
+  std::map<std::pair<int, int>, std::vector<double>> m_defects;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_RYDBERG_ALKALIATOM_H_
@@ -0,0 +1,147 @@
+// Philipp Neufeld, 2023
+
+#include "NumerovIntegrator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace QPT {
+
+NumerovIntegrator::NumerovIntegrator(const AlkaliAtom& atom, double step)
+    : m_atom(atom), m_step(step) {}
+
+RadialWavefunction NumerovIntegrator::Integrate(
+    const RydbergState& state) const {
+  RadialWavefunction wf;
+  IntegrateBatch(&state, 1, &wf);
+  return wf;
+}
+
+std::vector<RadialWavefunction> NumerovIntegrator::Integrate(
+    ThreadPool& pool, const std::vector<RydbergState>& states) const {
+  // states of similar size share a batch such that few lanes idle
+  std::vector<std::size_t> order(states.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<double> nu(states.size());
+  for (std::size_t i = 0; i < states.size(); i++)
+    nu[i] = m_atom.GetEffectivePrincipalNumber(states[i]);
+  std::sort(order.begin(), order.end(),
+            [&](std::size_t a, std::size_t b) { return nu[a] < nu[b]; });
+
+  std::vector<RadialWavefunction> result(states.size());
+  const std::size_t batches = (states.size() + BatchSize - 1) / BatchSize;
+  pool.ParallelFor(0, batches, [&](std::size_t batch) {
+    const std::size_t begin = batch * BatchSize;
+    const std::size_t count = std::min(BatchSize, states.size() - begin);
+    RydbergState batchStates[BatchSize] = {};
+    RadialWavefunction batchResult[BatchSize];
+    for (std::size_t s = 0; s < count; s++)
+      batchStates[s] = states[order[begin + s]];
+    IntegrateBatch(batchStates, count, batchResult);
+    for (std::size_t s = 0; s < count; s++)
+      result[order[begin + s]] = std::move(batchResult[s]);
+  });
+  return result;
+}
+
+void NumerovIntegrator::IntegrateBatch(const RydbergState* states,
+                                       std::size_t count,
+                                       RadialWavefunction* output) const {
+  constexpr std::size_t B = BatchSize;
+  const double h = m_step;
+  const double h12 = h * h / 12;
+  const double coreRadius = m_atom.GetCoreRadius();
+
+  // lane parameters (unused lanes stay at rest)
+  double centrifugal[B] = {}, energy[B] = {}, innerTurning[B] = {};
+  std::size_t start[B] = {}, core[B] = {}, stop[B] = {};
+  std::size_t maxStart = 0;
+  for (std::size_t s = 0; s < count; s++) {
+    const double nu = m_atom.GetEffectivePrincipalNumber(states[s]);
+    const double l = states[s].l;
+    centrifugal[s] = (2 * l + 0.5) * (2 * l + 1.5);
+    energy[s] = 4 / (nu * nu);
+    innerTurning[s] = centrifugal[s] / 8;
+    start[s] = static_cast<std::size_t>(std::sqrt(2 * nu * (nu + 15)) / h);
+    core[s] = static_cast<std::size_t>(std::ceil(std::sqrt(coreRadius) / h));
+    core[s] = std::max<std::size_t>(core[s], 1);
+    maxStart = std::max(maxStart, start[s]);
+  }
+
+  // tile[i * B + s] = psi_s(x_i)
+  std::vector<double> tile((maxStart + 1) * B, 0.0);
+  double prev[B] = {}, cur[B] = {}, gPrev[B] = {}, gCur[B] = {};
+  double alive[B];
+  for (std::size_t s = 0; s < B; s++) alive[s] = s < count ? 1.0 : 0.0;
+
+  // psi_{i-1} (1 - h^2 g_{i-1} / 12) =
+  //   2 psi_i (1 + 5 h^2 g_i / 12) - psi_{i+1} (1 - h^2 g_{i+1} / 12)
+  // Lanes are zero above their starting point and are seeded there.
+  for (std::size_t i = maxStart; i >= 1; i--) {
+    const double x = i * h;
+    const double x2 = x * x;
+    double* row = tile.data() + i * B;
+    for (std::size_t s = 0; s < B; s++) {
+      const double g = centrifugal[s] / x2 - 8 + energy[s] * x2;
+      double y = (2 * (1 + 5 * h12 * gCur[s]) * cur[s] -
+                  (1 - h12 * gPrev[s]) * prev[s]) /
+                 (1 - h12 * g);
+      y = (i == start[s]) ? 1e-10 : y;
+      // stop at the core or where the solution diverges towards the origin
+      const bool diverges =
+          (x2 < innerTurning[s]) && (std::abs(y) > std::abs(cur[s]));
+      const bool stopped = (i < core[s]) || diverges;
+      stop[s] = (stopped && alive[s] != 0) ? i + 1 : stop[s];
+      alive[s] = stopped ? 0.0 : alive[s];
+      y *= alive[s];
+
+      row[s] = y;
+      prev[s] = cur[s];
+      cur[s] = y;
+      gPrev[s] = gCur[s];
+      gCur[s] = g;
+    }
+  }
+
+  for (std::size_t s = 0; s < count; s++) {
+    const std::size_t first = std::max<std::size_t>(stop[s], 1);
+    auto& wf = output[s];
+    wf.offset = first;
+    wf.values.resize(start[s] + 1 - first);
+
+    // normalization: int R^2 r^2 dr = 2 int psi^2 x^2 dx
+    double norm = 0;
+    for (std::size_t i = first; i <= start[s]; i++) {
+      const double psi = tile[i * B + s];
+      wf.values[i - first] = psi;
+      norm += psi * psi * (i * h) * (i * h);
+    }
+    norm = std::sqrt(2 * h * norm);
+    for (auto& v : wf.values) v /= norm;
+  }
+}
+
+std::optional<double> NumerovIntegrator::GetRadialIntegral(
+    const RadialWavefunction& a, const RadialWavefunction& b, int k) const {
+  if (k < 0) return std::nullopt;
+  // <a| r^k |b> = 2 int psi_a psi_b x^(2k + 2) dx
+  const std::size_t first = std::max(a.offset, b.offset);
+  const std::size_t last = std::min(a.offset + a.values.size(),
+                                    b.offset + b.values.size());
+  if (first >= last) return 0.0;
+
+  const double* pa = a.values.data() + (first - a.offset);
+  const double* pb = b.values.data() + (first - b.offset);
+  const double h = m_step;
+  double sum = 0;
+  for (std::size_t i = 0; i < last - first; i++) {
+    const double x2 = (first + i) * h * (first + i) * h;
+    double weight = x2;
+    for (int p = 0; p < k; p++) weight *= x2;
+    sum += pa[i] * pb[i] * weight;
+  }
+  return 2 * h * sum;
+}
+
+}  // namespace QPT
@@ -0,0 +1,66 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_RYDBERG_NUMEROVINTEGRATOR_H_
+#define QPT_RYDBERG_NUMEROVINTEGRATOR_H_
+
+#include <optional>
+#include <vector>
+
+#include "../Parallel/ThreadPool.h"
+#include "AlkaliAtom.h"
+
+namespace QPT {
+
+// Scaled radial wavefunction psi(x) = x^(3/2) R(r) on the grid x_i = i * h
+// with x = sqrt(r / a0). Only the values of the grid points
+// [offset, offset + values.size()) are stored, psi vanishes elsewhere.
+struct RadialWavefunction {
+  std::size_t offset = 0;
+  std::vector<double> values;
+};
+
+// Radial wavefunctions of the quantum defect model: the hydrogenic radial
+// equation is integrated inwards at the energy E = -1 / (2 nu^2) (atomic
+// units) from r = 2 nu (nu + 15) down to the core radius or the inner
+// classical turning point where the solution starts to diverge (Zimmerman et
+// al., PRA 20, 2251 (1979)). In x = sqrt(r) the equation reads
+//   psi''(x) = [(2l + 1/2)(2l + 3/2) / x^2 - 8 + 4 x^2 / nu^2] psi(x)
+// and is solved with the Numerov method on a common grid such that the
+// integrals of any two wavefunctions are plain dot products. Several states
+// are integrated in lockstep (one SIMD lane per state). Wavefunctions are
+// normalized and positive in their outermost lobe.
+class NumerovIntegrator {
+ public:
+  explicit NumerovIntegrator(const AlkaliAtom& atom, double step = 0.01);
+
+  double GetStep() const { return m_step; }
+  const AlkaliAtom& GetAtom() const { return m_atom; }
+
+  RadialWavefunction Integrate(const RydbergState& state) const;
+  // Integrates all states in batches of similar size, the batches are
+  // distributed over the thread pool. The result has the order of states.
+  std::vector<RadialWavefunction> Integrate(
+      ThreadPool& pool, const std::vector<RydbergState>& states) const;
+
+  // Radial integral <a| r^k |b> = int R_a R_b r^(2 + k) dr in units of a0^k
+  // (std::nullopt for negative k)
+  std::optional<double> GetRadialIntegral(const RadialWavefunction& a,
+                                          const RadialWavefunction& b,
+                                          int k) const;
+
+ private:
+  // lockstep integration of up to BatchSize states
+  void IntegrateBatch(const RydbergState* states, std::size_t count,
+                      RadialWavefunction* output) const;
+
+ public:
+  static constexpr std::size_t BatchSize = 8;
+
+ private:
+  AlkaliAtom m_atom;
+  double m_step;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_RYDBERG_NUMEROVINTEGRATOR_H_
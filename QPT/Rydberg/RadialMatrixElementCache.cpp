@@ -0,0 +1,200 @@
+// Philipp Neufeld, 2023
+
+#include "RadialMatrixElementCache.h"
+
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+
+namespace QPT {
+
+std::optional<RadialMatrixElementCache> RadialMatrixElementCache::Open(
+    const std::string& filename, const AlkaliAtom& atom, double step) {
+  auto file = H5File::Open(filename, H5File_DEFAULT);
+  if (!file) return std::nullopt;
+
+  // a table computed with another step size or model is outdated
+  const auto& name = atom.GetName();
+  const auto model = atom.GetModelParameters();
+  if (file->HasSubgroup(name)) {
+    auto group = file->OpenSubgroup(name);
+    if (!group) return std::nullopt;
+    const bool outdated =
+        group->GetAttribute<double>("step") != step ||
+        group->GetAttribute<std::vector<double>>("model") != model;
+    if (outdated && !file->Remove(name)) return std::nullopt;
+  }
+
+  auto group = file->OpenSubgroup(name);
+  if (!group || !group->SetAttribute("step", step) ||
+      !group->SetAttribute("model", model))
+    return std::nullopt;
+  return RadialMatrixElementCache(std::move(*file), std::move(*group),
+                                  NumerovIntegrator(atom, step));
+}
+
+RadialMatrixElementCache::RadialMatrixElementCache(
+    H5File file, H5Group group, const NumerovIntegrator& integrator)
+    : m_file(std::move(file)),
+      m_group(std::move(group)),
+      m_integrator(integrator) {}
+
+std::size_t RadialMatrixElementCache::GetSize() const {
+  std::size_t size = 0;
+  for (const auto& table : m_tables) size += table.second.size();
+  return size;
+}
+
+std::size_t RadialMatrixElementCache::KeyHash::operator()(
+    const Key_t& key) const {
+  std::size_t hash = 0;
+  for (auto v : key) hash = hash * 1000003 + static_cast<std::uint32_t>(v);
+  return hash;
+}
+
+RadialMatrixElementCache::Key_t RadialMatrixElementCache::GetKey(
+    const RydbergState& a, const RydbergState& b) {
+  Key_t key = {a.n, a.l, a.GetTwoJ(), b.n, b.l, b.GetTwoJ()};
+  if (std::lexicographical_compare(key.begin() + 3, key.end(), key.begin(),
+                                   key.begin() + 3))
+    std::swap_ranges(key.begin(), key.begin() + 3, key.begin() + 3);
+  return key;
+}
+
+std::string RadialMatrixElementCache::GetTableName(int k) {
+  return "r" + std::to_string(k);
+}
+
+RadialMatrixElementCache::Table_t& RadialMatrixElementCache::LoadTable(int k) {
+  auto it = m_tables.find(k);
+  if (it != m_tables.end()) return it->second;
+
+  auto& table = m_tables[k];
+  const auto name = GetTableName(k);
+  if (!m_group.HasSubgroup(name)) return table;
+  auto group = m_group.OpenSubgroup(name);
+  if (!group) return table;
+  auto keyDs = group->OpenExistingDataset("keys");
+  auto valueDs = group->OpenExistingDataset("values");
+  if (!keyDs || !valueDs) return table;
+
+  const auto keyShape = keyDs->GetShape();
+  const auto valueShape = valueDs->GetShape();
+  if (keyShape.size() != 2 || keyShape[1] != 6 || valueShape.size() != 1)
+    return table;
+
+  // rows of an interrupted append are ignored (and dropped by Store)
+  const std::size_t count = std::min(keyShape[0], valueShape[0]);
+  std::vector<Key_t> keys(count);
+  std::vector<double> values(count);
+  if (!keyDs->GetSlabData({0, 0}, {count, 6}, keys.data()->data()) ||
+      !valueDs->GetSlabData({0}, {count}, values.data()))
+    return table;
+  table.reserve(keys.size());
+  for (std::size_t i = 0; i < keys.size(); i++) table[keys[i]] = values[i];
+  return table;
+}
+
+bool RadialMatrixElementCache::Store(int k, const std::vector<Key_t>& keys,
+                                     const std::vector<double>& values) {
+  auto group = m_group.OpenSubgroup(GetTableName(k));
+  if (!group) return false;
+
+  auto keyDs = group->HasDataset("keys")
+                   ? group->OpenExistingDataset("keys")
+                   : group->CreateAppendableDataset<std::int32_t>("keys", {6});
+  auto valueDs = group->HasDataset("values")
+                     ? group->OpenExistingDataset("values")
+                     : group->CreateAppendableDataset<double>("values", {});
+  if (!keyDs || !valueDs) return false;
+
+  // Drop the rows of an interrupted append (only in one of the datasets),
+  // otherwise all later keys and values would be misaligned
+  const auto keyShape = keyDs->GetShape();
+  const auto valueShape = valueDs->GetShape();
+  if (keyShape.empty() || valueShape.empty()) return false;
+  const std::size_t count = std::min(keyShape[0], valueShape[0]);
+  if ((keyShape[0] != count && !keyDs->SetRowCount(count)) ||
+      (valueShape[0] != count && !valueDs->SetRowCount(count)))
+    return false;
+
+  return valueDs->AppendData(values.size(), values.data()) &&
+         keyDs->AppendData(keys.size(), keys.data()->data()) &&
+         m_file.Flush();
+}
+
+std::optional<double> RadialMatrixElementCache::Find(const RydbergState& a,
+                                                     const RydbergState& b,
+                                                     int k) {
+  if (k < 0) return std::nullopt;
+  const auto& table = LoadTable(k);
+  auto it = table.find(GetKey(a, b));
+  if (it == table.end()) return std::nullopt;
+  return it->second;
+}
+
+std::optional<double> RadialMatrixElementCache::Get(const RydbergState& a,
+                                                    const RydbergState& b,
+                                                    int k) {
+  if (auto value = Find(a, b, k)) return value;
+
+  if (k < 0) return std::nullopt;
+  const auto wfA = m_integrator.Integrate(a);
+  const auto wfB = m_integrator.Integrate(b);
+  const double value = *m_integrator.GetRadialIntegral(wfA, wfB, k);
+
+  const auto key = GetKey(a, b);
+  if (!Store(k, {key}, {value})) return std::nullopt;
+  LoadTable(k)[key] = value;
+  return value;
+}
+
+std::optional<std::vector<double>> RadialMatrixElementCache::Get(
+    ThreadPool& pool, const std::vector<StatePair_t>& pairs, int k) {
+  if (k < 0) return std::nullopt;
+  auto& table = LoadTable(k);
+
+  // distinct missing elements and the distinct states they involve
+  std::vector<Key_t> missing;
+  std::unordered_set<Key_t, KeyHash> missingKeys;
+  std::vector<RydbergState> states;
+  std::map<std::array<std::int32_t, 3>, std::size_t> stateIndex;
+  std::vector<std::pair<std::size_t, std::size_t>> missingStates;
+  auto addState = [&](const RydbergState& state) {
+    const std::array<std::int32_t, 3> key = {state.n, state.l,
+                                             state.GetTwoJ()};
+    auto res = stateIndex.emplace(key, states.size());
+    if (res.second) states.push_back(state);
+    return res.first->second;
+  };
+  for (const auto& pair : pairs) {
+    const auto key = GetKey(pair.first, pair.second);
+    if (table.count(key) != 0 || !missingKeys.insert(key).second) continue;
+    missing.push_back(key);
+    missingStates.emplace_back(addState(pair.first), addState(pair.second));
+  }
+
+  if (!missing.empty()) {
+    const auto wavefunctions = m_integrator.Integrate(pool, states);
+    std::vector<double> values(missing.size());
+    pool.ParallelFor(
+        0, missing.size(),
+        [&](std::size_t i) {
+          const auto& wfA = wavefunctions[missingStates[i].first];
+          const auto& wfB = wavefunctions[missingStates[i].second];
+          values[i] = *m_integrator.GetRadialIntegral(wfA, wfB, k);
+        },
+        64);
+
+    if (!Store(k, missing, values)) return std::nullopt;
+    for (std::size_t i = 0; i < missing.size(); i++)
+      table[missing[i]] = values[i];
+  }
+
+  std::vector<double> result(pairs.size());
+  for (std::size_t i = 0; i < pairs.size(); i++)
+    result[i] = table.at(GetKey(pairs[i].first, pairs[i].second));
+  return result;
+}
+
+}  // namespace QPT
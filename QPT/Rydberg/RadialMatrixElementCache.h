@@ -0,0 +1,86 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_RYDBERG_RADIALMATRIXELEMENTCACHE_H_
+#define QPT_RYDBERG_RADIALMATRIXELEMENTCACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../HDF5/H5File.h"
+#include "NumerovIntegrator.h"
+
+namespace QPT {
+
+// Persistent memo table of radial integrals <a| r^k |b> (a0^k). Elements that
+// are not in the table are computed with a NumerovIntegrator and appended to
+// the cache file, later runs load the table on open.
+// File layout:
+//   /<atom>                 attributes "step" (Numerov step size) and
+//                           "model" (AlkaliAtom::GetModelParameters)
+//   /<atom>/r<k>/keys       int32 [N, 6] rows (n_a, l_a, 2j_a, n_b, l_b, 2j_b)
+//   /<atom>/r<k>/values     double [N]
+// The table of an atom is discarded if it was computed with another step or
+// other model parameters. Negative powers k are rejected (std::nullopt).
+// Rows beyond the length of the shorter dataset (left by an interrupted
+// append) are ignored and truncated before the next append.
+class RadialMatrixElementCache {
+ public:
+  using StatePair_t = std::pair<RydbergState, RydbergState>;
+
+  static std::optional<RadialMatrixElementCache> Open(
+      const std::string& filename, const AlkaliAtom& atom, double step = 0.01);
+
+ private:
+  RadialMatrixElementCache(H5File file, H5Group group,
+                           const NumerovIntegrator& integrator);
+
+ public:
+  const NumerovIntegrator& GetIntegrator() const { return m_integrator; }
+  // number of elements in the tables loaded so far
+  std::size_t GetSize() const;
+
+  // cached element (no computation)
+  std::optional<double> Find(const RydbergState& a, const RydbergState& b,
+                             int k);
+
+  // cached or newly computed element. std::nullopt if the new element could
+  // not be written to the cache file.
+  std::optional<double> Get(const RydbergState& a, const RydbergState& b,
+                            int k);
+  // Elements of all pairs: the wavefunctions of all states of missing pairs
+  // are integrated once (in parallel), then the missing integrals are
+  // evaluated in parallel and appended to the file in a single write.
+  std::optional<std::vector<double>> Get(ThreadPool& pool,
+                                         const std::vector<StatePair_t>& pairs,
+                                         int k);
+
+ private:
+  using Key_t = std::array<std::int32_t, 6>;
+  struct KeyHash {
+    std::size_t operator()(const Key_t& key) const;
+  };
+  using Table_t = std::unordered_map<Key_t, double, KeyHash>;
+
+  // <a|r^k|b> = <b|r^k|a>: the smaller state comes first
+  static Key_t GetKey(const RydbergState& a, const RydbergState& b);
+  static std::string GetTableName(int k);
+
+  Table_t& LoadTable(int k);
+  bool Store(int k, const std::vector<Key_t>& keys,
+             const std::vector<double>& values);
+
+ private:
+  H5File m_file;
+  H5Group m_group;
+  NumerovIntegrator m_integrator;
+  std::unordered_map<int, Table_t> m_tables;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_RYDBERG_RADIALMATRIXELEMENTCACHE_H_
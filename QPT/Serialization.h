@@ -6,6 +6,7 @@
 // Includes
 #include <array>
 #include <cassert>
+#include <complex>
 #include <cstdint>
 #include <list>
 #include <numeric>
@@ -35,7 +36,7 @@ struct SerializationTraits<volatile T, void> : SerializationTraits<T> {};
 using SerializationTrivialNatives_t =
     Typelist<std::int8_t, std::uint8_t, std::int16_t, std::uint16_t,
              std::int32_t, std::uint32_t, std::int64_t, std::uint64_t, float,
-             double, char>;
+             double, char, std::complex<float>, std::complex<double>>;
 template <typename T>
 constexpr static bool IsSerializationTrivialNative_v =
     TypelistContains_v<SerializationTrivialNatives_t, T>;
@@ -0,0 +1,312 @@
+// Philipp Neufeld, 2023
+
+#include "DopplerAverager.h"
+
+#include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../Constants.h"
+
+namespace QPT {
+
+GaussHermiteRule GaussHermiteRule::Create(std::size_t order) {
+  // Nodes: eigenvalues of the Jacobi matrix of the Hermite polynomials
+  // (Golub-Welsch), polished by one Newton step. Weights: inverse of the
+  // Christoffel function 1 / sum_k p_k(x)^2 of the orthonormal polynomials.
+  // The recurrence is rescaled to avoid overflow for large nodes (the
+  // corresponding weights underflow to zero).
+  constexpr double invPi4 = 0.7511255444649425;  // pi^(-1/4)
+  constexpr double scale = 1e-150;
+
+  const std::size_t n = order;
+  GaussHermiteRule rule;
+  if (n == 0) return rule;
+
+  Eigen::VectorXd diag = Eigen::VectorXd::Zero(n);
+  Eigen::VectorXd subdiag(std::max<std::size_t>(n, 2) - 1);
+  for (std::size_t k = 1; k < n; k++) subdiag[k - 1] = std::sqrt(0.5 * k);
+  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver;
+  solver.computeFromTridiagonal(diag, subdiag.head(n - 1),
+                                Eigen::EigenvaluesOnly);
+
+  rule.nodes.resize(n);
+  rule.weights.resize(n);
+  for (std::size_t i = 0; i < n; i++) {
+    double x = solver.eigenvalues()[i];
+    for (int pass = 0; pass < 2; pass++) {
+      // p_{k+1} = sqrt(2/(k+1)) x p_k - sqrt(k/(k+1)) p_{k-1}
+      double p1 = invPi4, p2 = 0, sum = invPi4 * invPi4;
+      int scaled = 0;
+      for (std::size_t k = 0; k < n; k++) {
+        const double p3 = p2;
+        p2 = p1;
+        p1 = std::sqrt(2.0 / (k + 1)) * x * p2 -
+             std::sqrt(double(k) / (k + 1)) * p3;
+        if (k + 1 < n) sum += p1 * p1;
+        if (std::abs(p1) > 1 / scale) {
+          p1 *= scale;
+          p2 *= scale;
+          sum *= scale * scale;
+          scaled++;
+        }
+      }
+
+      if (pass == 0) {
+        // Newton step with p_n'(x) = sqrt(2n) p_{n-1}(x)
+        x -= p1 / (std::sqrt(2.0 * n) * p2);
+      } else {
+        rule.nodes[i] = x;
+        rule.weights[i] =
+            (scaled > 1) ? 0.0 : std::pow(scale * scale, scaled) / sum;
+      }
+    }
+  }
+  return rule;
+}
+
+DopplerAverager::DopplerAverager(double mass, double temperature,
+                                 double wavelength)
+    : m_speed(std::sqrt(2 * BoltzmannConstant_v * temperature / mass)),
+      m_wavevector(TwoPi_v / wavelength) {}
+
+DopplerAverager DopplerAverager::FromAtomicMass(double massAmu,
+                                                double temperature,
+                                                double wavelength) {
+  return DopplerAverager(massAmu * AtomicMassUnit_v, temperature, wavelength);
+}
+
+VelocityClasses DopplerAverager::GetVelocityClasses(std::size_t order) const {
+  // f(v) dv = exp(-(v/u)^2) / (sqrt(pi) u) dv with v = u * x
+  const auto rule = GaussHermiteRule::Create(order);
+  const double norm = 1 / std::sqrt(Pi_v);
+
+  VelocityClasses classes;
+  classes.velocity.resize(order);
+  classes.weight.resize(order);
+  classes.dopplerShift.resize(order);
+  for (std::size_t i = 0; i < order; i++) {
+    classes.velocity[i] = m_speed * rule.nodes[i];
+    classes.weight[i] = norm * rule.weights[i];
+    classes.dopplerShift[i] = m_wavevector * classes.velocity[i];
+  }
+  return classes;
+}
+
+void DopplerAverager::Evaluate(ThreadPool& pool, const Response_t& response,
+                               const std::vector<double>& detunings,
+                               std::vector<double>& output) const {
+  output.resize(detunings.size());
+  pool.ParallelForBlocks(0, detunings.size(), m_blockSize,
+                         [&](std::size_t b, std::size_t e) {
+                           response(detunings.data() + b, e - b,
+                                    output.data() + b);
+                         });
+}
+
+std::size_t DopplerAverager::GetRequiredOrder() const {
+  // the node spacing of a Gauss-Hermite rule around the center is about
+  // pi / sqrt(2n) and must be below half the linewidth (in units of k*u)
+  if (m_linewidth <= 0) return std::numeric_limits<std::size_t>::max();
+  const double width = m_linewidth / GetDopplerWidth();
+  const double order = 2 * Pi_v * Pi_v / (width * width);
+  if (order > m_maxOrder) return std::numeric_limits<std::size_t>::max();
+  return static_cast<std::size_t>(std::ceil(order));
+}
+
+std::optional<std::vector<double>> DopplerAverager::Average(
+    ThreadPool& pool, const Response_t& response,
+    const std::vector<double>& detunings) const {
+  // the error estimate of Gauss-Hermite requires at least one doubling
+  const std::size_t order = std::max(GetRequiredOrder(), m_minOrder);
+  if (order <= m_maxOrder / 2)
+    return AverageGaussHermite(pool, response, detunings, order);
+  return AverageGaussKronrod(pool, response, detunings);
+}
+
+std::optional<std::vector<double>> DopplerAverager::AverageGaussHermite(
+    ThreadPool& pool, const Response_t& response,
+    const std::vector<double>& detunings, std::size_t minOrder) const {
+  const std::size_t n = detunings.size();
+  std::vector<double> result(n, 0.0);
+
+  std::vector<std::size_t> active(n);
+  for (std::size_t i = 0; i < n; i++) active[i] = i;
+
+  std::vector<double> effDetunings, output;
+  bool first = true;
+  for (std::size_t order = std::max<std::size_t>(minOrder, 1);
+       !active.empty() && order <= m_maxOrder; order *= 2) {
+    const auto classes = GetVelocityClasses(order);
+
+    // (detuning, class) pairs, classes are contiguous per detuning
+    effDetunings.resize(active.size() * order);
+    for (std::size_t a = 0; a < active.size(); a++) {
+      double* eff = effDetunings.data() + a * order;
+      const double det = detunings[active[a]];
+      for (std::size_t c = 0; c < order; c++)
+        eff[c] = det - classes.dopplerShift[c];
+    }
+    Evaluate(pool, response, effDetunings, output);
+
+    // serial reduction keeps the result independent of the thread count
+    std::vector<std::size_t> unconverged;
+    for (std::size_t a = 0; a < active.size(); a++) {
+      const double* out = output.data() + a * order;
+      double sum = 0;
+      for (std::size_t c = 0; c < order; c++)
+        sum += classes.weight[c] * out[c];
+
+      const std::size_t idx = active[a];
+      const double diff = std::abs(sum - result[idx]);
+      if (first || diff > m_absTol + m_relTol * std::abs(sum))
+        unconverged.push_back(idx);
+      result[idx] = sum;
+    }
+    active.swap(unconverged);
+    first = false;
+  }
+
+  if (!active.empty()) return std::nullopt;
+  return result;
+}
+
+std::optional<std::vector<double>> DopplerAverager::AverageGaussKronrod(
+    ThreadPool& pool, const Response_t& response,
+    const std::vector<double>& detunings) const {
+  // Gauss-Kronrod 7-15 (QUADPACK qk15), nodes in [0, 1]
+  constexpr std::size_t nKronrod = 15;
+  constexpr double xgk[8] = {
+      0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+      0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+      0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+      0.207784955007898467600689403773245, 0.0};
+  constexpr double wgk[8] = {
+      0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+      0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+      0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+      0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+  constexpr double wg[4] = {
+      0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+      0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+  // the Gaussian is negligible beyond |v| = xMax * u
+  constexpr double xMax = 6.0;
+  constexpr std::size_t initialPanels = 16;
+  constexpr int maxDepth = 30;
+  const double norm = 1 / std::sqrt(Pi_v);
+  const double kU = GetDopplerWidth();
+
+  struct Panel {
+    std::size_t detuning;
+    double a, b;
+    int depth;
+  };
+
+  const std::size_t n = detunings.size();
+  std::vector<double> result(n, 0.0);
+  std::vector<Panel> panels;
+  for (std::size_t i = 0; i < n; i++) {
+    for (std::size_t p = 0; p < initialPanels; p++) {
+      const double a = -xMax + 2 * xMax * p / initialPanels;
+      const double b = -xMax + 2 * xMax * (p + 1) / initialPanels;
+      panels.push_back({i, a, b, 0});
+    }
+  }
+
+  // Kronrod node offsets and weights of a panel of unit half width
+  double offsets[nKronrod], kWeights[nKronrod], gWeights[nKronrod];
+  for (std::size_t j = 0; j < 7; j++) {
+    offsets[j] = -xgk[j];
+    offsets[nKronrod - 1 - j] = xgk[j];
+    kWeights[j] = kWeights[nKronrod - 1 - j] = wgk[j];
+    gWeights[j] = gWeights[nKronrod - 1 - j] = (j % 2) ? wg[j / 2] : 0.0;
+  }
+  offsets[7] = 0.0;
+  kWeights[7] = wgk[7];
+  gWeights[7] = wg[3];
+
+  std::vector<double> effDetunings, gauss, output;
+  std::vector<double> estimate(n, 0.0);
+  bool first = true;
+  while (!panels.empty()) {
+    effDetunings.resize(panels.size() * nKronrod);
+    gauss.resize(panels.size() * nKronrod);
+    for (std::size_t p = 0; p < panels.size(); p++) {
+      const auto& panel = panels[p];
+      const double center = 0.5 * (panel.a + panel.b);
+      const double half = 0.5 * (panel.b - panel.a);
+      for (std::size_t j = 0; j < nKronrod; j++) {
+        const double x = center + half * offsets[j];
+        effDetunings[p * nKronrod + j] = detunings[panel.detuning] - kU * x;
+        gauss[p * nKronrod + j] = half * norm * std::exp(-x * x);
+      }
+    }
+    Evaluate(pool, response, effDetunings, output);
+
+    std::vector<double> kronrod(panels.size()), error(panels.size());
+    for (std::size_t p = 0; p < panels.size(); p++) {
+      double k = 0, g = 0;
+      for (std::size_t j = 0; j < nKronrod; j++) {
+        const double f = gauss[p * nKronrod + j] * output[p * nKronrod + j];
+        k += kWeights[j] * f;
+        g += gWeights[j] * f;
+      }
+      kronrod[p] = k;
+      error[p] = std::abs(k - g);
+    }
+
+    // the initial panels provide the scale for the relative tolerance
+    if (first) {
+      for (std::size_t p = 0; p < panels.size(); p++)
+        estimate[panels[p].detuning] += kronrod[p];
+      first = false;
+    }
+
+    // accept converged panels, bisect the others (serial and in a fixed
+    // order, the result does not depend on the thread count)
+    std::vector<Panel> refine;
+    for (std::size_t p = 0; p < panels.size(); p++) {
+      const auto& panel = panels[p];
+      const double tol =
+          std::max(m_absTol, m_relTol * std::abs(estimate[panel.detuning])) *
+          (panel.b - panel.a) / (2 * xMax);
+      if (error[p] <= tol) {
+        result[panel.detuning] += kronrod[p];
+      } else if (panel.depth >= maxDepth) {
+        return std::nullopt;
+      } else {
+        const double mid = 0.5 * (panel.a + panel.b);
+        refine.push_back({panel.detuning, panel.a, mid, panel.depth + 1});
+        refine.push_back({panel.detuning, mid, panel.b, panel.depth + 1});
+      }
+    }
+    panels.swap(refine);
+  }
+
+  return result;
+}
+
+DopplerAverager::Response_t DopplerAverager::TwoLevelPopulation(double rabi,
+                                                                double gamma) {
+  const double num = 0.25 * rabi * rabi;
+  const double offset = 0.25 * gamma * gamma + 0.5 * rabi * rabi;
+  return [num, offset](const double* detunings, std::size_t n, double* out) {
+    for (std::size_t i = 0; i < n; i++)
+      out[i] = num / (detunings[i] * detunings[i] + offset);
+  };
+}
+
+DopplerAverager::Response_t DopplerAverager::SteadyStateObservable(
+    const SteadyStateSolver& solver, std::size_t observable) {
+  return [&solver, observable](const double* detunings, std::size_t n,
+                               double* out) {
+    const std::size_t nObs = solver.GetObservableCount();
+    std::vector<double> buffer(n * nObs);
+    solver.SolveBatch(detunings, n, buffer.data());
+    for (std::size_t i = 0; i < n; i++) out[i] = buffer[i * nObs + observable];
+  };
+}
+
+}  // namespace QPT
@@ -0,0 +1,117 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_SPECTROSCOPY_DOPPLERAVERAGER_H_
+#define QPT_SPECTROSCOPY_DOPPLERAVERAGER_H_
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "../Dynamics/SteadyStateSolver.h"
+#include "../Parallel/ThreadPool.h"
+
+namespace QPT {
+
+// Gauss-Hermite quadrature rule for integrals of the form
+//   int exp(-x^2) f(x) dx ~ sum_i weights[i] * f(nodes[i])
+struct GaussHermiteRule {
+  std::vector<double> nodes;
+  std::vector<double> weights;
+
+  static GaussHermiteRule Create(std::size_t order);
+};
+
+// Velocity classes in structure-of-arrays layout
+struct VelocityClasses {
+  std::vector<double> velocity;      // m/s
+  std::vector<double> weight;        // probability (sums up to 1)
+  std::vector<double> dopplerShift;  // k * v in rad/s
+
+  std::size_t GetSize() const { return velocity.size(); }
+};
+
+// Averages a (steady-state) response over the one-dimensional
+// Maxwell-Boltzmann distribution of the velocity along the beam.
+// If the narrowest feature of the response (SetLinewidth) can be resolved by
+// a Gauss-Hermite rule of at most half the maximum order, the order is
+// doubled until the average of every detuning has converged. Sub-Doppler
+// features that are too narrow for Gauss-Hermite are integrated by adaptive
+// Gauss-Kronrod bisection of the (Gaussian weighted) velocity axis.
+// In both cases only the detunings (panels) that have not converged are
+// evaluated in the next round, and all (detuning, velocity class) pairs of a
+// round are evaluated as one structure-of-arrays batch in parallel.
+class DopplerAverager {
+ public:
+  // Response of an atom at rest: writes the response for the n given
+  // (effective) detunings (rad/s) into out. Must be thread-safe.
+  using Response_t =
+      std::function<void(const double* detunings, std::size_t n, double* out)>;
+
+  // mass in kg, temperature in K, wavelength in m
+  DopplerAverager(double mass, double temperature, double wavelength);
+  static DopplerAverager FromAtomicMass(double massAmu, double temperature,
+                                        double wavelength);
+
+  // most probable speed sqrt(2 k_B T / m)
+  double GetMostProbableSpeed() const { return m_speed; }
+  // 1/e half width of the Doppler profile (rad/s)
+  double GetDopplerWidth() const { return m_wavevector * m_speed; }
+
+  void SetTolerances(double absTol, double relTol) {
+    m_absTol = absTol;
+    m_relTol = relTol;
+  }
+  void SetOrders(std::size_t minOrder, std::size_t maxOrder) {
+    m_minOrder = minOrder;
+    m_maxOrder = maxOrder;
+  }
+  // number of (detuning, velocity class) pairs per task
+  void SetBlockSize(std::size_t size) { m_blockSize = size; }
+  // full width of the narrowest feature of the response (rad/s),
+  // 0 if unknown (always uses adaptive Gauss-Kronrod)
+  void SetLinewidth(double linewidth) { m_linewidth = linewidth; }
+
+  VelocityClasses GetVelocityClasses(std::size_t order) const;
+
+  // Doppler averaged response for every detuning. std::nullopt if the
+  // average of a detuning has not converged within the tolerances at the
+  // maximum order (Gauss-Hermite) or bisection depth (Gauss-Kronrod).
+  std::optional<std::vector<double>> Average(
+      ThreadPool& pool, const Response_t& response,
+      const std::vector<double>& detunings) const;
+
+  // Responses of common models
+  // Excited state population of a driven two-level atom (rabi and gamma in
+  // rad/s). Branch-free loop that vectorizes over the detunings.
+  static Response_t TwoLevelPopulation(double rabi, double gamma);
+  // One observable of a SteadyStateSolver
+  static Response_t SteadyStateObservable(const SteadyStateSolver& solver,
+                                          std::size_t observable);
+
+ private:
+  std::size_t GetRequiredOrder() const;
+  std::optional<std::vector<double>> AverageGaussHermite(
+      ThreadPool& pool, const Response_t& response,
+      const std::vector<double>& detunings, std::size_t minOrder) const;
+  std::optional<std::vector<double>> AverageGaussKronrod(
+      ThreadPool& pool, const Response_t& response,
+      const std::vector<double>& detunings) const;
+  void Evaluate(ThreadPool& pool, const Response_t& response,
+                const std::vector<double>& detunings,
+                std::vector<double>& output) const;
+
+ private:
+  double m_speed;
+  double m_wavevector;
+
+  double m_absTol = 1e-10;
+  double m_relTol = 1e-6;
+  std::size_t m_minOrder = 16;
+  std::size_t m_maxOrder = 1024;
+  std::size_t m_blockSize = 4096;
+  double m_linewidth = 0;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_SPECTROSCOPY_DOPPLERAVERAGER_H_
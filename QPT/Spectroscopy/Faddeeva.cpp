@@ -0,0 +1,88 @@
+// Philipp Neufeld, 2023
+
+#include "Faddeeva.h"
+
+#include <cmath>
+
+#include "../Constants.h"
+#include "FaddeevaKernel.h"
+
+namespace QPT {
+
+FaddeevaKernel_t GetFaddeevaKernelScalar() {
+  return &EvaluateFaddeeva<ScalarPack>;
+}
+
+Faddeeva::Faddeeva(FaddeevaAccuracy accuracy)
+    : m_accuracy(accuracy), m_kernel(GetFaddeevaKernelScalar()) {
+  // Weideman's coefficients: Fourier coefficients of
+  //   f(theta) = exp(-t^2) (L^2 + t^2), t = L tan(theta / 2)
+  // sampled at 2M points (M = 2N) by a direct DFT
+  const std::size_t N = accuracy;
+  const std::size_t M = 2 * N;
+  m_L = std::sqrt(N / std::sqrt(2.0));
+  std::vector<double> f(2 * M, 0.0);
+  for (std::size_t j = 0; j < 2 * M; j++) {
+    // fftshift: sample j belongs to k = j - M (+/- M is t = infinity)
+    const std::size_t idx = (j + M) % (2 * M);
+    if (idx == 0) continue;
+    const double theta = (static_cast<double>(idx) - M) * Pi_v / M;
+    const double t = m_L * std::tan(theta / 2);
+    f[j] = std::exp(-t * t) * (m_L * m_L + t * t);
+  }
+
+  // p(Z) = sum_{n=1}^{N} A_n Z^(n - 1), stored highest degree first
+  m_coeffs.resize(N);
+  for (std::size_t n = 1; n <= N; n++) {
+    double sum = 0;
+    for (std::size_t j = 0; j < 2 * M; j++)
+      sum += f[j] * std::cos(Pi_v * static_cast<double>(j * n) / M);
+    m_coeffs[N - n] = sum / (2 * M);
+  }
+
+  // best kernel available
+  for (int level = GetSupportedSimdLevel(); level > Simd_SCALAR; level--) {
+    if (SetSimdLevel(static_cast<SimdLevel>(level))) break;
+  }
+}
+
+bool Faddeeva::SetSimdLevel(SimdLevel level) {
+  if (level > GetSupportedSimdLevel()) return false;
+  FaddeevaKernel_t kernel = nullptr;
+  switch (level) {
+    case Simd_SCALAR:
+      kernel = GetFaddeevaKernelScalar();
+      break;
+    case Simd_NEON:
+      kernel = GetFaddeevaKernelNEON();
+      break;
+    case Simd_AVX2:
+      kernel = GetFaddeevaKernelAVX2();
+      break;
+    case Simd_AVX512:
+      kernel = GetFaddeevaKernelAVX512();
+      break;
+  }
+  if (!kernel) return false;
+  m_level = level;
+  m_kernel = kernel;
+  return true;
+}
+
+std::complex<double> Faddeeva::Evaluate(std::complex<double> z) const {
+  if (z.imag() < 0) {
+    const auto reflected = Evaluate(-z);
+    return 2.0 * std::exp(-z * z) - reflected;
+  }
+  const double x = z.real(), y = z.imag();
+  double re, im;
+  m_kernel(m_coeffs.data(), m_coeffs.size(), m_L, &x, &y, 1, &re, &im);
+  return {re, im};
+}
+
+void Faddeeva::Evaluate(const double* x, const double* y, std::size_t n,
+                        double* re, double* im) const {
+  m_kernel(m_coeffs.data(), m_coeffs.size(), m_L, x, y, n, re, im);
+}
+
+}  // namespace QPT
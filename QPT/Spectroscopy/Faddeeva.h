@@ -0,0 +1,58 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_SPECTROSCOPY_FADDEEVA_H_
+#define QPT_SPECTROSCOPY_FADDEEVA_H_
+
+#include <complex>
+#include <vector>
+
+#include "../Parallel/Simd.h"
+
+namespace QPT {
+
+// Number of terms of the rational approximation: the fast mode is accurate
+// to about 5e-7 relative to |w|, the accurate mode to about 1e-12 (see
+// Apps/FaddeevaBenchmark).
+enum FaddeevaAccuracy {
+  Faddeeva_FAST = 16,
+  Faddeeva_ACCURATE = 32,
+};
+
+// Faddeeva function w(z) = exp(-z^2) erfc(-i z) in the upper half plane
+// with Weideman's rational approximation (SIAM J. Numer. Anal. 31, 1497
+// (1994)): a polynomial of degree N - 1 in Z = (L + i z) / (L - i z) that is
+// evaluated without branches, i.e. the same instructions for every z.
+// Batches are evaluated in structure-of-arrays layout by an explicitly
+// vectorized kernel (AVX-512, AVX2 or NEON) that is selected at runtime,
+// with a scalar fallback.
+class Faddeeva {
+ public:
+  explicit Faddeeva(FaddeevaAccuracy accuracy = Faddeeva_ACCURATE);
+
+  // any z (reflection w(z) = 2 exp(-z^2) - w(-z) for Im z < 0)
+  std::complex<double> Evaluate(std::complex<double> z) const;
+  // re[i] + i im[i] = w(x[i] + i y[i]) for y[i] >= 0 (im may be nullptr)
+  void Evaluate(const double* x, const double* y, std::size_t n, double* re,
+                double* im = nullptr) const;
+
+  // Restricts the kernel to the given instruction set. Returns false (and
+  // keeps the current kernel) if it is not supported by the CPU or was not
+  // compiled in.
+  bool SetSimdLevel(SimdLevel level);
+  SimdLevel GetSimdLevel() const { return m_level; }
+  FaddeevaAccuracy GetAccuracy() const { return m_accuracy; }
+
+ private:
+  using Kernel_t = void (*)(const double*, std::size_t, double, const double*,
+                            const double*, std::size_t, double*, double*);
+
+  FaddeevaAccuracy m_accuracy;
+  double m_L;
+  std::vector<double> m_coeffs;
+  SimdLevel m_level = Simd_SCALAR;
+  Kernel_t m_kernel;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_SPECTROSCOPY_FADDEEVA_H_
@@ -0,0 +1,46 @@
+// Philipp Neufeld, 2023
+
+// compiled with AVX2 and FMA enabled (see CMakeLists.txt)
+
+#include "FaddeevaKernel.h"
+
+// MSVC does not define __FMA__, /arch:AVX2 implies FMA
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#endif
+
+namespace QPT {
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+
+namespace {
+
+struct Avx2Pack {
+  using Type = __m256d;
+  static constexpr std::size_t Width = 4;
+
+  static Type Load(const double* p) { return _mm256_loadu_pd(p); }
+  static void Store(double* p, Type v) { _mm256_storeu_pd(p, v); }
+  static Type Broadcast(double v) { return _mm256_set1_pd(v); }
+  static Type Add(Type a, Type b) { return _mm256_add_pd(a, b); }
+  static Type Sub(Type a, Type b) { return _mm256_sub_pd(a, b); }
+  static Type Mul(Type a, Type b) { return _mm256_mul_pd(a, b); }
+  static Type Div(Type a, Type b) { return _mm256_div_pd(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) {
+    return _mm256_fmadd_pd(a, b, c);
+  }
+};
+
+}  // namespace
+
+FaddeevaKernel_t GetFaddeevaKernelAVX2() {
+  return &EvaluateFaddeeva<Avx2Pack>;
+}
+
+#else
+
+FaddeevaKernel_t GetFaddeevaKernelAVX2() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
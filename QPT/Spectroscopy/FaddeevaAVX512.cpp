@@ -0,0 +1,45 @@
+// Philipp Neufeld, 2023
+
+// compiled with AVX-512F enabled (see CMakeLists.txt)
+
+#include "FaddeevaKernel.h"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace QPT {
+
+#if defined(__AVX512F__)
+
+namespace {
+
+struct Avx512Pack {
+  using Type = __m512d;
+  static constexpr std::size_t Width = 8;
+
+  static Type Load(const double* p) { return _mm512_loadu_pd(p); }
+  static void Store(double* p, Type v) { _mm512_storeu_pd(p, v); }
+  static Type Broadcast(double v) { return _mm512_set1_pd(v); }
+  static Type Add(Type a, Type b) { return _mm512_add_pd(a, b); }
+  static Type Sub(Type a, Type b) { return _mm512_sub_pd(a, b); }
+  static Type Mul(Type a, Type b) { return _mm512_mul_pd(a, b); }
+  static Type Div(Type a, Type b) { return _mm512_div_pd(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) {
+    return _mm512_fmadd_pd(a, b, c);
+  }
+};
+
+}  // namespace
+
+FaddeevaKernel_t GetFaddeevaKernelAVX512() {
+  return &EvaluateFaddeeva<Avx512Pack>;
+}
+
+#else
+
+FaddeevaKernel_t GetFaddeevaKernelAVX512() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
@@ -0,0 +1,102 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_SPECTROSCOPY_FADDEEVAKERNEL_H_
+#define QPT_SPECTROSCOPY_FADDEEVAKERNEL_H_
+
+// Internal header of the Faddeeva kernels. Every kernel translation unit is
+// compiled for its own instruction set, therefore everything in this header
+// has internal linkage: the linker must never merge an AVX-512 instance of a
+// helper into the code of the scalar fallback.
+
+#include <cstddef>
+
+namespace QPT {
+
+// re/im (im may be nullptr) of w(x + i y), y >= 0, with Weideman's rational
+// approximation given by the polynomial coefficients a (highest degree
+// first) and the scale L
+using FaddeevaKernel_t = void (*)(const double* a, std::size_t order,
+                                  double L, const double* x, const double* y,
+                                  std::size_t n, double* re, double* im);
+
+// nullptr if the kernel was not compiled for the instruction set
+FaddeevaKernel_t GetFaddeevaKernelScalar();
+FaddeevaKernel_t GetFaddeevaKernelNEON();
+FaddeevaKernel_t GetFaddeevaKernelAVX2();
+FaddeevaKernel_t GetFaddeevaKernelAVX512();
+
+namespace {
+
+struct ScalarPack {
+  using Type = double;
+  static constexpr std::size_t Width = 1;
+
+  static Type Load(const double* p) { return *p; }
+  static void Store(double* p, Type v) { *p = v; }
+  static Type Broadcast(double v) { return v; }
+  static Type Add(Type a, Type b) { return a + b; }
+  static Type Sub(Type a, Type b) { return a - b; }
+  static Type Mul(Type a, Type b) { return a * b; }
+  static Type Div(Type a, Type b) { return a / b; }
+  // a * b + c
+  static Type MulAdd(Type a, Type b, Type c) { return a * b + c; }
+};
+
+// Pack provides the operations of ScalarPack for Pack::Width doubles
+template <typename Pack>
+void EvaluateFaddeeva(const double* a, std::size_t order, double L,
+                      const double* x, const double* y, std::size_t n,
+                      double* re, double* im) {
+  using P = Pack;
+  using V = typename Pack::Type;
+  const V l = P::Broadcast(L);
+  const V one = P::Broadcast(1.0);
+  const V two = P::Broadcast(2.0);
+  const V invSqrtPi = P::Broadcast(0.56418958354775628695);
+  const V a0 = P::Broadcast(a[0]);
+
+  std::size_t i = 0;
+  for (; i + P::Width <= n; i += P::Width) {
+    const V xv = P::Load(x + i);
+    const V yv = P::Load(y + i);
+
+    // 1 / (L - i z) = ((L + y) + i x) / ((L + y)^2 + x^2)
+    const V dr = P::Add(l, yv);
+    const V norm = P::Div(one, P::MulAdd(dr, dr, P::Mul(xv, xv)));
+    const V invR = P::Mul(dr, norm);
+    const V invI = P::Mul(xv, norm);
+
+    // Z = (L + i z) / (L - i z) = ((L - y) + i x) / (L - i z)
+    const V nr = P::Sub(l, yv);
+    const V zr = P::Sub(P::Mul(nr, invR), P::Mul(xv, invI));
+    const V zi = P::MulAdd(nr, invI, P::Mul(xv, invR));
+
+    // p(Z) by Horner's scheme
+    V pr = a0, pi = P::Broadcast(0.0);
+    for (std::size_t k = 1; k < order; k++) {
+      const V ak = P::Broadcast(a[k]);
+      const V t = P::MulAdd(pr, zr, P::Sub(ak, P::Mul(pi, zi)));
+      pi = P::MulAdd(pr, zi, P::Mul(pi, zr));
+      pr = t;
+    }
+
+    // w = (2 p(Z) / (L - i z) + 1 / sqrt(pi)) / (L - i z)
+    const V qr = P::MulAdd(
+        two, P::Sub(P::Mul(pr, invR), P::Mul(pi, invI)), invSqrtPi);
+    const V qi = P::Mul(two, P::MulAdd(pr, invI, P::Mul(pi, invR)));
+    P::Store(re + i, P::Sub(P::Mul(qr, invR), P::Mul(qi, invI)));
+    if (im) P::Store(im + i, P::MulAdd(qr, invI, P::Mul(qi, invR)));
+  }
+
+  // remainder
+  if (i < n) {
+    EvaluateFaddeeva<ScalarPack>(a, order, L, x + i, y + i, n - i, re + i,
+                                 im ? im + i : nullptr);
+  }
+}
+
+}  // namespace
+
+}  // namespace QPT
+
+#endif  // !QPT_SPECTROSCOPY_FADDEEVAKERNEL_H_
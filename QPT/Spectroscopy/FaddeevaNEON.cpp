@@ -0,0 +1,43 @@
+// Philipp Neufeld, 2023
+
+#include "FaddeevaKernel.h"
+
+#include "../Platform.h"
+
+#if defined(QPT_ARCH_ARM64)
+#include <arm_neon.h>
+#endif
+
+namespace QPT {
+
+#if defined(QPT_ARCH_ARM64)
+
+namespace {
+
+struct NeonPack {
+  using Type = float64x2_t;
+  static constexpr std::size_t Width = 2;
+
+  static Type Load(const double* p) { return vld1q_f64(p); }
+  static void Store(double* p, Type v) { vst1q_f64(p, v); }
+  static Type Broadcast(double v) { return vdupq_n_f64(v); }
+  static Type Add(Type a, Type b) { return vaddq_f64(a, b); }
+  static Type Sub(Type a, Type b) { return vsubq_f64(a, b); }
+  static Type Mul(Type a, Type b) { return vmulq_f64(a, b); }
+  static Type Div(Type a, Type b) { return vdivq_f64(a, b); }
+  static Type MulAdd(Type a, Type b, Type c) { return vfmaq_f64(c, a, b); }
+};
+
+}  // namespace
+
+FaddeevaKernel_t GetFaddeevaKernelNEON() {
+  return &EvaluateFaddeeva<NeonPack>;
+}
+
+#else
+
+FaddeevaKernel_t GetFaddeevaKernelNEON() { return nullptr; }
+
+#endif
+
+}  // namespace QPT
@@ -0,0 +1,60 @@
+// Philipp Neufeld, 2023
+
+#include "VoigtProfile.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Constants.h"
+
+namespace QPT {
+
+VoigtProfile::VoigtProfile(double sigma, double gamma,
+                           FaddeevaAccuracy accuracy)
+    : m_sigma(sigma), m_gamma(std::abs(gamma)), m_faddeeva(accuracy) {}
+
+VoigtProfile VoigtProfile::FromDoppler(double mass, double temperature,
+                                       double wavelength, double gamma,
+                                       FaddeevaAccuracy accuracy) {
+  // velocity standard deviation sqrt(k_B T / m) times the wavevector
+  const double sigma = std::sqrt(BoltzmannConstant_v * temperature / mass) *
+                       TwoPi_v / wavelength;
+  return VoigtProfile(sigma, gamma, accuracy);
+}
+
+double VoigtProfile::GetFWHM() const {
+  const double fG = 2 * std::sqrt(2 * Ln2_v) * m_sigma;
+  const double fL = 2 * m_gamma;
+  return 0.5346 * fL + std::sqrt(0.2166 * fL * fL + fG * fG);
+}
+
+double VoigtProfile::Evaluate(double detuning) const {
+  double out;
+  Evaluate(&detuning, 1, &out);
+  return out;
+}
+
+void VoigtProfile::Evaluate(const double* detunings, std::size_t n,
+                            double* out) const {
+  // z = (delta + i gamma) / (sqrt(2) sigma), chunks stay in the L1 cache
+  constexpr std::size_t chunk = 256;
+  const double scale = 1 / (std::sqrt(2.0) * m_sigma);
+  const double norm = 1 / (std::sqrt(TwoPi_v) * m_sigma);
+  double x[chunk], y[chunk];
+  std::fill(y, y + chunk, m_gamma * scale);
+  for (std::size_t b = 0; b < n; b += chunk) {
+    const std::size_t len = std::min(chunk, n - b);
+    for (std::size_t i = 0; i < len; i++) x[i] = detunings[b + i] * scale;
+    m_faddeeva.Evaluate(x, y, len, out + b);
+    for (std::size_t i = 0; i < len; i++) out[b + i] *= norm;
+  }
+}
+
+void VoigtProfile::Evaluate(ThreadPool& pool, const double* detunings,
+                            std::size_t n, double* out) const {
+  pool.ParallelForBlocks(0, n, 16384, [&](std::size_t b, std::size_t e) {
+    Evaluate(detunings + b, e - b, out + b);
+  });
+}
+
+}  // namespace QPT
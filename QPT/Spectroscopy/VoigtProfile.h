@@ -0,0 +1,48 @@
+// Philipp Neufeld, 2023
+
+#ifndef QPT_SPECTROSCOPY_VOIGTPROFILE_H_
+#define QPT_SPECTROSCOPY_VOIGTPROFILE_H_
+
+#include "../Parallel/ThreadPool.h"
+#include "Faddeeva.h"
+
+namespace QPT {
+
+// Area normalized Voigt profile in angular frequency detuning (rad/s)
+//   V(delta) = Re w((delta + i gamma) / (sqrt(2) sigma)) / (sqrt(2 pi) sigma)
+// i.e. the convolution of a Gaussian with standard deviation sigma and a
+// Lorentzian with half width at half maximum gamma (sigma > 0). Detunings are
+// processed in chunks by the vectorized Faddeeva kernel.
+class VoigtProfile {
+ public:
+  VoigtProfile(double sigma, double gamma,
+               FaddeevaAccuracy accuracy = Faddeeva_ACCURATE);
+  // Doppler broadened line of an atom (mass in kg, temperature in K,
+  // wavelength in m) with natural / pressure broadening gamma (rad/s)
+  static VoigtProfile FromDoppler(
+      double mass, double temperature, double wavelength, double gamma,
+      FaddeevaAccuracy accuracy = Faddeeva_ACCURATE);
+
+  double GetSigma() const { return m_sigma; }
+  double GetGamma() const { return m_gamma; }
+  // full width at half maximum (Olivero and Longbothum, accuracy 2e-4)
+  double GetFWHM() const;
+
+  double Evaluate(double detuning) const;
+  // out[i] = V(detunings[i]), same signature as DopplerAverager::Response_t
+  void Evaluate(const double* detunings, std::size_t n, double* out) const;
+  void Evaluate(ThreadPool& pool, const double* detunings, std::size_t n,
+                double* out) const;
+
+  // e.g. to select the instruction set for benchmarks
+  Faddeeva& GetFaddeeva() { return m_faddeeva; }
+
+ private:
+  double m_sigma;
+  double m_gamma;
+  Faddeeva m_faddeeva;
+};
+
+}  // namespace QPT
+
+#endif  // !QPT_SPECTROSCOPY_VOIGTPROFILE_H_